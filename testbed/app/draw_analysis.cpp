@@ -12,6 +12,7 @@
 #include <zest/ui/colors.h>
 
 #include <zing/audio/audio.h>
+#include <zing/audio/audio_analysis.h>
 #include <zing/audio/waterfall.h>
 
 #include <implot.h>
@@ -27,7 +28,6 @@ namespace
 {
 void draw_spectrum_plot(const Zing::ChannelId& Id,
                         const std::vector<float>& spectrumBuckets,
-                        float sampleRate,
                         bool showFilterBox,
                         float maxHz)
 {
@@ -36,27 +36,26 @@ void draw_spectrum_plot(const Zing::ChannelId& Id,
 
     PROFILE_SCOPE(draw_spectrum_plot);
 
+    // X is the display position [0..1]; the partition decides which frequency that is
+    const auto partition = audio_analysis_partition_settings(audio_analysis_is_iq(Id));
     const auto bucketCount = spectrumBuckets.size();
-    auto sampleCount = sampleRate * 0.5f;
-    sampleCount /= float(bucketCount);
 
     static std::vector<float> xs;
     xs.resize(bucketCount);
     for (int i = 0; i < bucketCount; ++i)
     {
-        xs[i] = float(i * sampleCount);
+        xs[i] = (float(i) + 0.5f) / float(bucketCount);
     }
 
     ImVec2 plotPos(0.0f, 0.0f);
     ImVec2 plotSize(0.0f, 0.0f);
-    const float fullMaxHz = float(bucketCount * sampleCount);
-    const float plotMaxHz = (maxHz > 0.0f) ? std::min(maxHz, fullMaxHz) : fullMaxHz;
+    const float plotMaxX = (maxHz > 0.0f) ? float(spectrum_partition_x_at(partition, maxHz)) : 1.0f;
     if (ImPlot::BeginPlot(std::format("Spectrum: {}", audio_to_channel_name(Id)).c_str(), ImVec2(-1, 0),
         ImPlotFlags_Crosshairs | ImPlotFlags_NoLegend | ImPlotFlags_NoFrame | ImPlotFlags_NoInputs))
     {
         ImPlot::SetupAxes("", "", ImPlotAxisFlags_Lock | ImPlotAxisFlags_NoLabel | ImPlotAxisFlags_NoTickLabels,
             ImPlotAxisFlags_NoLabel | ImPlotAxisFlags_NoTickLabels | ImPlotAxisFlags_NoGridLines);
-        ImPlot::SetupAxisLimits(ImAxis_X1, 0.0f, plotMaxHz, ImPlotCond_Always);
+        ImPlot::SetupAxisLimits(ImAxis_X1, 0.0f, std::max(plotMaxX, 1e-3f), ImPlotCond_Always);
         ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0f, 1.0f, ImPlotCond_Always);
         plotPos = ImPlot::GetPlotPos();
         plotSize = ImPlot::GetPlotSize();
@@ -65,21 +64,23 @@ void draw_spectrum_plot(const Zing::ChannelId& Id,
         if (showFilterBox)
         {
             auto& wf = Waterfall_Get();
-            const double markerValue = std::clamp<double>(radio_marker_center_hz(), 0.0, double(plotMaxHz));
+            const double markerValue = radio_marker_center_hz();
             const double markerWidthHz = std::max(1.0, double(wf.markerWidthHz));
             const double markerHalfHz = markerWidthHz * 0.5;
+            const double markerLow = spectrum_partition_x_at(partition, markerValue - markerHalfHz);
+            const double markerHigh = spectrum_partition_x_at(partition, markerValue + markerHalfHz);
 
-            const ImPlotPoint rectMin(markerValue - markerHalfHz, 0.0);
-            const ImPlotPoint rectMax(markerValue + markerHalfHz, 1.0);
+            const ImPlotPoint rectMin(markerLow, 0.0);
+            const ImPlotPoint rectMax(markerHigh, 1.0);
             ImPlot::PushPlotClipRect();
             ImPlot::GetPlotDrawList()->AddRectFilled(
                 ImPlot::PlotToPixels(rectMin),
                 ImPlot::PlotToPixels(rectMax),
                 IM_COL32(255, 255, 255, 48));
-            const ImVec2 lineMin = ImPlot::PlotToPixels(ImPlotPoint(markerValue - markerHalfHz, 0.0));
-            const ImVec2 lineMax = ImPlot::PlotToPixels(ImPlotPoint(markerValue - markerHalfHz, 1.0));
-            const ImVec2 lineMin2 = ImPlot::PlotToPixels(ImPlotPoint(markerValue + markerHalfHz, 0.0));
-            const ImVec2 lineMax2 = ImPlot::PlotToPixels(ImPlotPoint(markerValue + markerHalfHz, 1.0));
+            const ImVec2 lineMin = ImPlot::PlotToPixels(ImPlotPoint(markerLow, 0.0));
+            const ImVec2 lineMax = ImPlot::PlotToPixels(ImPlotPoint(markerLow, 1.0));
+            const ImVec2 lineMin2 = ImPlot::PlotToPixels(ImPlotPoint(markerHigh, 0.0));
+            const ImVec2 lineMax2 = ImPlot::PlotToPixels(ImPlotPoint(markerHigh, 1.0));
             ImPlot::GetPlotDrawList()->AddLine(lineMin, lineMax, IM_COL32(255, 255, 0, 255), 1.0f);
             ImPlot::GetPlotDrawList()->AddLine(lineMin2, lineMax2, IM_COL32(255, 255, 0, 255), 1.0f);
             ImPlot::PopPlotClipRect();
@@ -103,6 +104,129 @@ void draw_spectrum_plot(const Zing::ChannelId& Id,
     }
 }
 
+// Power in the marker's passband, like an S-meter
+void draw_marker_power(const AudioAnalysisData& data)
+{
+    auto& wf = Waterfall_Get();
+    const double markerValue = radio_marker_center_hz();
+    const double markerHalfHz = std::max(1.0, double(wf.markerWidthHz)) * 0.5;
+    const float power = audio_analysis_band_power(data, markerValue - markerHalfHz, markerValue + markerHalfHz);
+
+    const float dbfs = 10.0f * std::log10(std::max(power / data.fullScalePower, 1e-12f));
+    ImGui::Text("Marker: %.1f dBFS over %.0f Hz", dbfs, markerHalfHz * 2.0);
+}
+
+// The analysis peak list, strongest first
+void draw_peak_list(const AudioAnalysisData& data)
+{
+    if (data.peaks.empty() || !ImGui::TreeNode("Peaks"))
+        return;
+
+    if (ImGui::BeginTable("Peaks", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchSame))
+    {
+        ImGui::TableSetupColumn("Hz");
+        ImGui::TableSetupColumn("dBFS");
+        ImGui::TableSetupColumn("SNR (dB)");
+        ImGui::TableSetupColumn("Spectra");
+        ImGui::TableHeadersRow();
+        for (const auto& peak : data.peaks)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%.1f", peak.hz);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.1f", peak.powerDb);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", peak.snrDb);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%u", peak.persistence);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::TreePop();
+}
+
+void draw_spot_list(const AudioAnalysisData& data)
+{
+    if (data.spots.empty() || !ImGui::TreeNode("Skimmer"))
+        return;
+
+    if (ImGui::BeginTable("Spots", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+    {
+        ImGui::TableSetupColumn("Hz");
+        ImGui::TableSetupColumn("WPM");
+        ImGui::TableSetupColumn("SNR (dB)");
+        ImGui::TableSetupColumn("Call");
+        ImGui::TableSetupColumn("Text", ImGuiTableColumnFlags_WidthStretch, 4.0f);
+        ImGui::TableHeadersRow();
+        for (const auto& spot : data.spots)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%.0f", spot.hz);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.0f", spot.wpm);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", spot.snrDb);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::TextUnformatted(spot.callsign.c_str());
+            ImGui::TableSetColumnIndex(4);
+            ImGui::TextUnformatted(spot.text.c_str());
+        }
+        ImGui::EndTable();
+    }
+    ImGui::TreePop();
+}
+
+// Narrowband view around the marker, in Hz
+void draw_zoom_plot(const Zing::ChannelId& Id, const AudioAnalysisData& data)
+{
+    const auto& zoomSpectrum = data.zoomSpectrum;
+    if (zoomSpectrum.empty())
+        return;
+
+    PROFILE_SCOPE(draw_zoom_plot);
+
+    const auto binCount = zoomSpectrum.size();
+    const double binHz = (data.zoomMaxHz - data.zoomMinHz) / double(binCount);
+
+    static std::vector<double> xs;
+    static std::vector<double> ys;
+    xs.resize(binCount);
+    ys.resize(binCount);
+    for (size_t i = 0; i < binCount; ++i)
+    {
+        xs[i] = data.zoomMinHz + (double(i) * binHz);
+        ys[i] = zoomSpectrum[i];
+    }
+
+    if (ImPlot::BeginPlot(std::format("Zoom: {} ({:.2f} Hz bins)", audio_to_channel_name(Id), binHz).c_str(), ImVec2(-1, 0),
+        ImPlotFlags_Crosshairs | ImPlotFlags_NoLegend | ImPlotFlags_NoFrame | ImPlotFlags_NoInputs))
+    {
+        ImPlot::SetupAxes("", "", ImPlotAxisFlags_Lock | ImPlotAxisFlags_NoLabel,
+            ImPlotAxisFlags_NoLabel | ImPlotAxisFlags_NoTickLabels | ImPlotAxisFlags_NoGridLines);
+        ImPlot::SetupAxisLimits(ImAxis_X1, data.zoomMinHz, data.zoomMaxHz, ImPlotCond_Always);
+        ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0f, 1.0f, ImPlotCond_Always);
+        ImPlot::PlotLine("Level/Freq", xs.data(), ys.data(), int(binCount));
+
+        // Filter edges
+        auto& wf = Waterfall_Get();
+        const double markerValue = radio_marker_center_hz();
+        const double markerHalfHz = std::max(1.0, double(wf.markerWidthHz)) * 0.5;
+        ImPlot::PushPlotClipRect();
+        for (auto edgeHz : { markerValue - markerHalfHz, markerValue + markerHalfHz })
+        {
+            ImPlot::GetPlotDrawList()->AddLine(
+                ImPlot::PlotToPixels(ImPlotPoint(edgeHz, 0.0)),
+                ImPlot::PlotToPixels(ImPlotPoint(edgeHz, 1.0)),
+                IM_COL32(255, 255, 0, 255), 1.0f);
+        }
+        ImPlot::PopPlotClipRect();
+
+        ImPlot::EndPlot();
+    }
+}
+
 void draw_audio_plot(const Zing::ChannelId& Id, const std::vector<float>& audio)
 {
     if (audio.empty())
@@ -167,7 +291,7 @@ void draw_analysis()
             {
                 if (i == 1)
                 {
-                    draw_spectrum_plot(Id, spectrumBuckets, float(ctx.audioDeviceSettings.sampleRate), true, 0.0f);
+                    draw_spectrum_plot(Id, spectrumBuckets, true, 0.0f);
                 }
                 else
                 {
@@ -176,6 +300,17 @@ void draw_analysis()
             }
         }
     }
+
+    for (auto [Id, pAnalysis] : ctx.analysisChannels)
+    {
+        if (Id.first == Channel_In && Id.second == 0 && pAnalysis->uiDataCache)
+        {
+            draw_marker_power(*pAnalysis->uiDataCache);
+            draw_peak_list(*pAnalysis->uiDataCache);
+            draw_spot_list(*pAnalysis->uiDataCache);
+            draw_zoom_plot(Id, *pAnalysis->uiDataCache);
+        }
+    }
     ImGui::PopStyleVar(2);
 }
 
@@ -185,7 +320,7 @@ void draw_output_analysis()
     auto& ctx = GetAudioContext();
 
     Zing::ChannelId outputId{};
-    std::shared_ptr<AudioAnalysisData> outputData;
+    const AudioAnalysisData* outputData = nullptr;
     for (auto [Id, pAnalysis] : ctx.analysisChannels)
     {
         if (Id.first != Channel_Out || Id.second != 0)
@@ -220,7 +355,7 @@ void draw_output_analysis()
         ImGui::TableSetColumnIndex(1);
         const float bandHz = std::max(1.0f, GetRadioSettings().markerWidthHz);
         const float plotHz = std::max(1500.0f, bandHz);
-        draw_spectrum_plot(outputId, spectrumBuckets, float(ctx.audioDeviceSettings.sampleRate), false, plotHz);
+        draw_spectrum_plot(outputId, spectrumBuckets, false, plotHz);
 
         ImGui::EndTable();
     }
@@ -1,368 +1,538 @@
 #include "radio.h"
+#include "radio_pipeline.h"
 #include "radio_settings.h"
 #include <zing/audio/waterfall.h>
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
 #include <cmath>
-#include <kiss_fft.h>
+#include <memory>
+#include <semaphore>
+#include <thread>
 #include <vector>
 #include <zing/audio/audio.h>
-#include <zest/algorithm/ring_buffer.h>
+#include <zing/audio/audio_analysis.h>
+#include <zing/audio/cw_decoder.h>
+#include <zing/audio/fft.h>
+#include <zing/audio/rt_check.h>
+#include <zing/audio/sample_ring.h>
 
 using namespace Zing;
 
 namespace
 {
 
-struct RadioFftState
-{
-    uint32_t fftSize = 0;
-    uint32_t hopDiv = 2;
-    uint32_t hopSize = 0;
-    kiss_fft_cfg cfgFwd = nullptr;
-    kiss_fft_cfg cfgInv = nullptr;
-    std::vector<float> window;
-    std::vector<float> olaScale;
-    std::vector<float> fftIn;
-    std::vector<kiss_fft_cpx> fftInCpx;
-    std::vector<kiss_fft_cpx> fftOut;
-    std::vector<kiss_fft_cpx> fftShifted;
-    std::vector<float> fftBins;
-    std::vector<kiss_fft_cpx> ifftOut;
-    Zest::ring_buffer<float> ring;
-    std::vector<float> outBuffer;
-    uint32_t outRead = 0;
-    uint32_t outWrite = 0;
-
-    std::vector<float> skirtWeights;
-    uint32_t skirtBins = 0;
-    uint32_t passBins = 0;
-    uint32_t totalBins = 0;
-    double cachedBinHz = 0.0;
-    double cachedWidthHz = 0.0;
-    float cachedFalloff = 0.0f;
-    float cachedSkirtRatio = 0.0f;
-
-    float agcGain = 1.0f;
-    float agcPower = 0.0f;
-    float outAgcGain = 1.0f;
-    float outAgcPower = 0.0f;
-    std::vector<float> outBlock;
+// The marker receiver, and what it runs with. Everything is worked out on the UI thread, where the
+// marker and the I/Q lookup in the analysis channels are safe to touch and allocating is fine.
+// When the engine or its sizes change, a new pipeline is built there and handed over by pointer;
+// the audio thread swaps it in, and hands back the one it replaced for the UI to free. Otherwise
+// the audio thread only takes the newest snapshot.
+struct RadioLiveState
+{
+    RadioPipeline* pPipeline = nullptr;             // Audio thread owned
+    std::atomic<RadioPipeline*> pPending = nullptr; // Built, not yet taken
+    std::atomic<RadioPipeline*> pRetired = nullptr; // Replaced, not yet freed
+    TripleBuffer<RadioPipelineParams> params;
+    TripleBuffer<RadioConvResponse> convResponse;   // Partitioned responses, designed here
+    std::atomic<double> latencySeconds = 0.0;       // Of the pipeline in use
+
+    // UI thread owned
+    RadioPipelineParams builtParams; // What the last pipeline sent was sized for
+    bool built = false;
+    RadioSkirt skirt;                // For the display
+    RadioConvDesigner designer;
 };
 
-RadioFftState g_fft;
+RadioLiveState g_radio;
 
+// The extra receivers, all fed from one forward transform. The audio thread only moves samples:
+// input goes to the bank thread in fixed blocks through a ring, and each block comes back a block
+// later as one block per output bus. The bank runs the STFT: one forward FFT per hop, however many
+// receivers there are, then each receiver's band pass, inverse and overlap-add as a parallel job
+// on the bank's own workers.
+constexpr uint32_t RadioBankBlock = 256;
+constexpr uint32_t RadioBankRingBlocks = 16; // Power of 2
 
-std::vector<uint32_t> build_bucket_edges(uint32_t limit, uint32_t buckets)
+struct RadioReceiverState
 {
-    std::vector<uint32_t> edges;
-    edges.reserve(buckets);
+    bool active = false;
+    RadioSkirt skirt;
+    RadioAgcState agc;
+    std::vector<FftComplex> shifted;     // fftSize / 2 + 1 bins
+    std::vector<float> outBlock;         // fftSize
+    std::vector<float> olaSum;           // fftSize; read at the shared olaRead
+    std::vector<FftComplex> ifftScratch; // fftSize / 2
+    std::atomic<float> power = 0.0f;     // Output AGC level, for the UI
+};
 
-    for (uint32_t i = 0; i < buckets; ++i)
-    {
-        edges.push_back(uint32_t(limit * (float(i) / float(buckets))));
-    }
-    return edges;
+struct RadioBankState
+{
+    // Shared input history, window and forward transform; its own overlap-add is unused
+    RadioFftState fft;
+    std::array<RadioReceiverState, RadioMaxReceivers> receivers;
+    std::array<uint32_t, RadioMaxReceivers> activeList{};
+    uint32_t activeCount = 0;
+    std::vector<float> discard; // Output when the ring is full
+
+    SampleRing inRing;  // RadioBankBlock samples of input channel 0
+    SampleRing outRing; // RadioMaxBuses planar blocks of RadioBankBlock samples
+    TripleBuffer<RadioPipelineParams> params; // The audio thread's snapshot, sent with each block
+    AudioAnalysisScheduler workers;
+    std::thread thread;
+    std::counting_semaphore<> wake{ 0 };
+    std::atomic_bool running = false;
+    std::atomic_bool quit = false;
+
+    // Audio thread side. A block is only played once the one after it has gone in, so the bank
+    // always has a block's time to return it; a late block is counted and skipped when it arrives.
+    float* pInBlock = nullptr;
+    const float* pOutBlock = nullptr;
+    uint32_t fill = 0;
+    uint32_t inFlight = 0; // Posted blocks not yet played or skipped
+    uint32_t skipBlocks = 0;
+    bool idle = true;
+
+    // Per hop, smoothed; written by the bank thread
+    std::atomic<double> forwardUs = 0.0;
+    std::atomic<double> receiversUs = 0.0;
+    std::atomic<uint32_t> lastActive = 0;
+    std::atomic<uint64_t> underruns = 0;
+    std::atomic<double> latencySeconds = 0.0;
+};
+
+RadioBankState g_bank;
+
+// Morse decoding of the marker receiver's output, taken before the bank mixes its receivers in
+struct RadioCwState
+{
+    CwDecoder decoder;
+    float sampleRate = 0.0f;
+    bool running = false;
+};
+
+RadioCwState g_cw;
+
+
+// The marker is a display position, so it maps through the same partition as the spectrum buckets.
+// With I/Q input that can be below 0Hz.
+double marker_center_hz(float markerX)
+{
+    const bool twoSided = audio_analysis_is_iq(audio_to_channel_id(Channel_In, 0));
+    return spectrum_partition_hz_at(audio_analysis_partition_settings(twoSided), markerX);
 }
 
-double marker_center_bin(float markerX)
+// The radio demodulates channel 0 as real audio, where a negative frequency is its mirror image
+double marker_radio_hz(float markerX)
 {
-    auto& ctx = GetAudioContext();
-    const uint32_t frames = std::max(2u, ctx.audioAnalysisSettings.frames);
-    const uint32_t spectrumSamples = (frames / 2) + 1;
-    const uint32_t buckets = std::max(1u, ctx.audioAnalysisSettings.spectrumBuckets);
-    const auto edges = build_bucket_edges(spectrumSamples, buckets);
-    float bucketPos = markerX * float(buckets);
-    bucketPos = std::clamp(bucketPos, 0.0f, std::nextafter(float(buckets), 0.0f));
-    const int bucketIndex = std::clamp(int(bucketPos), 0, int(buckets - 1));
-    const float bucketFrac = std::clamp(bucketPos - float(bucketIndex), 0.0f, 1.0f);
-
-    uint32_t startBin = (bucketIndex == 0) ? 1u : edges[std::max(0, bucketIndex - 1)];
-    uint32_t endBin = edges[std::min<int>(bucketIndex, int(edges.size() - 1))];
-    if (endBin < startBin)
-        std::swap(endBin, startBin);
-
-    const double span = std::max(1.0, double(endBin) - double(startBin));
-    return double(startBin) + (double(bucketFrac) * span);
+    return std::abs(marker_center_hz(markerX));
 }
 
-double marker_center_hz(float markerX)
+// The radio transform runs on the audio thread, so it only follows the analysis frames this far;
+// the large FFT analysis sizes would add seconds of latency.
+constexpr uint32_t RadioMaxFftSize = 4096;
+
+uint32_t radio_fft_size()
 {
     auto& ctx = GetAudioContext();
-    const uint32_t frames = std::max(2u, ctx.audioAnalysisSettings.frames);
-    const double centerBin = marker_center_bin(markerX);
-    return centerBin * double(ctx.audioDeviceSettings.sampleRate) / double(frames);
+    return std::clamp(ctx.audioAnalysisSettings.frames, 2u, RadioMaxFftSize);
 }
 
+double marker_center_bin(float markerX)
+{
+    auto& ctx = GetAudioContext();
+    const uint32_t frames = radio_fft_size();
+    return marker_radio_hz(markerX) * double(frames) / double(std::max(1u, ctx.audioDeviceSettings.sampleRate));
+}
 
-void ensure_skirt_weights(double binHz, double widthHz, float skirtWidthRatio, float falloff)
+// UI thread; frees the pipeline the audio thread last handed back, and sends a new one when the
+// snapshot no longer fits the last one sent
+void radio_live_update_pipeline(RadioLiveState& live, const RadioPipelineParams& params)
 {
-    const double skirtWidthHz = widthHz * std::max(0.01f, skirtWidthRatio);
-    const uint32_t passBins = std::max(1u, uint32_t(std::round(widthHz / binHz)));
-    const uint32_t skirtBins = std::max(1u, uint32_t(std::round(skirtWidthHz / binHz)));
-    const uint32_t totalBins = passBins + (2u * skirtBins);
+    delete live.pRetired.exchange(nullptr, std::memory_order_acquire);
 
-    if (g_fft.cachedBinHz == binHz && g_fft.cachedWidthHz == widthHz && g_fft.cachedSkirtRatio == skirtWidthRatio && g_fft.cachedFalloff == falloff && g_fft.totalBins == totalBins)
+    if (live.built && radio_pipeline_fits(live.builtParams, params))
         return;
 
-    g_fft.cachedBinHz = binHz;
-    g_fft.cachedWidthHz = widthHz;
-    g_fft.cachedSkirtRatio = skirtWidthRatio;
-    g_fft.cachedFalloff = falloff;
-    g_fft.passBins = passBins;
-    g_fft.skirtBins = skirtBins;
-    g_fft.totalBins = totalBins;
-    g_fft.skirtWeights.assign(totalBins, 0.0f);
-
-    const float sigmaBins = std::max(1e-3f, float(skirtBins) / std::max(0.1f, falloff));
-    for (uint32_t i = 0; i < totalBins; ++i)
+    auto& ctx = GetAudioContext();
+    auto pipeline = std::make_unique<RadioPipeline>();
+    pipeline->meters = RadioAgcMeters{ &ctx.radioAgcPower, &ctx.radioAgcPowerOut, &ctx.radioOutAgcPower, &ctx.radioOutAgcPowerOut };
+    radio_pipeline_init(*pipeline, params);
+    live.builtParams = params;
+    live.built = true;
+
+    // One the audio thread never got to is out of date already
+    delete live.pPending.exchange(pipeline.release(), std::memory_order_acq_rel);
+}
+
+// Audio thread; swaps in a pending pipeline, once the UI has freed the last one handed back
+RadioPipeline* radio_live_pipeline(RadioLiveState& live)
+{
+    if (!live.pRetired.load(std::memory_order_acquire))
     {
-        float gain = 0.0f;
-        if (i < skirtBins)
+        if (auto* pPending = live.pPending.exchange(nullptr, std::memory_order_acq_rel))
         {
-            const float d = float(skirtBins - 1u - i);
-            const float x = d / sigmaBins;
-            gain = std::exp(-0.5f * x * x);
+            live.pRetired.store(live.pPipeline, std::memory_order_release);
+            live.pPipeline = pPending;
         }
-        else if (i < skirtBins + passBins)
-        {
-            gain = 1.0f;
-        }
-        else
-        {
-            const uint32_t tail = i - (skirtBins + passBins);
-            const float d = float(tail);
-            const float x = d / sigmaBins;
-            gain = std::exp(-0.5f * x * x);
-        }
-        g_fft.skirtWeights[i] = gain;
     }
+    return live.pPipeline;
 }
 
-void radio_fft_init(uint32_t fftSize, uint32_t segmentCount)
+
+void radio_receiver_reset(RadioReceiverState& receiver, const RadioFftState& fft)
 {
-    if (fftSize < 2)
-        return;
-    if (fftSize % 2 == 1)
-        fftSize -= 1;
+    const uint32_t fftSize = fft.fftSize;
+    receiver.skirt.skirtWeights.reserve(radio_skirt_max_bins(fft.sampleRate / double(fftSize)));
+    receiver.shifted.assign((fftSize / 2) + 1, FftComplex{ 0.0f, 0.0f });
+    receiver.outBlock.assign(fftSize, 0.0f);
+    receiver.olaSum.assign(fftSize, 0.0f);
+    receiver.ifftScratch.assign(fftSize / 2, FftComplex{ 0.0f, 0.0f });
+    receiver.agc = RadioAgcState{};
+    receiver.agc.meters.pOutPower = &receiver.power;
+}
 
-    auto& ctx = GetAudioContext();
+// One receiver's share of a hop, from the shared spectrum; runs on any of the bank's threads, and
+// only touches this receiver's state
+void radio_receiver_process_hop(RadioBankState& bank, uint32_t index, const RadioSettings& settings)
+{
+    PROFILE_SCOPE(radio_receiver_hop);
 
-    const uint32_t segments = std::max(1u, segmentCount);
-    if (fftSize % segments != 0)
-    {
-        fftSize -= (fftSize % segments);
-    }
-    if (fftSize < 2 * segments)
-        return;
+    const auto& receiverSettings = settings.receivers[index];
+    auto& receiver = bank.receivers[index];
+    auto& fft = bank.fft;
+    const uint32_t size = fft.fftSize;
 
-    if (g_fft.fftSize == fftSize && g_fft.hopDiv == segments && g_fft.cfgFwd && g_fft.cfgInv)
-        return;
+    const double binHz = (fft.sampleRate * 0.5) / double(size / 2);
+    const double widthHz = std::max(1.0, double(receiverSettings.widthHz));
+    ensure_skirt_weights(receiver.skirt, binHz, widthHz, std::max(0.1f, settings.skirtWidthRatio), std::max(0.1f, settings.skirtFalloff));
+    apply_bandpass_bins(receiver.skirt, fft.fftOut.data(), receiver.shifted.data(), size, fft.inWrite, binHz, double(receiverSettings.centerHz), double(receiverSettings.targetCenterHz));
 
-    if (g_fft.cfgFwd)
-    {
-        kiss_fft_free(g_fft.cfgFwd);
-        g_fft.cfgFwd = nullptr;
-    }
-    if (g_fft.cfgInv)
+    // Plans are immutable, so the receivers share one across threads; the scratch is their own
+    radio_fft_synthesize(fft, receiver.shifted.data(), receiver.ifftScratch.data(), receiver.agc, receiverSettings.agc, receiverSettings.gain, receiver.outBlock, receiver.olaSum);
+}
+
+void radio_bank_process_hop(RadioBankState& bank, const RadioSettings& settings)
+{
+    using namespace std::chrono;
+    PROFILE_SCOPE(radio_bank_hop);
+
+    const auto start = steady_clock::now();
+    radio_fft_forward(bank.fft, settings.inputAgc);
+    const auto forwardDone = steady_clock::now();
+
+    audio_analysis_parallel_for(bank.workers, bank.activeCount, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t active = begin; active < end; active++)
+        {
+            radio_receiver_process_hop(bank, bank.activeList[active], settings);
+        }
+    });
+
+    auto smooth = [](std::atomic<double>& value, double us) {
+        value.store((value.load(std::memory_order_relaxed) * 0.95) + (us * 0.05), std::memory_order_relaxed);
+    };
+    smooth(bank.forwardUs, double(duration_cast<nanoseconds>(forwardDone - start).count()) / 1000.0);
+    smooth(bank.receiversUs, double(duration_cast<nanoseconds>(steady_clock::now() - forwardDone).count()) / 1000.0);
+}
+
+// A block of input through the STFT; the output for each bus is the sum of its receivers'
+// overlap-adds, one hop behind the input as in radio_process_block
+void radio_bank_process_block(RadioBankState& bank, const RadioPipelineParams& params, const float* pInput, uint32_t sampleCount, float* pOutput)
+{
+    const auto& settings = params.settings;
+    auto& fft = bank.fft;
+    const uint32_t oldSize = fft.fftSize;
+    const uint32_t oldHopDiv = fft.hopDiv;
+    radio_fft_init(fft, params.fftSize, settings.fftHopDiv, params.sampleRate, params.fftBackend);
+    const bool resized = fft.fftSize != oldSize || fft.hopDiv != oldHopDiv;
+    bank.latencySeconds.store(radio_fft_latency_seconds(fft) + (double(RadioBankBlock) / params.sampleRate), std::memory_order_relaxed);
+
+    // Receivers start from silence when they are switched on, or when the transform changes
+    bank.activeCount = 0;
+    for (uint32_t index = 0; index < RadioMaxReceivers; index++)
     {
-        kiss_fft_free(g_fft.cfgInv);
-        g_fft.cfgInv = nullptr;
+        auto& receiver = bank.receivers[index];
+        const bool enabled = settings.receivers[index].enabled;
+        if (enabled && (!receiver.active || resized))
+        {
+            radio_receiver_reset(receiver, fft);
+        }
+        receiver.active = enabled;
+        if (enabled)
+        {
+            bank.activeList[bank.activeCount++] = index;
+        }
     }
+    bank.lastActive.store(bank.activeCount, std::memory_order_relaxed);
 
-    g_fft.fftSize = fftSize;
-    g_fft.hopDiv = segments;
-    g_fft.hopSize = std::max(1u, fftSize / segments);
-    g_fft.cfgFwd = kiss_fft_alloc(int(fftSize), 0, 0, 0);
-    g_fft.cfgInv = kiss_fft_alloc(int(fftSize), 1, 0, 0);
-    g_fft.window.resize(fftSize);
-    g_fft.olaScale.resize(fftSize, 1.0f);
-    g_fft.fftIn.assign(fftSize, 0.0f);
-    g_fft.fftInCpx.assign(fftSize, kiss_fft_cpx{});
-    g_fft.fftOut.assign(fftSize, kiss_fft_cpx{});
-    g_fft.fftShifted.assign(fftSize, kiss_fft_cpx{});
-    g_fft.fftBins.assign(fftSize, 0.0f);
-    g_fft.ifftOut.assign(fftSize, kiss_fft_cpx{});
-    ring_buffer_init(g_fft.ring, fftSize);
-    g_fft.outBuffer.assign(fftSize, 0.0f);
-    g_fft.outRead = 0;
-    g_fft.outWrite = 0;
-
-    // Hann window for smooth spectral bins
-    for (uint32_t i = 0; i < fftSize; ++i)
+    std::fill_n(pOutput, size_t(RadioMaxBuses) * RadioBankBlock, 0.0f);
+    if (!fft.planFwd || !fft.planInv || fft.hopSize == 0)
     {
-        g_fft.window[i] = 0.5f * (1.0f - std::cos(2.0f * 3.14159265358979323846f * (i / float(fftSize - 1))));
+        return;
     }
 
-    const uint32_t overlapCount = std::max(1u, segments);
-    for (uint32_t i = 0; i < fftSize; ++i)
+    const uint32_t hop = fft.hopSize;
+    for (uint32_t done = 0; done < sampleCount;)
     {
-        float sum = 0.0f;
-        for (uint32_t k = 0; k < overlapCount; ++k)
+        const uint32_t count = std::min(sampleCount - done, hop - fft.hopFill);
+        std::copy_n(pInput + done, count, fft.inFrame.data() + fft.inWrite + fft.hopFill);
+
+        for (uint32_t active = 0; active < bank.activeCount; active++)
+        {
+            const uint32_t index = bank.activeList[active];
+            float* pOla = bank.receivers[index].olaSum.data() + fft.olaRead + fft.hopFill;
+            float* pBus = pOutput + (size_t(settings.receivers[index].bus % RadioMaxBuses) * RadioBankBlock) + done;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                pBus[i] += pOla[i];
+                pOla[i] = 0.0f;
+            }
+        }
+
+        fft.hopFill += count;
+        done += count;
+
+        if (fft.hopFill == hop)
         {
-            const uint32_t idx = (i + k * g_fft.hopSize) % fftSize;
-            const float w = g_fft.window[idx];
-            sum += w * w;
+            fft.hopFill = 0;
+            fft.inWrite = (fft.inWrite + hop) % fft.fftSize;
+            fft.olaRead = (fft.olaRead + hop) % fft.fftSize;
+            radio_bank_process_hop(bank, settings);
         }
-        g_fft.olaScale[i] = sum > 1e-6f ? (1.0f / sum) : 1.0f;
     }
 }
 
-void apply_bandpass_filter()
+void radio_bank_thread(RadioBankState& bank)
 {
-    PROFILE_SCOPE(apply_bandpass_filter);
+#ifdef DEBUG
+    Zest::Profiler::NameThread("Radio Receivers");
+#endif
 
-    auto& ctx = GetAudioContext();
-    // Band-pass using waterfall marker (center + width)
-    const auto& wf = Waterfall_Get();
-    const double sampleRate = double(ctx.audioDeviceSettings.sampleRate);
-    const double maxHz = sampleRate * 0.5;
-    const double markerCenterHz = marker_center_hz(wf.markerX);
-    const double binHz = maxHz / double(g_fft.fftSize / 2);
-
-    const double centerBin = markerCenterHz / binHz;
-    const double targetCenterHz = double(GetRadioSettings().targetCenterHz);
-    const double targetCenterBin = targetCenterHz / binHz;
-    const int64_t lowSkirtBin = int64_t(std::floor(centerBin - (double(g_fft.totalBins) * 0.5)));
-    const int64_t shiftBins = int64_t(std::llround(targetCenterBin - centerBin));
-    const int64_t halfBins = int64_t(g_fft.fftSize / 2);
-
-    for (uint32_t b = 0; b < g_fft.fftShifted.size(); ++b)
+    for (;;)
     {
-        g_fft.fftShifted[b].r = 0.0f;
-        g_fft.fftShifted[b].i = 0.0f;
-    }
+        bank.wake.acquire();
+        if (bank.quit.load())
+        {
+            break;
+        }
 
-    const uint32_t maxBins = std::min<uint32_t>(g_fft.totalBins, uint32_t(g_fft.fftShifted.size()));
-    for (uint32_t i = 0; i < maxBins; ++i)
-    {
-        const int64_t srcBin = lowSkirtBin + int64_t(i);
-        if (srcBin < 0 || srcBin > halfBins)
-            continue;
+        uint32_t count = 0;
+        while (const float* pInput = sample_ring_read_begin(bank.inRing, count))
+        {
+            // Published before the block, so never missing; at worst a block or two newer than it
+            const auto& params = *triple_buffer_read(bank.params);
+
+            // Keep the filters moving even if the audio thread has stopped taking output
+            float* pOutput = sample_ring_write_begin(bank.outRing);
+            radio_bank_process_block(bank, params, pInput, count, pOutput ? pOutput : bank.discard.data());
+            sample_ring_read_end(bank.inRing);
+            if (pOutput)
+            {
+                sample_ring_write_end(bank.outRing, RadioMaxBuses * RadioBankBlock);
+            }
+        }
+    }
+}
 
-        const int64_t dstBin = srcBin + shiftBins;
-        if (dstBin < 0 || dstBin > halfBins)
-            continue;
+// Audio thread; hands input channel 0 to the bank and mixes the returned buses into the output
+void radio_bank_io(RadioBankState& bank, const RadioPipelineParams& params, const float* pInput, uint32_t inStride, float* pOutput, uint32_t outStride, uint32_t sampleCount)
+{
+    PROFILE_SCOPE(radio_bank_io);
+    RT_CHECK_SCOPE(radio_bank_io);
 
-        const float gain = g_fft.skirtWeights[i];
-        g_fft.fftShifted[dstBin].r = g_fft.fftOut[srcBin].r * gain;
-        g_fft.fftShifted[dstBin].i = g_fft.fftOut[srcBin].i * gain;
+    const auto& settings = params.settings;
+    if (!bank.running.load(std::memory_order_acquire))
+    {
+        return;
     }
 
-    if (g_fft.fftSize > 0)
+    const bool anyEnabled = std::any_of(settings.receivers.begin(), settings.receivers.end(), [](const auto& receiver) {
+        return receiver.enabled;
+    });
+    if (!anyEnabled)
     {
-        g_fft.fftShifted[0].i = 0.0f;
+        bank.idle = true;
+        return;
     }
-    if (halfBins > 0 && halfBins < int64_t(g_fft.fftShifted.size()))
+
+    // Whatever was in flight when the bank went idle is stale
+    if (bank.idle)
     {
-        g_fft.fftShifted[halfBins].i = 0.0f;
+        bank.idle = false;
+        bank.skipBlocks += bank.inFlight;
+        bank.inFlight = 0;
     }
-    for (int64_t k = 1; k < halfBins; ++k)
+
+    const uint32_t buses = std::min(outStride, RadioMaxBuses);
+    for (uint32_t done = 0; done < sampleCount;)
     {
-        const int64_t mirror = int64_t(g_fft.fftSize) - k;
-        g_fft.fftShifted[mirror].r = g_fft.fftShifted[k].r;
-        g_fft.fftShifted[mirror].i = -g_fft.fftShifted[k].i;
-    }
+        if (bank.fill == 0 && !bank.pInBlock)
+        {
+            // Full; the bank is far behind, and the ring has counted the drop
+            bank.pInBlock = sample_ring_write_begin(bank.inRing);
+        }
 
-    g_fft.fftOut.swap(g_fft.fftShifted);
-}
+        const uint32_t count = std::min(sampleCount - done, RadioBankBlock - bank.fill);
+        const float* pSrc = pInput + (size_t(done) * inStride);
+        if (bank.pInBlock)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                bank.pInBlock[bank.fill + i] = pSrc[i * inStride];
+            }
+        }
 
-void apply_agc_block(const std::vector<float>& input,
-                     const RadioSettings::AgcSettings& settings,
-                     float& agcPower,
-                     float& agcGain,
-                     std::atomic<float>* powerOut,
-                     std::atomic<float>* powerOutPost,
-                     std::vector<float>* applyBlock)
-{
-    if (input.empty())
-        return;
-    if (!settings.enabled)
-        return;
+        if (bank.pOutBlock)
+        {
+            float* pDst = pOutput + (size_t(done) * outStride);
+            for (uint32_t bus = 0; bus < buses; bus++)
+            {
+                const float* pBus = bank.pOutBlock + (size_t(bus) * RadioBankBlock) + bank.fill;
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    pDst[(i * outStride) + bus] += pBus[i];
+                }
+            }
+        }
 
-    PROFILE_SCOPE(apply_agc_block);
+        bank.fill += count;
+        done += count;
+        if (bank.fill < RadioBankBlock)
+        {
+            continue;
+        }
+        bank.fill = 0;
 
-    const uint32_t count = uint32_t(input.size());
-    double sum = 0.0;
-    double maxMag = 0.0;
-    for (uint32_t i = 0; i < count; ++i)
-    {
-        const double sample = input[i];
-        const double power = (sample * sample);
-        sum += power;
-        maxMag = std::max(maxMag, std::sqrt(power));
-    }
-    const double avgPower = sum / double(std::max(1u, count));
-    if (!std::isfinite(avgPower))
-        return;
+        if (bank.pInBlock)
+        {
+            triple_buffer_write(bank.params) = params;
+            triple_buffer_publish(bank.params);
+            sample_ring_write_end(bank.inRing, RadioBankBlock);
+            bank.pInBlock = nullptr;
+            bank.inFlight++;
+            bank.wake.release();
+        }
 
-    auto& ctx = GetAudioContext();
-    const float sampleRate = applyBlock ? float(ctx.outputState.sampleRate) : float(ctx.inputState.sampleRate);
-    const float blockSeconds = sampleRate > 0.0f ? (float(input.size()) / sampleRate) : 0.0f;
-    auto ms_to_coeff = [&](float ms) {
-        if (ms <= 0.0f || blockSeconds <= 0.0f)
-            return 1.0f;
-        const float tau = ms / 1000.0f;
-        const float coeff = 1.0f - std::exp(-blockSeconds / tau);
-        return std::clamp(coeff, 0.0f, 1.0f);
-    };
-    const float attack = ms_to_coeff(settings.attackMs);
-    const float release = ms_to_coeff(settings.releaseMs);
-    if (agcPower <= 0.0f)
-    {
-        agcPower = float(avgPower);
+        if (bank.pOutBlock)
+        {
+            sample_ring_read_end(bank.outRing);
+            bank.pOutBlock = nullptr;
+        }
+
+        uint32_t outCount = 0;
+        while (bank.skipBlocks > 0 && sample_ring_read_begin(bank.outRing, outCount))
+        {
+            sample_ring_read_end(bank.outRing);
+            bank.skipBlocks--;
+        }
+
+        // The newest block is still with the bank; the one before it plays next
+        if (bank.inFlight >= 2)
+        {
+            bank.pOutBlock = sample_ring_read_begin(bank.outRing, outCount);
+            if (!bank.pOutBlock)
+            {
+                bank.underruns.fetch_add(1, std::memory_order_relaxed);
+                bank.skipBlocks++;
+            }
+            bank.inFlight--;
+        }
     }
-    else
+}
+
+// Starts over when switched on or when the rate changes, rather than finishing a character from
+// before; cheap enough per sample to run inline on the audio thread. Only CW has a tone to follow.
+void radio_cw_process(RadioCwState& cw, const RadioSettings& settings, float sampleRate, const float* pOutput, uint32_t outStride, uint32_t sampleCount)
+{
+    if (!settings.cwDecoderEnabled || settings.demodMode != RadioDemodMode::Cw)
     {
-        const float coeff = avgPower > agcPower ? attack : release;
-        agcPower = agcPower + coeff * float(avgPower - agcPower);
+        cw.running = false;
+        return;
     }
-    if (powerOut)
+
+    if (!cw.running || cw.sampleRate != sampleRate)
     {
-        powerOut->store(agcPower, std::memory_order_relaxed);
+        cw_decoder_init(cw.decoder, sampleRate, settings.cwInitialWpm);
+        cw.sampleRate = sampleRate;
+        cw.running = true;
     }
+    cw_decoder_set_tone(cw.decoder, settings.targetCenterHz);
+    cw_decoder_process(cw.decoder, pOutput, sampleCount, outStride);
+}
 
-    const double power = std::max<double>(agcPower, 1e-12);
-    const double rms = std::sqrt(avgPower);
-    const double crest = std::clamp(maxMag / std::max(rms, 1e-12), 1.0, 20.0);
-    const double targetLinear = std::pow(10.0, double(settings.targetDb) / 20.0);
-    double desired = targetLinear / std::sqrt(power);
-    desired /= std::sqrt(crest);
-    desired = std::clamp(desired, 0.05, 50.0);
+} // namespace
 
-    const float gainCoeff = desired < agcGain ? attack : release;
-    agcGain = agcGain + gainCoeff * float(desired - agcGain);
+RadioPipelineParams radio_live_params(const RadioSettings& settings)
+{
+    auto& ctx = GetAudioContext();
+    RadioPipelineParams params;
+    params.settings = settings;
+    params.sampleRate = double(std::max(1u, ctx.audioDeviceSettings.sampleRate));
+    params.markerHz = marker_radio_hz(Waterfall_Get().markerX);
+    params.fftSize = radio_fft_size();
+    params.blockFrames = ctx.audioDeviceSettings.frames;
+    params.fftBackend = fft_get_backend();
+    return params;
+}
 
-    if (powerOutPost)
+void radio_receivers_start()
+{
+    auto& bank = g_bank;
+    if (bank.running.load())
     {
-        powerOutPost->store(agcPower * (agcGain * agcGain), std::memory_order_relaxed);
+        return;
     }
 
-    if (applyBlock)
+    bank.discard.assign(size_t(RadioMaxBuses) * RadioBankBlock, 0.0f);
+    sample_ring_init(bank.inRing, RadioBankBlock, RadioBankRingBlocks);
+    sample_ring_init(bank.outRing, RadioMaxBuses * RadioBankBlock, RadioBankRingBlocks);
+
+    // The bank thread helps with its own jobs, so the workers are the extra hands
+    const auto workerCount = std::clamp(std::thread::hardware_concurrency() / 4, 1u, 3u);
+    audio_analysis_scheduler_start(bank.workers, workerCount, {});
+
+    bank.quit = false;
+    bank.thread = std::thread([&bank]() {
+        radio_bank_thread(bank);
+    });
+    bank.running.store(true, std::memory_order_release);
+}
+
+void radio_receivers_stop()
+{
+    auto& bank = g_bank;
+    if (!bank.running.load())
     {
-        for (float& sample : *applyBlock)
-        {
-            sample *= agcGain;
-        }
+        return;
     }
+
+    // The rings stay allocated; the audio thread may be part way through a callback
+    bank.running.store(false, std::memory_order_release);
+    bank.quit = true;
+    bank.wake.release();
+    bank.thread.join();
+    audio_analysis_scheduler_stop(bank.workers);
 }
 
-void apply_input_agc(const std::vector<float>& input)
+RadioReceiverStats radio_receivers_stats()
 {
-    PROFILE_SCOPE(apply_input_agc);
-    auto& ctx = GetAudioContext();
-    apply_agc_block(input, GetRadioSettings().inputAgc, g_fft.agcPower, g_fft.agcGain, &ctx.radioAgcPower, &ctx.radioAgcPowerOut, nullptr);
+    const auto& bank = g_bank;
+
+    RadioReceiverStats stats;
+    stats.activeReceivers = bank.lastActive.load(std::memory_order_relaxed);
+    stats.forwardUs = bank.forwardUs.load(std::memory_order_relaxed);
+    stats.receiversUs = bank.receiversUs.load(std::memory_order_relaxed);
+    stats.latencyMs = bank.latencySeconds.load(std::memory_order_relaxed) * 1000.0;
+    stats.underruns = bank.underruns.load(std::memory_order_relaxed);
+    stats.droppedBlocks = bank.inRing.droppedBlocks.load(std::memory_order_relaxed);
+    return stats;
 }
 
-void apply_output_agc_block(std::vector<float>& block)
+float radio_receiver_power(uint32_t index)
 {
-    PROFILE_SCOPE(apply_output_agc);
-    auto& ctx = GetAudioContext();
-    apply_agc_block(block, GetRadioSettings().outputAgc, g_fft.outAgcPower, g_fft.outAgcGain, &ctx.radioOutAgcPower, &ctx.radioOutAgcPowerOut, &block);
+    return index < RadioMaxReceivers ? g_bank.receivers[index].power.load(std::memory_order_relaxed) : 0.0f;
 }
 
-} // namespace
-
 double radio_marker_center_hz()
 {
     return marker_center_hz(Waterfall_Get().markerX);
@@ -370,24 +540,35 @@ double radio_marker_center_hz()
 
 bool radio_get_bandpass_skirt(RadioBandpassSkirtView& out)
 {
-    if (g_fft.skirtWeights.empty() || g_fft.totalBins == 0)
+    // Laid out again here from the settings, as the engines do, rather than read from the audio
+    // thread; the FIR chain has no bins to show
+    const auto& settings = GetRadioSettings();
+    if (radio_engine_mode(settings) == RadioFilterMode::Fir)
+        return false;
+
+    auto& ctx = GetAudioContext();
+    auto& skirt = g_radio.skirt;
+    const double binHz = double(std::max(1u, ctx.audioDeviceSettings.sampleRate)) / double(radio_fft_size());
+    ensure_skirt_weights(skirt, binHz, std::max(1.0, double(settings.markerWidthHz)), std::max(0.1f, settings.skirtWidthRatio), std::max(0.1f, settings.skirtFalloff));
+    if (skirt.skirtWeights.empty() || skirt.totalBins == 0)
         return false;
 
     const double centerBin = marker_center_bin(Waterfall_Get().markerX);
-    const double lowSkirtBin = std::floor(centerBin - (double(g_fft.totalBins) * 0.5));
+    const double lowSkirtBin = std::floor(centerBin - (double(skirt.totalBins) * 0.5));
     const double centerIndex = centerBin - lowSkirtBin;
 
-    out.weights = g_fft.skirtWeights.data();
-    out.totalBins = g_fft.totalBins;
-    out.passBins = g_fft.passBins;
-    out.skirtBins = g_fft.skirtBins;
-    out.centerIndex = float(std::clamp(centerIndex, 0.0, double(std::max<uint32_t>(1u, g_fft.totalBins) - 1)));
+    out.weights = skirt.skirtWeights.data();
+    out.totalBins = skirt.totalBins;
+    out.passBins = skirt.passBins;
+    out.skirtBins = skirt.skirtBins;
+    out.centerIndex = float(std::clamp(centerIndex, 0.0, double(std::max<uint32_t>(1u, skirt.totalBins) - 1)));
     return true;
 }
 
 void radio_process(const std::chrono::microseconds time, const float* pInput, float* pOutput, uint32_t sampleCount)
 {
     PROFILE_SCOPE(radio_process);
+    RT_CHECK_SCOPE(radio_process);
 
     auto& ctx = GetAudioContext();
     (void)time;
@@ -399,93 +580,229 @@ void radio_process(const std::chrono::microseconds time, const float* pInput, fl
         return;
     }
 
-    const uint32_t fftSize = std::max(2u, ctx.audioAnalysisSettings.frames);
-    const auto& settings = GetRadioSettings();
-    radio_fft_init(fftSize, settings.fftHopDiv);
-
     const uint32_t inStride = std::max(1u, ctx.inputState.channelCount);
     const uint32_t outStride = std::max(1u, ctx.outputState.channelCount);
 
-    for (uint32_t i = 0; i < sampleCount; i++)
+    // Silent until the UI has sent the first pipeline
+    auto* pPipeline = radio_live_pipeline(g_radio);
+    if (!pPipeline)
     {
-        const float sample = pInput[i * inStride];
-        float outSample = 0.0f;
-        if (!g_fft.outBuffer.empty())
+        for (uint32_t i = 0; i < sampleCount; i++)
         {
-            outSample = g_fft.outBuffer[g_fft.outRead];
-            g_fft.outBuffer[g_fft.outRead] = 0.0f;
-            g_fft.outRead = (g_fft.outRead + 1) % g_fft.fftSize;
+            pOutput[i * outStride] = 0.0f;
         }
-        pOutput[(i * outStride)] = outSample;
+        return;
+    }
 
-        if (g_fft.cfgFwd && g_fft.cfgInv && g_fft.hopSize > 0)
-        {
-            ring_buffer_add(g_fft.ring, sample);
+    // A snapshot can land just ahead of the pipeline sized for it; until then the last one that
+    // fits carries on
+    const auto* pParams = triple_buffer_read(g_radio.params);
+    if (pParams && radio_pipeline_fits(pPipeline->params, *pParams))
+    {
+        radio_pipeline_set_params(*pPipeline, *pParams);
+    }
 
-            const size_t available = ring_buffer_size(g_fft.ring);
-            if (available >= g_fft.fftSize)
-            {
-                PROFILE_SCOPE(radio_fft_update);
+    // Only taken once it matches the pipeline's sizes and differs from what it has
+    if (const auto* pResponse = triple_buffer_read(g_radio.convResponse))
+    {
+        radio_pipeline_set_conv_response(*pPipeline, *pResponse);
+    }
+    const auto& params = pPipeline->params;
+    radio_pipeline_process(*pPipeline, pInput, pOutput, sampleCount, inStride, outStride);
+    g_radio.latencySeconds.store(radio_pipeline_latency_seconds(*pPipeline), std::memory_order_relaxed);
 
-                ring_buffer_assign_ordered(g_fft.ring, g_fft.fftIn, g_fft.fftSize);
-                ring_buffer_drain_n(g_fft.ring, g_fft.hopSize);
+    radio_cw_process(g_cw, params.settings, float(params.sampleRate), pOutput, outStride, sampleCount);
+    radio_bank_io(g_bank, params, pInput, inStride, pOutput, outStride, sampleCount);
+}
 
-                if (settings.inputAgc.enabled)
-                {
-                    apply_input_agc(g_fft.fftIn);
-                }
+void radio_publish_params()
+{
+    // The response goes first, so the latest one is always for these params whichever pipeline
+    // reads it; then the pipeline, so the snapshot never arrives long before it
+    const auto params = radio_live_params(GetRadioSettings());
+    if (radio_engine_mode(params.settings) == RadioFilterMode::Partitioned && radio_conv_design(g_radio.designer, params))
+    {
+        triple_buffer_write(g_radio.convResponse) = g_radio.designer.response;
+        triple_buffer_publish(g_radio.convResponse);
+    }
+    radio_live_update_pipeline(g_radio, params);
+    triple_buffer_write(g_radio.params) = params;
+    triple_buffer_publish(g_radio.params);
+}
 
-                for (uint32_t n = 0; n < g_fft.fftSize; ++n)
-                {
-                    const float sampleIn = g_fft.fftIn[n] * g_fft.window[n] * g_fft.agcGain;
-                    g_fft.fftInCpx[n].r = sampleIn;
-                    g_fft.fftInCpx[n].i = 0.0f;
-                }
+uint32_t radio_cw_read_text(char* pOut, uint32_t maxCount)
+{
+    return cw_text_queue_pop(g_cw.decoder.text, pOut, maxCount);
+}
 
-                kiss_fft(g_fft.cfgFwd, g_fft.fftInCpx.data(), g_fft.fftOut.data());
+float radio_cw_wpm()
+{
+    return g_cw.running ? g_cw.decoder.wpm.load(std::memory_order_relaxed) : 0.0f;
+}
 
-                {
-                    const double sampleRate = double(ctx.audioDeviceSettings.sampleRate);
-                    const double maxHz = sampleRate * 0.5;
-                    const double binHz = maxHz / double(g_fft.fftSize / 2);
-                    const double markerWidthHz = std::max(1.0, double(settings.markerWidthHz));
-                    const float skirtWidthRatio = std::max(0.1f, settings.skirtWidthRatio);
-                    const float skirtFalloff = std::max(0.1f, settings.skirtFalloff);
-                    ensure_skirt_weights(binHz, markerWidthHz, skirtWidthRatio, skirtFalloff);
-                }
+float radio_cw_snr_db()
+{
+    return g_cw.running ? g_cw.decoder.snrDb.load(std::memory_order_relaxed) : 0.0f;
+}
 
-                if (settings.enableFilter)
-                {
-                    apply_bandpass_filter();
-                }
+const char* radio_filter_mode_name(RadioFilterMode mode)
+{
+    switch (mode)
+    {
+        case RadioFilterMode::Stft:
+            return "STFT";
+        case RadioFilterMode::Fir:
+            return "FIR";
+        case RadioFilterMode::Partitioned:
+            return "Partitioned";
+        default:
+            return "?";
+    }
+}
 
-                for (uint32_t b = 0; b < g_fft.fftBins.size(); ++b)
-                {
-                    const float real = g_fft.fftOut[b].r;
-                    const float imag = g_fft.fftOut[b].i;
-                    g_fft.fftBins[b] = std::sqrt(real * real + imag * imag);
-                }
+const char* radio_demod_mode_name(RadioDemodMode mode)
+{
+    switch (mode)
+    {
+        case RadioDemodMode::Cw:
+            return "CW";
+        case RadioDemodMode::Usb:
+            return "USB";
+        case RadioDemodMode::Lsb:
+            return "LSB";
+        case RadioDemodMode::Am:
+            return "AM";
+        default:
+            return "?";
+    }
+}
 
-                kiss_fft(g_fft.cfgInv, g_fft.fftOut.data(), g_fft.ifftOut.data());
+double radio_latency_ms()
+{
+    return g_radio.latencySeconds.load(std::memory_order_relaxed) * 1000.0;
+}
 
-                g_fft.outBlock.resize(g_fft.fftSize);
-                for (uint32_t s = 0; s < g_fft.fftSize; ++s)
-                {
-                    g_fft.outBlock[s] = g_fft.ifftOut[s].r * g_fft.window[s] * g_fft.olaScale[s] / float(g_fft.fftSize);
-                }
+std::vector<RadioBenchmarkResult> radio_benchmark(RadioPipelineParams params, double secondsPerSize)
+{
+    using namespace std::chrono;
 
-                apply_output_agc_block(g_fft.outBlock);
+    // CW on each engine, then the phone modes, which always run on the FIR chain
+    struct BenchmarkMode
+    {
+        RadioFilterMode mode;
+        RadioDemodMode demod;
+    };
+    const BenchmarkMode modes[] = {
+        { RadioFilterMode::Stft, RadioDemodMode::Cw },
+        { RadioFilterMode::Fir, RadioDemodMode::Cw },
+        { RadioFilterMode::Partitioned, RadioDemodMode::Cw },
+        { RadioFilterMode::Fir, RadioDemodMode::Usb },
+        { RadioFilterMode::Fir, RadioDemodMode::Lsb },
+        { RadioFilterMode::Fir, RadioDemodMode::Am },
+    };
 
-                for (uint32_t s = 0; s < g_fft.fftSize; ++s)
-                {
-                    float sampleOut = g_fft.outBlock[s];
-                    const uint32_t outIdx = (g_fft.outWrite + s) % g_fft.fftSize;
-                
-                    g_fft.outBuffer[outIdx] += sampleOut * settings.outputGain;
-                }
+    const auto sampleRate = uint32_t(params.sampleRate);
+    const uint32_t total = std::max(1u, uint32_t(secondsPerSize * sampleRate));
+    std::vector<float> in(total);
+    std::vector<float> out(total);
+    for (uint32_t i = 0; i < total; i++)
+    {
+        in[i] = (0.3f * std::sin(float(i) * 0.1f)) + (0.01f * float((i * 7919u) % 1000u) / 1000.0f);
+    }
+
+    std::vector<RadioBenchmarkResult> results;
+    for (const auto& [mode, demod] : modes)
+    {
+        // A private pipeline, so the live one on the audio thread is left alone
+        auto pipeline = std::make_unique<RadioPipeline>();
+        params.settings.filterMode = mode;
+        params.settings.demodMode = demod;
+        for (uint32_t frames = 16; frames <= 1024; frames *= 2)
+        {
+            // The partitions follow the callback size, as they do live
+            params.blockFrames = frames;
+            radio_pipeline_init(*pipeline, params);
 
-                g_fft.outWrite = (g_fft.outWrite + g_fft.hopSize) % g_fft.fftSize;
+            const uint32_t callbacks = std::max(1u, total / frames);
+            const auto start = steady_clock::now();
+            for (uint32_t i = 0; i < callbacks; i++)
+            {
+                radio_pipeline_process(*pipeline, in.data() + (i * frames), out.data() + (i * frames), frames);
             }
+            const auto ns = double(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+
+            RadioBenchmarkResult result;
+            result.mode = mode;
+            result.demod = demod;
+            result.callbackFrames = frames;
+            result.nsPerSample = ns / double(callbacks * frames);
+            result.usPerCallback = ns / (1000.0 * callbacks);
+            result.latencyMs = radio_pipeline_latency_seconds(*pipeline) * 1000.0;
+            results.push_back(result);
         }
     }
+    return results;
+}
+
+RadioCwEvaluation radio_cw_evaluate(RadioPipelineParams params, const std::vector<float>& samples, const std::string& reference)
+{
+    using namespace std::chrono;
+
+    // Always the CW band pass, whatever the radio is set to now, on a private pipeline for the
+    // filter in use, fed in callback sized pieces as it would be live
+    params.settings.demodMode = RadioDemodMode::Cw;
+    params.blockFrames = std::max(16u, params.blockFrames);
+    const auto& settings = params.settings;
+    const auto sampleRate = uint32_t(params.sampleRate);
+    const uint32_t frames = params.blockFrames;
+
+    auto pipeline = std::make_unique<RadioPipeline>();
+    radio_pipeline_init(*pipeline, params);
+
+    RadioCwEvaluation result;
+    result.mode = pipeline->activeMode;
+
+    // A second of silence after the recording lets the last character out
+    std::vector<float> in(samples);
+    in.resize(samples.size() + sampleRate, 0.0f);
+    in.resize(((in.size() + frames - 1) / frames) * frames, 0.0f);
+    std::vector<float> out(in.size());
+
+    auto decoder = std::make_unique<CwDecoder>();
+    cw_decoder_init(*decoder, float(sampleRate), settings.cwInitialWpm);
+    cw_decoder_set_tone(*decoder, settings.targetCenterHz);
+
+    // Timed separately, so the decoder's share of the callback is visible
+    nanoseconds filterTime{ 0 };
+    nanoseconds decoderTime{ 0 };
+    std::array<char, CwTextQueueSize> text;
+    for (size_t offset = 0; offset < in.size(); offset += frames)
+    {
+        const float* pIn = in.data() + offset;
+        float* pOut = out.data() + offset;
+
+        const auto filterStart = steady_clock::now();
+        radio_pipeline_process(*pipeline, pIn, pOut, frames);
+        const auto decoderStart = steady_clock::now();
+        cw_decoder_process(*decoder, pOut, frames, 1);
+        const auto decoderEnd = steady_clock::now();
+        filterTime += duration_cast<nanoseconds>(decoderStart - filterStart);
+        decoderTime += duration_cast<nanoseconds>(decoderEnd - decoderStart);
+
+        const auto count = cw_text_queue_pop(decoder->text, text.data(), uint32_t(text.size()));
+        result.text.append(text.data(), count);
+    }
+
+    const auto total = double(std::max<size_t>(1, in.size()));
+    result.seconds = double(samples.size()) / double(sampleRate);
+    result.filterNsPerSample = double(filterTime.count()) / total;
+    result.decoderNsPerSample = double(decoderTime.count()) / total;
+    result.realtimeFactor = 1e9 / (double(sampleRate) * std::max(1e-3, result.filterNsPerSample + result.decoderNsPerSample));
+    result.wpm = decoder->wpm.load(std::memory_order_relaxed);
+    result.snrDb = decoder->snrDb.load(std::memory_order_relaxed);
+    if (!reference.empty())
+    {
+        result.characterErrorRate = cw_character_error_rate(result.text, reference);
+    }
+    return result;
 }
@@ -1,9 +1,18 @@
 #pragma once
 #include <chrono>
 #include <cstdint>
+#include <string>
+#include <vector>
+
+#include "radio_pipeline.h"
+#include "radio_settings.h"
 
 void radio_process(const std::chrono::microseconds time, const float* pInput, float* pOutput, uint32_t sampleCount);
 
+// Snapshots the settings, device and marker for the audio thread; call from the UI thread, once
+// per frame
+void radio_publish_params();
+
 struct RadioBandpassSkirtView
 {
     const float* weights = nullptr;
@@ -14,4 +23,72 @@ struct RadioBandpassSkirtView
 };
 
 bool radio_get_bandpass_skirt(RadioBandpassSkirtView& out);
-double radio_marker_center_hz();
\ No newline at end of file
+double radio_marker_center_hz();
+
+// What the marker receiver runs with now: the settings, the device, and where the marker is.
+// UI thread only; it reads the waterfall and the analysis channels.
+RadioPipelineParams radio_live_params(const RadioSettings& settings);
+
+const char* radio_filter_mode_name(RadioFilterMode mode);
+const char* radio_demod_mode_name(RadioDemodMode mode);
+
+// Input to output delay of the filter that is running, from its current design
+double radio_latency_ms();
+
+// Times the radio DSP on a private pipeline, with the given snapshot, at callback sizes from 16
+// to 1024 frames; CW on each engine, then each phone mode. Runs on any thread.
+struct RadioBenchmarkResult
+{
+    RadioFilterMode mode = RadioFilterMode::Stft;
+    RadioDemodMode demod = RadioDemodMode::Cw;
+    uint32_t callbackFrames = 0;
+    double nsPerSample = 0.0;
+    double usPerCallback = 0.0;
+    double latencyMs = 0.0;
+};
+
+std::vector<RadioBenchmarkResult> radio_benchmark(RadioPipelineParams params, double secondsPerSize);
+
+// The extra receivers in RadioSettings::receivers run on a thread of their own, which shares one
+// forward transform between them and spreads their inverse transforms over a few workers. Their
+// output is mixed into the output channels a block after the marker receiver's.
+void radio_receivers_start();
+void radio_receivers_stop();
+
+struct RadioReceiverStats
+{
+    uint32_t activeReceivers = 0;
+    double forwardUs = 0.0;   // Per hop, paid once for all receivers
+    double receiversUs = 0.0; // Per hop, for all of them together
+    double latencyMs = 0.0;
+    uint64_t underruns = 0;     // Blocks the bank returned too late to play
+    uint64_t droppedBlocks = 0; // Input blocks it had no room for
+};
+
+RadioReceiverStats radio_receivers_stats();
+
+// Output AGC power of a receiver, for a meter
+float radio_receiver_power(uint32_t index);
+
+// Text from the Morse decoder on the marker receiver, in the order it was decoded
+uint32_t radio_cw_read_text(char* pOut, uint32_t maxCount);
+float radio_cw_wpm();
+float radio_cw_snr_db();
+
+// Runs a recording at the snapshot's rate through a private copy of its filter and a decoder,
+// as the audio thread would, and times both; runs on any thread. With a reference text, the character error rate is
+// measured against it.
+struct RadioCwEvaluation
+{
+    RadioFilterMode mode = RadioFilterMode::Stft;
+    std::string text;
+    double characterErrorRate = -1.0; // Without a reference
+    float wpm = 0.0f;
+    float snrDb = 0.0f;
+    double seconds = 0.0; // Of the recording
+    double filterNsPerSample = 0.0;
+    double decoderNsPerSample = 0.0;
+    double realtimeFactor = 0.0; // Recording time over processing time
+};
+
+RadioCwEvaluation radio_cw_evaluate(RadioPipelineParams params, const std::vector<float>& samples, const std::string& reference);
@@ -0,0 +1,1213 @@
+#include "radio_pipeline.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <glm/gtc/constants.hpp>
+#include <zest/time/profiler.h>
+#include <zing/audio/rt_check.h>
+#include <zing/audio/spectral_kernels.h>
+
+using namespace Zing;
+
+namespace
+{
+
+constexpr double RadioAmCarrierSeconds = 0.1; // Slow enough that speech doesn't move the carrier level
+constexpr double RadioSsbTransitionHz = 300.0; // Widest SSB channel edge; past the carrier is the other sideband
+constexpr float RadioConvFloorGain = 1e-5f;     // -100dB; where the skirt reaches zero
+constexpr double RadioConvTailEnergy = 1e-7;    // The response is cut once the rest is below -70dB
+constexpr double RadioNoiseWindowSeconds = 1.5;  // Longer than a pause in the keying or speech
+constexpr double RadioNoiseSmoothSeconds = 0.03; // Of the power the minimum is taken over; well inside a gap
+constexpr double RadioNoisePriorSeconds = 0.4;   // Decision-directed memory; longer is less musical
+constexpr float RadioNoiseBias = 2.5f;           // The minimum of smoothed noise sits below its mean
+constexpr float RadioNoiseMaxAttenDb = 30.0f;    // Gain floor at full strength
+
+void apply_bandpass_filter(RadioFftState& state, const RadioPipelineParams& params)
+{
+    PROFILE_SCOPE(apply_bandpass_filter);
+
+    // Band-pass around the marker (center + width)
+    const double maxHz = state.sampleRate * 0.5;
+    const double binHz = maxHz / double(state.fftSize / 2);
+
+    apply_bandpass_bins(state.skirt, state.fftOut.data(), state.fftShifted.data(), state.fftSize, state.inWrite, binHz, params.markerHz, double(params.settings.targetCenterHz));
+    state.fftOut.swap(state.fftShifted);
+}
+
+// Sizes the estimator for the bins, and the smoothing for the hop; only reallocates for a new size
+void radio_noise_setup(RadioNoiseState& noise, uint32_t bins, double hopSeconds)
+{
+    if (noise.bins == bins && noise.hopSeconds == hopSeconds)
+        return;
+
+    const double subSeconds = RadioNoiseWindowSeconds / double(RadioNoiseSubWindows);
+    noise.subFrames = std::max(1u, uint32_t(std::ceil(subSeconds / hopSeconds)));
+    noise.powerCoeff = float(std::exp(-hopSeconds / RadioNoiseSmoothSeconds));
+    noise.priorCoeff = float(std::exp(-hopSeconds / RadioNoisePriorSeconds));
+    noise.hopSeconds = hopSeconds;
+    if (noise.bins != bins)
+    {
+        noise.bins = bins;
+        noise.power.assign(bins, 0.0f);
+        noise.smoothed.assign(bins, 0.0f);
+        noise.subMin.assign(bins, 0.0f);
+        noise.windowMin.assign(size_t(bins) * RadioNoiseSubWindows, 0.0f);
+        noise.floorMin.assign(bins, 0.0f);
+        noise.clean.assign(bins, 0.0f);
+        noise.gain.assign(bins, 1.0f);
+        noise.smoothGain.assign(bins, 1.0f);
+    }
+    noise.primed = false;
+}
+
+// The bins the band pass leaves non-zero, as [first, first + count)
+void radio_bandpass_bin_range(const RadioFftState& state, const RadioPipelineParams& params, uint32_t& first, uint32_t& count)
+{
+    const uint32_t halfBins = state.fftSize / 2;
+    first = 0;
+    count = halfBins + 1;
+    if (!params.settings.enableFilter)
+        return;
+
+    // As apply_bandpass_bins lays the skirt out
+    const double binHz = state.sampleRate * 0.5 / double(halfBins);
+    const double centerBin = params.markerHz / binHz;
+    const int64_t lowBin = int64_t(std::floor(centerBin - (double(state.skirt.totalBins) * 0.5))) + int64_t(std::llround((double(params.settings.targetCenterHz) / binHz) - centerBin));
+    const int64_t low = std::clamp<int64_t>(lowBin, 0, halfBins);
+    const int64_t high = std::clamp<int64_t>(lowBin + int64_t(state.skirt.totalBins), 0, halfBins + 1);
+    first = uint32_t(low);
+    count = uint32_t(std::max<int64_t>(high - low, 0));
+}
+
+// Runs on the filtered bins, so only the band pass is cleaned up, and only its bins are worked on;
+// the rest are zero. The estimator keeps every bin, so those outside carry old levels, and after a
+// retune the estimate takes a window to settle on the new ones. Every loop is a straight pass
+// over float arrays, with no branches, so they vectorize.
+void apply_noise_reduction(RadioFftState& state, const RadioPipelineParams& params)
+{
+    PROFILE_SCOPE(apply_noise_reduction);
+
+    auto& noise = state.noise;
+    radio_noise_setup(noise, (state.fftSize / 2) + 1, double(state.hopSize) / state.sampleRate);
+
+    uint32_t first = 0;
+    uint32_t bins = 0;
+    radio_bandpass_bin_range(state, params, first, bins);
+    if (bins < 3)
+        return;
+
+    float* pPower = noise.power.data() + first;
+    float* pSmoothed = noise.smoothed.data() + first;
+    float* pSubMin = noise.subMin.data() + first;
+    float* pFloorMin = noise.floorMin.data() + first;
+    float* pClean = noise.clean.data() + first;
+    float* pGain = noise.gain.data() + first;
+    float* pSmoothGain = noise.smoothGain.data() + first;
+    const uint32_t stride = noise.bins;
+
+    spectral_power(state.fftOut.data() + first, pPower, bins, 1.0f);
+
+    if (!noise.primed)
+    {
+        // Start from this hop as the noise, which the window then whittles down
+        std::copy_n(pPower, bins, pSmoothed);
+        std::copy_n(pPower, bins, pSubMin);
+        std::copy_n(pPower, bins, pClean);
+        std::fill(noise.windowMin.begin(), noise.windowMin.end(), std::numeric_limits<float>::max());
+        std::fill(noise.floorMin.begin(), noise.floorMin.end(), std::numeric_limits<float>::max());
+        noise.subFill = 0;
+        noise.subIndex = 0;
+        noise.primed = true;
+    }
+    else
+    {
+        const float coeff = noise.powerCoeff;
+        for (uint32_t i = 0; i < bins; i++)
+        {
+            pSmoothed[i] = (coeff * pSmoothed[i]) + ((1.0f - coeff) * pPower[i]);
+            pSubMin[i] = std::min(pSubMin[i], pSmoothed[i]);
+        }
+    }
+
+    // A sub-window done; its minimum replaces the oldest, and the floor is the least of them
+    if (++noise.subFill >= noise.subFrames)
+    {
+        std::copy_n(pSubMin, bins, noise.windowMin.data() + (size_t(noise.subIndex) * stride) + first);
+        noise.subIndex = (noise.subIndex + 1) % RadioNoiseSubWindows;
+        noise.subFill = 0;
+
+        std::copy_n(noise.windowMin.data() + first, bins, pFloorMin);
+        for (uint32_t row = 1; row < RadioNoiseSubWindows; row++)
+        {
+            const float* pRow = noise.windowMin.data() + (size_t(row) * stride) + first;
+            for (uint32_t i = 0; i < bins; i++)
+            {
+                pFloorMin[i] = std::min(pFloorMin[i], pRow[i]);
+            }
+        }
+        std::copy_n(pSmoothed, bins, pSubMin);
+    }
+
+    // Decision-directed prior SNR: mostly the last hop's cleaned power, plus what this hop shows
+    // over the noise. The gain is written as 1 - 1/(1 + snr) so a huge SNR goes to 1, not inf/inf.
+    const float prior = noise.priorCoeff;
+    const float gainFloor = std::pow(10.0f, -params.settings.noiseReduction * RadioNoiseMaxAttenDb / 20.0f);
+    for (uint32_t i = 0; i < bins; i++)
+    {
+        const float level = std::max(RadioNoiseBias * std::min(pFloorMin[i], pSubMin[i]), 1e-12f);
+        const float inv = 1.0f / level;
+        const float post = std::max((pPower[i] * inv) - 1.0f, 0.0f);
+        const float snr = (prior * pClean[i] * inv) + ((1.0f - prior) * post);
+        const float gain = std::max(1.0f - (1.0f / (1.0f + snr)), gainFloor);
+        pClean[i] = gain * gain * pPower[i];
+        pGain[i] = gain;
+    }
+
+    // Smoothed across neighbouring bins, then applied
+    pSmoothGain[0] = pGain[0];
+    pSmoothGain[bins - 1] = pGain[bins - 1];
+    for (uint32_t i = 1; i < bins - 1; i++)
+    {
+        pSmoothGain[i] = (0.25f * pGain[i - 1]) + (0.5f * pGain[i]) + (0.25f * pGain[i + 1]);
+    }
+
+    auto* pBins = state.fftOut.data() + first;
+    for (uint32_t i = 0; i < bins; i++)
+    {
+        pBins[i].r *= pSmoothGain[i];
+        pBins[i].i *= pSmoothGain[i];
+    }
+}
+
+void apply_input_agc(RadioAgcState& agc, const RadioSettings::AgcSettings& settings, double sampleRate, const std::vector<float>& input)
+{
+    PROFILE_SCOPE(apply_input_agc);
+    apply_agc_block(input, float(sampleRate), settings, agc.agcPower, agc.agcGain, agc.meters.pPower, agc.meters.pPowerOut, nullptr);
+}
+
+void apply_output_agc_block(RadioAgcState& agc, const RadioSettings::AgcSettings& settings, double sampleRate, std::vector<float>& block)
+{
+    PROFILE_SCOPE(apply_output_agc);
+    apply_agc_block(block, float(sampleRate), settings, agc.outAgcPower, agc.outAgcGain, agc.meters.pOutPower, agc.meters.pOutPowerOut, &block);
+}
+
+// One STFT frame, run each time a hop of input completes: window the last fftSize samples, filter
+// in the frequency domain, and overlap-add the result, starting at the hop that plays next.
+void radio_process_hop(RadioFftState& state, const RadioPipelineParams& params)
+{
+    PROFILE_SCOPE(radio_fft_update);
+    RT_CHECK_SCOPE(radio_fft_update);
+
+    const auto& settings = params.settings;
+    const uint32_t size = state.fftSize;
+
+    radio_fft_forward(state, settings.inputAgc);
+
+    {
+        const double maxHz = state.sampleRate * 0.5;
+        const double binHz = maxHz / double(size / 2);
+        const double markerWidthHz = std::max(1.0, double(settings.markerWidthHz));
+        const float skirtWidthRatio = std::max(0.1f, settings.skirtWidthRatio);
+        const float skirtFalloff = std::max(0.1f, settings.skirtFalloff);
+        ensure_skirt_weights(state.skirt, binHz, markerWidthHz, skirtWidthRatio, skirtFalloff);
+    }
+
+    if (settings.enableFilter)
+    {
+        apply_bandpass_filter(state, params);
+    }
+
+    if (settings.noiseReduction > 0.0f)
+    {
+        apply_noise_reduction(state, params);
+    }
+    else
+    {
+        // Starts over from the current noise when turned back on
+        state.noise.primed = false;
+    }
+
+    radio_fft_synthesize(state, state.fftOut.data(), state.ifftScratch.data(), state.agc, settings.outputAgc, settings.outputGain, state.outBlock, state.olaSum);
+}
+
+// Feeds the callback through the STFT in runs that end at hop boundaries, so the inner loops are
+// plain strided copies. Output is the overlap-add sum one hop behind the input.
+void radio_process_block(RadioFftState& state, const RadioPipelineParams& params, const float* pInput, uint32_t inStride, float* pOutput, uint32_t outStride, uint32_t sampleCount)
+{
+    if (!state.planFwd || !state.planInv || state.hopSize == 0)
+    {
+        for (uint32_t i = 0; i < sampleCount; i++)
+        {
+            pOutput[i * outStride] = 0.0f;
+        }
+        return;
+    }
+
+    const uint32_t hop = state.hopSize;
+    for (uint32_t done = 0; done < sampleCount;)
+    {
+        const uint32_t count = std::min(sampleCount - done, hop - state.hopFill);
+
+        float* pIn = state.inFrame.data() + state.inWrite + state.hopFill;
+        float* pOla = state.olaSum.data() + state.olaRead + state.hopFill;
+        const float* pSrc = pInput + (size_t(done) * inStride);
+        float* pDst = pOutput + (size_t(done) * outStride);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pIn[i] = pSrc[i * inStride];
+            pDst[i * outStride] = pOla[i];
+            pOla[i] = 0.0f;
+        }
+
+        state.hopFill += count;
+        done += count;
+
+        if (state.hopFill == hop)
+        {
+            // The completed hop is now the newest; the next one to overwrite is the oldest
+            state.hopFill = 0;
+            state.inWrite = (state.inWrite + hop) % state.fftSize;
+            state.olaRead = (state.olaRead + hop) % state.fftSize;
+            radio_process_hop(state, params);
+        }
+    }
+}
+
+// Clears the history, so a mode switch doesn't play out stale audio
+void radio_fft_reset(RadioFftState& state)
+{
+    std::fill(state.inFrame.begin(), state.inFrame.end(), 0.0f);
+    std::fill(state.olaSum.begin(), state.olaSum.end(), 0.0f);
+    state.inWrite = 0;
+    state.olaRead = 0;
+    state.hopFill = 0;
+    state.noise.primed = false;
+}
+
+void radio_fir_reset(RadioFirState& state)
+{
+    for (auto& stage : state.decimators)
+    {
+        half_band_decimator_reset(stage);
+    }
+    for (auto& stage : state.interpolators)
+    {
+        half_band_interpolator_reset(stage);
+    }
+    fir_complex_reset(state.channel);
+    state.amCarrier = 0.0f;
+
+    // The decimators only produce on every Dth input, so a chunk can come back up to D - 1 short;
+    // a decimation's worth of silence up front means there is always a chunk to play
+    std::fill(state.fifo.begin(), state.fifo.end(), 0.0f);
+    state.fifoRead = 0;
+    state.fifoWrite = 1u << state.stages;
+}
+
+// Sizes everything up front; only a rate change reallocates
+void radio_fir_init(RadioFirState& state, double sampleRate)
+{
+    if (state.sampleRate == sampleRate && !state.fifo.empty())
+        return;
+
+    state.sampleRate = sampleRate;
+    state.halfBandTaps = half_band_design();
+    state.decimators.resize(RadioFirMaxStages);
+    state.interpolators.resize(RadioFirMaxStages);
+    fir_complex_init(state.channel, RadioFirMaxTaps);
+
+    state.inBlock.reserve(RadioFirChunk);
+    state.baseband.assign(RadioFirChunk, FftComplex{ 0.0f, 0.0f });
+    state.rateA.assign(RadioFirChunk * 2, 0.0f);
+    state.rateB.assign(RadioFirChunk * 2, 0.0f);
+    state.outBlock.reserve(RadioFirChunk * 2);
+    state.fifo.assign(RadioFirFifoSize, 0.0f);
+
+    // Forces a fresh design
+    state.designTargetHz = -1.0;
+    radio_fir_reset(state);
+}
+
+// Redesigns the chain when the marker, the filter settings or the mode move. Changing the
+// decimation restarts the chain; anything else just retunes it.
+void radio_fir_design(RadioFirState& state, const RadioPipelineParams& params)
+{
+    const auto& settings = params.settings;
+    const double markerHz = params.markerHz;
+    const double widthHz = std::max(1.0, double(settings.markerWidthHz));
+    const float skirtRatio = std::max(0.1f, settings.skirtWidthRatio);
+    const double targetHz = double(settings.targetCenterHz);
+    const auto demod = settings.demodMode;
+    if (state.designMarkerHz == markerHz && state.designWidthHz == widthHz && state.designSkirtRatio == skirtRatio && state.designTargetHz == targetHz && state.designDemod == demod)
+        return;
+
+    state.designMarkerHz = markerHz;
+    state.designWidthHz = widthHz;
+    state.designSkirtRatio = skirtRatio;
+    state.designTargetHz = targetHz;
+    state.designDemod = demod;
+
+    // Where the band's center goes on the way back up; SSB puts the carrier edge on 0Hz, and a
+    // negative shift turns LSB the right way up
+    double upHz = targetHz;
+    switch (demod)
+    {
+        case RadioDemodMode::Usb:
+            upHz = widthHz * 0.5;
+            break;
+        case RadioDemodMode::Lsb:
+            upHz = -widthHz * 0.5;
+            break;
+        case RadioDemodMode::Am:
+            upHz = 0.0;
+            break;
+        default:
+            break;
+    }
+
+    // Decimate while the shifted channel still sits in the clean part of the half-band response
+    const double skirtHz = widthHz * skirtRatio;
+    const double topHz = std::abs(upHz) + (widthHz * 0.5) + skirtHz;
+    uint32_t stages = 0;
+    while (stages < RadioFirMaxStages && (state.sampleRate / double(2u << stages)) * HalfBandUsableFraction * 0.5 >= topHz)
+    {
+        stages++;
+    }
+    if (stages != state.stages)
+    {
+        state.stages = stages;
+        radio_fir_reset(state);
+    }
+
+    // A skirt reaching past the carrier would let the other sideband through, so SSB gets a short
+    // edge centered on the carrier instead, and loses a little of the lowest audio
+    double transitionHz = skirtHz;
+    double cutoffHz = (widthHz * 0.5) + (skirtHz * 0.5);
+    if (demod == RadioDemodMode::Usb || demod == RadioDemodMode::Lsb)
+    {
+        transitionHz = std::min(skirtHz, RadioSsbTransitionHz);
+        cutoffHz = widthHz * 0.5;
+    }
+
+    const double channelRate = state.sampleRate / double(1u << stages);
+    const uint32_t taps = fir_low_pass_taps(transitionHz, channelRate, RadioFirMaxTaps);
+    fir_complex_design_low_pass(state.channel, taps, cutoffHz, channelRate);
+
+    const double downOmega = 2.0 * glm::pi<double>() * markerHz / std::max(1.0, state.sampleRate);
+    state.downStepRe = float(std::cos(downOmega));
+    state.downStepIm = float(-std::sin(downOmega));
+    const double upOmega = 2.0 * glm::pi<double>() * upHz / std::max(1.0, channelRate);
+    state.upStepRe = float(std::cos(upOmega));
+    state.upStepIm = float(std::sin(upOmega));
+    state.amCarrierCoeff = float(1.0 - std::exp(-1.0 / (RadioAmCarrierSeconds * std::max(1.0, channelRate))));
+}
+
+double radio_fir_latency_seconds(const RadioFirState& state)
+{
+    // Each half-band delays by its center at its higher rate, on the way down and on the way up;
+    // the channel FIR by half its length at the decimated rate; the FIFO by its head start
+    const double decimation = double(1u << state.stages);
+    const double halfBands = 2.0 * double(HalfBandCenter) * (decimation - 1.0);
+    const double channel = double(state.channel.tapCount / 2) * decimation;
+    return (halfBands + channel + decimation) / std::max(1.0, state.sampleRate);
+}
+
+// One chunk through the chain, into the FIFO
+void radio_fir_process_chunk(RadioFirState& state, const RadioSettings& settings)
+{
+    PROFILE_SCOPE(radio_fir_chunk);
+
+    const auto count = uint32_t(state.inBlock.size());
+    if (settings.inputAgc.enabled)
+    {
+        apply_input_agc(state.agc, settings.inputAgc, state.sampleRate, state.inBlock);
+    }
+    const float inGain = state.agc.agcGain;
+
+    if (!settings.enableFilter)
+    {
+        state.outBlock.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            state.outBlock[i] = state.inBlock[i] * inGain;
+        }
+    }
+    else
+    {
+        // Marker to DC
+        float re = state.downRe;
+        float im = state.downIm;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const float sample = state.inBlock[i] * inGain;
+            state.baseband[i] = FftComplex{ sample * re, sample * im };
+            const float nextRe = (re * state.downStepRe) - (im * state.downStepIm);
+            im = (re * state.downStepIm) + (im * state.downStepRe);
+            re = nextRe;
+        }
+        normalize_phasor(re, im);
+        state.downRe = re;
+        state.downIm = im;
+
+        uint32_t decimated = count;
+        for (uint32_t s = 0; s < state.stages; s++)
+        {
+            decimated = half_band_decimate(state.halfBandTaps, state.decimators[s], state.baseband.data(), decimated);
+        }
+
+        fir_complex_process(state.channel, state.baseband.data(), decimated);
+
+        if (state.designDemod == RadioDemodMode::Am)
+        {
+            // The envelope is half the real amplitude, as for the mix below, so * 2. The magnitudes
+            // are a separate pass, so they vectorize; only the carrier tracking is serial.
+            for (uint32_t i = 0; i < decimated; i++)
+            {
+                const auto& z = state.baseband[i];
+                state.rateA[i] = std::sqrt((z.r * z.r) + (z.i * z.i));
+            }
+            float carrier = state.amCarrier;
+            for (uint32_t i = 0; i < decimated; i++)
+            {
+                carrier += state.amCarrierCoeff * (state.rateA[i] - carrier);
+                state.rateA[i] = 2.0f * (state.rateA[i] - carrier);
+            }
+            state.amCarrier = carrier;
+        }
+        else
+        {
+            // Up to the target center, or the sideband's carrier to 0Hz; the real part is half of
+            // each image, so * 2
+            re = state.upRe;
+            im = state.upIm;
+            for (uint32_t i = 0; i < decimated; i++)
+            {
+                const auto& z = state.baseband[i];
+                state.rateA[i] = 2.0f * ((z.r * re) - (z.i * im));
+                const float nextRe = (re * state.upStepRe) - (im * state.upStepIm);
+                im = (re * state.upStepIm) + (im * state.upStepRe);
+                re = nextRe;
+            }
+            normalize_phasor(re, im);
+            state.upRe = re;
+            state.upIm = im;
+        }
+
+        // Back up to the device rate
+        float* pFrom = state.rateA.data();
+        float* pTo = state.rateB.data();
+        uint32_t interpolated = decimated;
+        for (uint32_t s = 0; s < state.stages; s++)
+        {
+            half_band_interpolate(state.halfBandTaps, state.interpolators[s], pFrom, interpolated, pTo);
+            interpolated *= 2;
+            std::swap(pFrom, pTo);
+        }
+        state.outBlock.assign(pFrom, pFrom + interpolated);
+    }
+
+    apply_output_agc_block(state.agc, settings.outputAgc, state.sampleRate, state.outBlock);
+
+    const uint32_t mask = RadioFirFifoSize - 1;
+    for (const auto sample : state.outBlock)
+    {
+        state.fifo[state.fifoWrite & mask] = sample;
+        state.fifoWrite++;
+    }
+}
+
+void radio_fir_process_block(RadioFirState& state, const RadioPipelineParams& params, const float* pInput, uint32_t inStride, float* pOutput, uint32_t outStride, uint32_t sampleCount)
+{
+    if (state.fifo.empty())
+    {
+        for (uint32_t i = 0; i < sampleCount; i++)
+        {
+            pOutput[i * outStride] = 0.0f;
+        }
+        return;
+    }
+
+    radio_fir_design(state, params);
+
+    const uint32_t mask = RadioFirFifoSize - 1;
+    const float gain = params.settings.outputGain;
+    for (uint32_t done = 0; done < sampleCount;)
+    {
+        const uint32_t count = std::min(sampleCount - done, RadioFirChunk);
+
+        // Within the reserved capacity, so no allocation
+        state.inBlock.resize(count);
+        const float* pSrc = pInput + (size_t(done) * inStride);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            state.inBlock[i] = pSrc[i * inStride];
+        }
+
+        radio_fir_process_chunk(state, params.settings);
+
+        assert(state.fifoWrite - state.fifoRead >= count);
+        float* pDst = pOutput + (size_t(done) * outStride);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pDst[i * outStride] = state.fifo[state.fifoRead & mask] * gain;
+            state.fifoRead++;
+        }
+        done += count;
+    }
+}
+
+uint32_t radio_conv_block_size(uint32_t callbackFrames)
+{
+    return std::bit_ceil(std::clamp(callbackFrames, RadioConvMinBlock, RadioConvMaxBlock));
+}
+
+void radio_conv_reset(RadioConvState& state)
+{
+    partitioned_convolution_reset(state.conv);
+    std::fill(state.outBlock.begin(), state.outBlock.end(), 0.0f);
+    state.fill = 0;
+}
+
+// Sizes everything for the block and the design grid; only a change there reallocates
+void radio_conv_init(RadioConvState& state, double sampleRate, uint32_t blockSize, uint32_t designSize)
+{
+    designSize = std::bit_floor(std::max(designSize, 2u));
+    if (state.sampleRate == sampleRate && state.conv.blockSize == blockSize && state.designSize == designSize && state.conv.planFwd)
+        return;
+
+    state.sampleRate = sampleRate;
+    state.designSize = designSize;
+    partitioned_convolution_init(state.conv, blockSize, designSize);
+
+    state.inBlock.assign(blockSize, 0.0f);
+    state.filtered.assign(blockSize, FftComplex{ 0.0f, 0.0f });
+    state.outBlock.assign(blockSize, 0.0f);
+    state.fill = 0;
+
+    // Waits for a response made for the new sizes
+    state.design = RadioConvDesign{};
+}
+
+RadioConvDesign radio_conv_design_for(const RadioPipelineParams& params)
+{
+    const auto& settings = params.settings;
+    RadioConvDesign design;
+    design.sampleRate = params.sampleRate;
+    design.blockSize = radio_conv_block_size(params.blockFrames);
+    design.designSize = std::bit_floor(std::max(params.fftSize, 2u));
+    design.markerHz = params.markerHz;
+    design.widthHz = std::max(1.0, double(settings.markerWidthHz));
+    design.skirtRatio = std::max(0.1f, settings.skirtWidthRatio);
+    design.falloff = std::max(0.1f, settings.skirtFalloff);
+    return design;
+}
+
+// The shift follows the target straight away, but the marker only with the response
+void radio_conv_tune(RadioConvState& state, const RadioPipelineParams& params)
+{
+    const double shiftOmega = 2.0 * glm::pi<double>() * (double(params.settings.targetCenterHz) - state.design.markerHz) / std::max(1.0, state.sampleRate);
+    state.shiftStepRe = std::cos(shiftOmega);
+    state.shiftStepIm = std::sin(shiftOmega);
+}
+
+double radio_conv_latency_seconds(const RadioConvState& state)
+{
+    return (double(state.conv.blockSize) + state.irDelay) / std::max(1.0, state.sampleRate);
+}
+
+// One partition's worth of input through the filter, into the block that plays next
+void radio_conv_process_partition(RadioConvState& state, const RadioSettings& settings)
+{
+    PROFILE_SCOPE(radio_conv_partition);
+
+    if (settings.inputAgc.enabled)
+    {
+        apply_input_agc(state.agc, settings.inputAgc, state.sampleRate, state.inBlock);
+    }
+    const float inGain = state.agc.agcGain;
+    for (auto& sample : state.inBlock)
+    {
+        sample *= inGain;
+    }
+
+    const auto block = uint32_t(state.inBlock.size());
+    if (!settings.enableFilter)
+    {
+        std::copy_n(state.inBlock.data(), block, state.outBlock.data());
+    }
+    else
+    {
+        partitioned_convolution_process(state.conv, state.inBlock.data(), state.filtered.data());
+
+        // Marker to target; the real part is half of each image, so * 2
+        double re = state.shiftRe;
+        double im = state.shiftIm;
+        for (uint32_t i = 0; i < block; i++)
+        {
+            const auto& z = state.filtered[i];
+            state.outBlock[i] = 2.0f * float((z.r * re) - (z.i * im));
+            const double nextRe = (re * state.shiftStepRe) - (im * state.shiftStepIm);
+            im = (re * state.shiftStepIm) + (im * state.shiftStepRe);
+            re = nextRe;
+        }
+        normalize_phasor(re, im);
+        state.shiftRe = re;
+        state.shiftIm = im;
+    }
+
+    apply_output_agc_block(state.agc, settings.outputAgc, state.sampleRate, state.outBlock);
+}
+
+void radio_conv_process_block(RadioConvState& state, const RadioPipelineParams& params, const float* pInput, uint32_t inStride, float* pOutput, uint32_t outStride, uint32_t sampleCount)
+{
+    if (!state.conv.planFwd)
+    {
+        for (uint32_t i = 0; i < sampleCount; i++)
+        {
+            pOutput[i * outStride] = 0.0f;
+        }
+        return;
+    }
+
+    radio_conv_tune(state, params);
+
+    const uint32_t block = state.conv.blockSize;
+    const float gain = params.settings.outputGain;
+    for (uint32_t done = 0; done < sampleCount;)
+    {
+        const uint32_t count = std::min(sampleCount - done, block - state.fill);
+
+        const float* pSrc = pInput + (size_t(done) * inStride);
+        float* pDst = pOutput + (size_t(done) * outStride);
+        float* pIn = state.inBlock.data() + state.fill;
+        const float* pOut = state.outBlock.data() + state.fill;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            pIn[i] = pSrc[i * inStride];
+            pDst[i * outStride] = pOut[i] * gain;
+        }
+
+        state.fill += count;
+        done += count;
+
+        if (state.fill == block)
+        {
+            state.fill = 0;
+            radio_conv_process_partition(state, params.settings);
+        }
+    }
+}
+
+} // namespace
+
+bool radio_conv_design(RadioConvDesigner& designer, const RadioPipelineParams& params)
+{
+    const auto design = radio_conv_design_for(params);
+    auto& response = designer.response;
+    if (design == response.design)
+        return false;
+
+    PROFILE_SCOPE(radio_conv_design);
+
+    if (design.sampleRate != response.design.sampleRate || design.designSize != response.design.designSize || design.blockSize != response.design.blockSize)
+    {
+        designer.magnitude.assign(design.designSize, 0.0f);
+        minimum_phase_init(designer.minPhase, design.designSize);
+        partitioned_convolution_init(designer.conv, design.blockSize, design.designSize);
+    }
+
+    // Same placement as the STFT filter, but only the positive side; the response is analytic
+    const uint32_t size = design.designSize;
+    const double binHz = design.sampleRate / double(size);
+    ensure_skirt_weights(designer.skirt, binHz, design.widthHz, design.skirtRatio, design.falloff);
+
+    // The skirt table stops with some gain left; the STFT doesn't mind, but as a response that
+    // cliff rings right across the band. Fade the ends out over half a skirt instead.
+    std::fill(designer.magnitude.begin(), designer.magnitude.end(), 0.0f);
+    const uint32_t totalBins = designer.skirt.totalBins;
+    const int64_t fadeBins = std::max<int64_t>(2, designer.skirt.skirtBins / 2);
+    const int64_t lowSkirtBin = int64_t(std::floor((design.markerHz / binHz) - (double(totalBins) * 0.5)));
+    for (int64_t i = -fadeBins; i < int64_t(totalBins) + fadeBins; ++i)
+    {
+        const int64_t bin = lowSkirtBin + i;
+        if (bin < 0 || bin > int64_t(size / 2))
+            continue;
+
+        float gain = 0.0f;
+        if (i < 0)
+        {
+            gain = designer.skirt.skirtWeights[0] * 0.5f * (1.0f + std::cos(glm::pi<float>() * float(-i) / float(fadeBins)));
+        }
+        else if (i >= int64_t(totalBins))
+        {
+            const auto past = i - int64_t(totalBins) + 1;
+            gain = designer.skirt.skirtWeights[totalBins - 1] * 0.5f * (1.0f + std::cos(glm::pi<float>() * float(past) / float(fadeBins)));
+        }
+        else
+        {
+            gain = designer.skirt.skirtWeights[i];
+        }
+        designer.magnitude[bin] = gain;
+    }
+
+    minimum_phase_design(designer.minPhase, designer.magnitude.data(), RadioConvFloorGain);
+
+    // Half Hann over the first half of the grid smooths what is left of the ripple between
+    // bins; then trim the tail, and find where the energy sits for the latency estimate
+    auto& ir = designer.minPhase.ir;
+    const uint32_t taper = size / 2;
+    double total = 0.0;
+    double moment = 0.0;
+    for (uint32_t n = 0; n < size; n++)
+    {
+        const float t = n < taper ? 0.5f * (1.0f + std::cos(glm::pi<float>() * float(n) / float(taper))) : 0.0f;
+        ir[n].r *= t;
+        ir[n].i *= t;
+        const double energy = double(ir[n].r * ir[n].r) + double(ir[n].i * ir[n].i);
+        total += energy;
+        moment += energy * double(n);
+    }
+    uint32_t length = taper;
+    double tail = 0.0;
+    while (length > 1)
+    {
+        const auto& sample = ir[length - 1];
+        tail += double(sample.r * sample.r) + double(sample.i * sample.i);
+        if (tail > total * RadioConvTailEnergy)
+            break;
+        length--;
+    }
+
+    partitioned_convolution_set_ir(designer.conv, ir.data(), length);
+
+    response.design = design;
+    response.partitions = designer.conv.partitions;
+    response.irDelay = total > 0.0 ? moment / total : 0.0;
+    response.irSpectra.assign(designer.conv.irSpectra.begin(), designer.conv.irSpectra.begin() + (size_t(response.partitions) * design.blockSize * 2));
+    return true;
+}
+
+void radio_pipeline_set_conv_response(RadioPipeline& pipeline, const RadioConvResponse& response)
+{
+    auto& state = pipeline.conv;
+    const auto& design = response.design;
+    if (pipeline.activeMode != RadioFilterMode::Partitioned || design == state.design)
+        return;
+    if (design.sampleRate != state.sampleRate || design.designSize != state.designSize || design.blockSize != state.conv.blockSize)
+        return;
+
+    partitioned_convolution_copy_ir(state.conv, response.irSpectra.data(), response.partitions);
+    state.design = design;
+    state.irDelay = response.irDelay;
+}
+
+uint32_t radio_skirt_max_bins(double binHz)
+{
+    // As ensure_skirt_weights rounds them, plus a bin for each of the three pieces
+    const double widthBins = double(RadioMaxWidthHz) / binHz;
+    return uint32_t(std::ceil(widthBins * (1.0 + (2.0 * double(RadioMaxSkirtWidthRatio))))) + 3u;
+}
+
+void ensure_skirt_weights(RadioSkirt& skirt, double binHz, double widthHz, float skirtWidthRatio, float falloff)
+{
+    const double skirtWidthHz = widthHz * std::max(0.01f, skirtWidthRatio);
+    const uint32_t passBins = std::max(1u, uint32_t(std::round(widthHz / binHz)));
+    const uint32_t skirtBins = std::max(1u, uint32_t(std::round(skirtWidthHz / binHz)));
+    const uint32_t totalBins = passBins + (2u * skirtBins);
+
+    if (skirt.cachedBinHz == binHz && skirt.cachedWidthHz == widthHz && skirt.cachedSkirtRatio == skirtWidthRatio && skirt.cachedFalloff == falloff && skirt.totalBins == totalBins)
+        return;
+
+    skirt.cachedBinHz = binHz;
+    skirt.cachedWidthHz = widthHz;
+    skirt.cachedSkirtRatio = skirtWidthRatio;
+    skirt.cachedFalloff = falloff;
+    skirt.passBins = passBins;
+    skirt.skirtBins = skirtBins;
+    skirt.totalBins = totalBins;
+    skirt.skirtWeights.assign(totalBins, 0.0f);
+
+    const float sigmaBins = std::max(1e-3f, float(skirtBins) / std::max(0.1f, falloff));
+    for (uint32_t i = 0; i < totalBins; ++i)
+    {
+        float gain = 0.0f;
+        if (i < skirtBins)
+        {
+            const float d = float(skirtBins - 1u - i);
+            const float x = d / sigmaBins;
+            gain = std::exp(-0.5f * x * x);
+        }
+        else if (i < skirtBins + passBins)
+        {
+            gain = 1.0f;
+        }
+        else
+        {
+            const uint32_t tail = i - (skirtBins + passBins);
+            const float d = float(tail);
+            const float x = d / sigmaBins;
+            gain = std::exp(-0.5f * x * x);
+        }
+        skirt.skirtWeights[i] = gain;
+    }
+}
+
+void radio_fft_init(RadioFftState& state, uint32_t fftSize, uint32_t segmentCount, double sampleRate, FftBackend backend)
+{
+    if (fftSize < 2)
+        return;
+    if (fftSize % 2 == 1)
+        fftSize -= 1;
+
+    // The rate only scales the bins; nothing to resize
+    state.sampleRate = sampleRate;
+
+    const uint32_t segments = std::max(1u, segmentCount);
+    if (fftSize % segments != 0)
+    {
+        fftSize -= (fftSize % segments);
+    }
+    if (fftSize < 2 * segments)
+        return;
+
+    // The skirt follows the width on the audio thread; only a new rate or size may grow it
+    state.skirt.skirtWeights.reserve(radio_skirt_max_bins(sampleRate / double(fftSize)));
+
+    const bool sized = state.fftSize == fftSize && state.hopDiv == segments && state.planFwd && state.planInv;
+    if (sized && state.backend == backend)
+        return;
+
+    // Resolved here rather than per hop, as fetching a plan can lock the cache and build one.
+    // A backend the size doesn't suit falls back to Kiss, but it is still what was asked for.
+    state.backend = backend;
+    state.planFwd = fft_plan(backend, fftSize, FftKind::Real, FftDirection::Forward);
+    state.planInv = fft_plan(backend, fftSize, FftKind::Real, FftDirection::Inverse);
+    if (sized)
+        return;
+
+    state.fftSize = fftSize;
+    state.hopDiv = segments;
+    state.hopSize = std::max(1u, fftSize / segments);
+    state.window.resize(fftSize);
+    state.olaScale.resize(fftSize, 1.0f);
+    state.fftIn.assign(fftSize, 0.0f);
+    state.fftOut.assign((fftSize / 2) + 1, FftComplex{});
+    state.fftShifted.assign((fftSize / 2) + 1, FftComplex{});
+    state.ifftScratch.assign(fftSize / 2, FftComplex{});
+    state.outBlock.assign(fftSize, 0.0f);
+    state.inFrame.assign(fftSize, 0.0f);
+    state.olaSum.assign(fftSize, 0.0f);
+    state.inWrite = 0;
+    state.olaRead = 0;
+    state.hopFill = 0;
+
+    // Sized here, so turning noise reduction on doesn't allocate
+    radio_noise_setup(state.noise, (fftSize / 2) + 1, double(state.hopSize) / sampleRate);
+
+    // Hann window for smooth spectral bins
+    for (uint32_t i = 0; i < fftSize; ++i)
+    {
+        state.window[i] = 0.5f * (1.0f - std::cos(2.0f * 3.14159265358979323846f * (i / float(fftSize - 1))));
+    }
+
+    const uint32_t overlapCount = std::max(1u, segments);
+    for (uint32_t i = 0; i < fftSize; ++i)
+    {
+        float sum = 0.0f;
+        for (uint32_t k = 0; k < overlapCount; ++k)
+        {
+            const uint32_t idx = (i + k * state.hopSize) % fftSize;
+            const float w = state.window[idx];
+            sum += w * w;
+        }
+        state.olaScale[i] = sum > 1e-6f ? (1.0f / sum) : 1.0f;
+    }
+}
+
+// Copies the skirt's bins around centerHz into a cleared spectrum, moved to targetHz. Only the
+// non-negative bins; the real inverse supplies the mirror image.
+// A shift of k bins mixes each frame by e^(j2pi kn/N) from its own start, so successive frames
+// only line up if the mix is carried on from where the last one left off; frameStart is the
+// frame's first sample, mod fftSize. Without it, an odd shift at 50% overlap flips sign every
+// hop and the tone comes out as a pair a bin either side.
+void apply_bandpass_bins(const RadioSkirt& skirt, const FftComplex* pIn, FftComplex* pOut, uint32_t fftSize, uint32_t frameStart, double binHz, double centerHz, double targetHz)
+{
+    const double centerBin = centerHz / binHz;
+    const double targetCenterBin = targetHz / binHz;
+    const int64_t lowSkirtBin = int64_t(std::floor(centerBin - (double(skirt.totalBins) * 0.5)));
+    const int64_t shiftBins = int64_t(std::llround(targetCenterBin - centerBin));
+    const int64_t halfBins = int64_t(fftSize / 2);
+
+    const int64_t size = int64_t(fftSize);
+    const int64_t turn = ((((shiftBins % size) + size) % size) * int64_t(frameStart)) % size;
+    const double angle = 2.0 * glm::pi<double>() * double(turn) / double(size);
+    const auto rotRe = float(std::cos(angle));
+    const auto rotIm = float(std::sin(angle));
+
+    std::fill_n(pOut, halfBins + 1, FftComplex{ 0.0f, 0.0f });
+
+    for (uint32_t i = 0; i < skirt.totalBins; ++i)
+    {
+        const int64_t srcBin = lowSkirtBin + int64_t(i);
+        if (srcBin < 0 || srcBin > halfBins)
+            continue;
+
+        const int64_t dstBin = srcBin + shiftBins;
+        if (dstBin < 0 || dstBin > halfBins)
+            continue;
+
+        const float re = pIn[srcBin].r * skirt.skirtWeights[i];
+        const float im = pIn[srcBin].i * skirt.skirtWeights[i];
+        pOut[dstBin].r = (re * rotRe) - (im * rotIm);
+        pOut[dstBin].i = (re * rotIm) + (im * rotRe);
+    }
+}
+
+void apply_agc_block(const std::vector<float>& input,
+                     float sampleRate,
+                     const RadioSettings::AgcSettings& settings,
+                     float& agcPower,
+                     float& agcGain,
+                     std::atomic<float>* powerOut,
+                     std::atomic<float>* powerOutPost,
+                     std::vector<float>* applyBlock)
+{
+    if (input.empty())
+        return;
+    if (!settings.enabled)
+        return;
+
+    PROFILE_SCOPE(apply_agc_block);
+
+    // Four running sums and peaks, so the loop vectorizes; a float squared is exact in a double
+    constexpr uint32_t Lanes = 4;
+    const uint32_t count = uint32_t(input.size());
+    const float* pInput = input.data();
+    std::array<double, Lanes> sums{};
+    std::array<float, Lanes> peaks{};
+    uint32_t i = 0;
+    for (; i + Lanes <= count; i += Lanes)
+    {
+        for (uint32_t lane = 0; lane < Lanes; lane++)
+        {
+            const float sample = pInput[i + lane];
+            sums[lane] += double(sample) * double(sample);
+            peaks[lane] = std::max(peaks[lane], std::abs(sample));
+        }
+    }
+    for (; i < count; ++i)
+    {
+        sums[0] += double(pInput[i]) * double(pInput[i]);
+        peaks[0] = std::max(peaks[0], std::abs(pInput[i]));
+    }
+    const double sum = std::accumulate(sums.begin(), sums.end(), 0.0);
+    const double maxMag = *std::max_element(peaks.begin(), peaks.end());
+    const double avgPower = sum / double(std::max(1u, count));
+    if (!std::isfinite(avgPower))
+        return;
+
+    const float blockSeconds = sampleRate > 0.0f ? (float(input.size()) / sampleRate) : 0.0f;
+    auto ms_to_coeff = [&](float ms) {
+        if (ms <= 0.0f || blockSeconds <= 0.0f)
+            return 1.0f;
+        const float tau = ms / 1000.0f;
+        const float coeff = 1.0f - std::exp(-blockSeconds / tau);
+        return std::clamp(coeff, 0.0f, 1.0f);
+    };
+    const float attack = ms_to_coeff(settings.attackMs);
+    const float release = ms_to_coeff(settings.releaseMs);
+    if (agcPower <= 0.0f)
+    {
+        agcPower = float(avgPower);
+    }
+    else
+    {
+        const float coeff = avgPower > agcPower ? attack : release;
+        agcPower = agcPower + coeff * float(avgPower - agcPower);
+    }
+    if (powerOut)
+    {
+        powerOut->store(agcPower, std::memory_order_relaxed);
+    }
+
+    const double power = std::max<double>(agcPower, 1e-12);
+    const double rms = std::sqrt(avgPower);
+    const double crest = std::clamp(maxMag / std::max(rms, 1e-12), 1.0, 20.0);
+    const double targetLinear = std::pow(10.0, double(settings.targetDb) / 20.0);
+    double desired = targetLinear / std::sqrt(power);
+    desired /= std::sqrt(crest);
+    desired = std::clamp(desired, 0.05, 50.0);
+
+    const float gainCoeff = desired < agcGain ? attack : release;
+    agcGain = agcGain + gainCoeff * float(desired - agcGain);
+
+    if (powerOutPost)
+    {
+        powerOutPost->store(agcPower * (agcGain * agcGain), std::memory_order_relaxed);
+    }
+
+    if (applyBlock)
+    {
+        for (float& sample : *applyBlock)
+        {
+            sample *= agcGain;
+        }
+    }
+}
+
+// Window the last fftSize samples and transform them into fftOut
+void radio_fft_forward(RadioFftState& state, const RadioSettings::AgcSettings& inputAgc)
+{
+    const uint32_t size = state.fftSize;
+
+    // Oldest first; the frame wraps at most once, at a hop boundary
+    const uint32_t firstCount = size - state.inWrite;
+    std::copy_n(state.inFrame.data() + state.inWrite, firstCount, state.fftIn.data());
+    std::copy_n(state.inFrame.data(), state.inWrite, state.fftIn.data() + firstCount);
+
+    if (inputAgc.enabled)
+    {
+        apply_input_agc(state.agc, inputAgc, state.sampleRate, state.fftIn);
+    }
+
+    for (uint32_t n = 0; n < size; ++n)
+    {
+        state.fftIn[n] *= state.window[n] * state.agc.agcGain;
+    }
+
+    fft_real_forward(state.planFwd, state.fftIn.data(), state.fftOut.data());
+}
+
+void radio_fft_synthesize(const RadioFftState& fft, const FftComplex* pSpectrum, FftComplex* pScratch, RadioAgcState& agc, const RadioSettings::AgcSettings& outputAgc, float gain, std::vector<float>& outBlock, std::vector<float>& olaSum)
+{
+    const uint32_t size = fft.fftSize;
+
+    fft_real_inverse(fft.planInv, pSpectrum, outBlock.data(), pScratch);
+
+    const float invSize = 1.0f / float(size);
+    for (uint32_t s = 0; s < size; ++s)
+    {
+        outBlock[s] = outBlock[s] * fft.window[s] * fft.olaScale[s] * invSize;
+    }
+
+    apply_output_agc_block(agc, outputAgc, fft.sampleRate, outBlock);
+
+    // Overlap-add from the read position; split where the buffer wraps
+    const uint32_t headCount = size - fft.olaRead;
+    float* pHead = olaSum.data() + fft.olaRead;
+    for (uint32_t s = 0; s < headCount; ++s)
+    {
+        pHead[s] += outBlock[s] * gain;
+    }
+    const float* pTail = outBlock.data() + headCount;
+    for (uint32_t s = 0; s < fft.olaRead; ++s)
+    {
+        olaSum[s] += pTail[s] * gain;
+    }
+}
+
+double radio_fft_latency_seconds(const RadioFftState& state)
+{
+    // A sample reaches the output once the last frame it is in has been overlap-added
+    return double(state.fftSize) / std::max(1.0, state.sampleRate);
+}
+
+RadioFilterMode radio_engine_mode(const RadioSettings& settings)
+{
+    return settings.demodMode == RadioDemodMode::Cw ? settings.filterMode : RadioFilterMode::Fir;
+}
+
+void radio_pipeline_init(RadioPipeline& pipeline, const RadioPipelineParams& params)
+{
+    pipeline.params = params;
+    pipeline.activeMode = radio_engine_mode(params.settings);
+
+    switch (pipeline.activeMode)
+    {
+        case RadioFilterMode::Fir:
+            radio_fir_init(pipeline.fir, params.sampleRate);
+            radio_fir_reset(pipeline.fir);
+            pipeline.fir.agc.meters = pipeline.meters;
+            break;
+        case RadioFilterMode::Partitioned:
+        {
+            radio_conv_init(pipeline.conv, params.sampleRate, radio_conv_block_size(params.blockFrames), params.fftSize);
+            radio_conv_reset(pipeline.conv);
+            pipeline.conv.agc.meters = pipeline.meters;
+
+            auto designer = std::make_unique<RadioConvDesigner>();
+            radio_conv_design(*designer, params);
+            radio_pipeline_set_conv_response(pipeline, designer->response);
+            break;
+        }
+        default:
+            radio_fft_init(pipeline.fft, params.fftSize, params.settings.fftHopDiv, params.sampleRate, params.fftBackend);
+            radio_fft_reset(pipeline.fft);
+            pipeline.fft.agc.meters = pipeline.meters;
+            break;
+    }
+}
+
+bool radio_pipeline_fits(const RadioPipelineParams& sized, const RadioPipelineParams& params)
+{
+    const auto mode = radio_engine_mode(sized.settings);
+    if (mode != radio_engine_mode(params.settings) || sized.sampleRate != params.sampleRate)
+        return false;
+
+    switch (mode)
+    {
+        case RadioFilterMode::Fir:
+            return true;
+        case RadioFilterMode::Partitioned:
+            return sized.fftSize == params.fftSize && radio_conv_block_size(sized.blockFrames) == radio_conv_block_size(params.blockFrames);
+        default:
+            return sized.fftSize == params.fftSize && sized.settings.fftHopDiv == params.settings.fftHopDiv && sized.fftBackend == params.fftBackend;
+    }
+}
+
+void radio_pipeline_set_params(RadioPipeline& pipeline, const RadioPipelineParams& params)
+{
+    // The engines retune to the new snapshot as they run
+    assert(radio_pipeline_fits(pipeline.params, params));
+    pipeline.params = params;
+}
+
+void radio_pipeline_process(RadioPipeline& pipeline, const float* pInput, float* pOutput, uint32_t count, uint32_t inStride, uint32_t outStride)
+{
+    switch (pipeline.activeMode)
+    {
+        case RadioFilterMode::Fir:
+            radio_fir_process_block(pipeline.fir, pipeline.params, pInput, inStride, pOutput, outStride, count);
+            break;
+        case RadioFilterMode::Partitioned:
+            radio_conv_process_block(pipeline.conv, pipeline.params, pInput, inStride, pOutput, outStride, count);
+            break;
+        case RadioFilterMode::Stft:
+            radio_process_block(pipeline.fft, pipeline.params, pInput, inStride, pOutput, outStride, count);
+            break;
+        default:
+            // No parameters yet
+            for (uint32_t i = 0; i < count; i++)
+            {
+                pOutput[i * outStride] = 0.0f;
+            }
+            break;
+    }
+}
+
+double radio_pipeline_latency_seconds(const RadioPipeline& pipeline)
+{
+    switch (pipeline.activeMode)
+    {
+        case RadioFilterMode::Fir:
+            return radio_fir_latency_seconds(pipeline.fir);
+        case RadioFilterMode::Partitioned:
+            return radio_conv_latency_seconds(pipeline.conv);
+        default:
+            return radio_fft_latency_seconds(pipeline.fft);
+    }
+}
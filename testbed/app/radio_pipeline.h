@@ -0,0 +1,305 @@
+// The marker receiver's DSP, apart from the app. A pipeline owns its engines' plans, buffers and
+// AGC state, and only sees the parameters it was last given, so any number can run at once: one
+// per receiver live, or one per core over recordings.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <zing/audio/fft.h>
+#include <zing/audio/partitioned_convolution.h>
+#include <zing/audio/polyphase.h>
+
+#include "radio_settings.h"
+
+// Where an AGC publishes its levels, for a meter; any of them can be null
+struct RadioAgcMeters
+{
+    std::atomic<float>* pPower = nullptr;
+    std::atomic<float>* pPowerOut = nullptr;
+    std::atomic<float>* pOutPower = nullptr;
+    std::atomic<float>* pOutPowerOut = nullptr;
+};
+
+struct RadioAgcState
+{
+    float agcGain = 1.0f;
+    float agcPower = 0.0f;
+    float outAgcGain = 1.0f;
+    float outAgcPower = 0.0f;
+    RadioAgcMeters meters;
+};
+
+// Band pass gain per bin, around the marker: flat over the width, with Gaussian skirts
+struct RadioSkirt
+{
+    std::vector<float> skirtWeights;
+    uint32_t skirtBins = 0;
+    uint32_t passBins = 0;
+    uint32_t totalBins = 0;
+    double cachedBinHz = 0.0;
+    double cachedWidthHz = 0.0;
+    float cachedFalloff = 0.0f;
+    float cachedSkirtRatio = 0.0f;
+};
+
+// Noise reduction on the filtered bins of each STFT hop. The noise in each bin is the minimum of
+// its smoothed power over the last second and a half, tracked in sub-windows so that only a
+// minimum per sub-window has to be kept (minimum statistics). A decision-directed Wiener gain is
+// worked out against it, with a floor set by the strength and a little smoothing across bins,
+// which keeps isolated bins of noise from ringing on their own.
+constexpr uint32_t RadioNoiseSubWindows = 8;
+
+struct RadioNoiseState
+{
+    uint32_t bins = 0;
+    uint32_t subFrames = 1;   // Hops per sub-window
+    uint32_t subFill = 0;
+    uint32_t subIndex = 0;
+    double hopSeconds = 0.0;  // What the smoothing was set up for
+    float powerCoeff = 0.0f;  // Per hop
+    float priorCoeff = 0.0f;
+    bool primed = false;
+
+    std::vector<float> power;      // This hop
+    std::vector<float> smoothed;
+    std::vector<float> subMin;     // Over the sub-window being filled
+    std::vector<float> windowMin;  // RadioNoiseSubWindows minima, a row each
+    std::vector<float> floorMin;   // Least of the completed rows
+    std::vector<float> clean;      // Last hop's gain squared times its power, for the prior SNR
+    std::vector<float> gain;
+    std::vector<float> smoothGain;
+};
+
+struct RadioFftState
+{
+    double sampleRate = 0.0;
+    uint32_t fftSize = 0;
+    uint32_t hopDiv = 2;
+    uint32_t hopSize = 0;
+    Zing::FftBackend backend = Zing::FftBackend::Kiss; // The plans were asked for
+    const Zing::FftPlan* planFwd = nullptr;
+    const Zing::FftPlan* planInv = nullptr;
+    std::vector<float> window;
+    std::vector<float> olaScale;
+    // Real transforms; only the non-negative bins are filtered and the inverse implies the mirror
+    // image. Output matches the full complex transform pair to within 1e-6 of full scale (float
+    // rounding, ~-120dB).
+    std::vector<float> fftIn;                  // fftSize; the frame, then windowed in place
+    std::vector<Zing::FftComplex> fftOut;      // fftSize / 2 + 1 bins
+    std::vector<Zing::FftComplex> fftShifted;
+    std::vector<Zing::FftComplex> ifftScratch; // fftSize / 2, for the inverse
+
+    // Block STFT. Both buffers are fftSize long and move a hop at a time, and hops divide the size,
+    // so a hop is always one contiguous range and a frame is at most two.
+    std::vector<float> inFrame; // Input history; inWrite is the hop being filled, which is also the oldest
+    std::vector<float> olaSum;  // Overlap-add; olaRead is the hop being played out
+    uint32_t inWrite = 0;
+    uint32_t olaRead = 0;
+    uint32_t hopFill = 0;       // Samples into the current hop, in and out
+
+    RadioSkirt skirt;
+    RadioNoiseState noise;
+    RadioAgcState agc;
+    std::vector<float> outBlock;
+};
+
+// Time domain receiver. The marker is mixed to complex baseband, decimated by half-band stages
+// until the channel just fits, filtered by a short linear phase FIR, mixed up to the target
+// center and interpolated back by the same stages. Work runs in chunks, so the scratch buffers
+// are sized once; the FIFO evens out the decimation's uneven output per chunk.
+// The phone modes only change what happens at the decimated rate, so they cost about the same as
+// CW: SSB mixes up or down by half the band rather than to the target center, and AM takes the
+// magnitude instead.
+constexpr uint32_t RadioFirChunk = 256;
+constexpr uint32_t RadioFirMaxStages = 6; // Decimation up to 64
+constexpr uint32_t RadioFirMaxTaps = 511;
+constexpr uint32_t RadioFirFifoSize = 2048; // Power of 2; a chunk plus the decimation, with room to spare
+
+struct RadioFirState
+{
+    double sampleRate = 0.0;
+    uint32_t stages = 0; // log2 of the decimation
+    Zing::HalfBandCoeffs halfBandTaps{};
+    std::vector<Zing::HalfBandDecimator> decimators;
+    std::vector<Zing::HalfBandInterpolator> interpolators;
+    Zing::FirComplex channel;
+
+    // What the channel filter and NCOs were last set up for
+    double designMarkerHz = -1.0;
+    double designWidthHz = 0.0;
+    double designTargetHz = -1.0;
+    float designSkirtRatio = 0.0f;
+    RadioDemodMode designDemod = RadioDemodMode::Cw;
+
+    // AM; the carrier level, taken off the envelope, and its smoothing per decimated sample
+    float amCarrier = 0.0f;
+    float amCarrierCoeff = 0.0f;
+
+    // Unit phasors, renormalized per chunk. Down by the marker at the device rate, up to the
+    // target center at the decimated rate. Float is plenty over a chunk.
+    float downRe = 1.0f;
+    float downIm = 0.0f;
+    float downStepRe = 1.0f;
+    float downStepIm = 0.0f;
+    float upRe = 1.0f;
+    float upIm = 0.0f;
+    float upStepRe = 1.0f;
+    float upStepIm = 0.0f;
+
+    std::vector<float> inBlock;             // Chunk input, for the AGC
+    std::vector<Zing::FftComplex> baseband; // Mixed, then decimated in place
+    std::vector<float> rateA;               // Interpolation ping-pong
+    std::vector<float> rateB;
+    std::vector<float> outBlock;            // Back at the device rate
+
+    std::vector<float> fifo;
+    uint32_t fifoRead = 0;
+    uint32_t fifoWrite = 0;
+
+    RadioAgcState agc;
+};
+
+// Low latency band pass. The skirt is laid out on the STFT's bins, turned into a minimum phase
+// analytic response and applied by uniformly partitioned convolution, with partitions the size of
+// the audio callback. The complex output is shifted to the target center and its real part kept.
+// Sharpness now costs partitions, not delay.
+// A design is several transforms the size of the grid, so responses are designed away from the
+// audio thread and copied in whole.
+constexpr uint32_t RadioConvMinBlock = 32;
+constexpr uint32_t RadioConvMaxBlock = 1024;
+
+// What a response is designed for; only an engine with the same rate and sizes takes it
+struct RadioConvDesign
+{
+    double sampleRate = 0.0;
+    uint32_t blockSize = 0;
+    uint32_t designSize = 0; // Grid the skirt is laid out on
+    double markerHz = -1.0;
+    double widthHz = 0.0;
+    float skirtRatio = 0.0f;
+    float falloff = 0.0f;
+};
+
+inline bool operator==(const RadioConvDesign& a, const RadioConvDesign& b)
+{
+    return ((a.sampleRate == b.sampleRate) && (a.blockSize == b.blockSize) && (a.designSize == b.designSize) && (a.markerHz == b.markerHz) && (a.widthHz == b.widthHz) && (a.skirtRatio == b.skirtRatio) && (a.falloff == b.falloff));
+}
+
+// A designed response, transformed partition by partition as the engine uses it
+struct RadioConvResponse
+{
+    RadioConvDesign design;
+    uint32_t partitions = 0;
+    double irDelay = 0.0; // Energy centroid of the response, in samples
+    std::vector<Zing::FftComplex> irSpectra;
+};
+
+// Makes the responses; keeps its own plans and work buffers, so it lives on the thread that designs
+struct RadioConvDesigner
+{
+    RadioSkirt skirt;
+    std::vector<float> magnitude;
+    Zing::MinimumPhase minPhase;
+    Zing::PartitionedConvolution conv; // Only transforms the partitions
+    RadioConvResponse response;        // The newest design
+};
+
+struct RadioConvState
+{
+    double sampleRate = 0.0;
+    uint32_t designSize = 0;
+    Zing::PartitionedConvolution conv;
+    RadioConvDesign design; // Of the response in use
+    double irDelay = 0.0;
+
+    // Unit phasor, from the marker the response was designed for to the target center;
+    // renormalized per block
+    double shiftRe = 1.0;
+    double shiftIm = 0.0;
+    double shiftStepRe = 1.0;
+    double shiftStepIm = 0.0;
+
+    // One block in, one block out; output plays a block behind the input
+    std::vector<float> inBlock;
+    std::vector<Zing::FftComplex> filtered;
+    std::vector<float> outBlock;
+    uint32_t fill = 0;
+
+    RadioAgcState agc;
+};
+
+// A snapshot of everything the DSP reads; the live radio takes a fresh one each callback
+struct RadioPipelineParams
+{
+    RadioSettings settings;
+    double sampleRate = 48000.0;
+    double markerHz = 1000.0;    // Center of the band to receive, in the real input
+    uint32_t fftSize = 2048;     // The STFT's, and the grid the partitioned response is laid out on
+    uint32_t blockFrames = 256;  // Callback size, which the partitions follow
+    Zing::FftBackend fftBackend = Zing::FftBackend::Kiss; // For the STFT's plans
+};
+
+struct RadioPipeline
+{
+    RadioPipelineParams params;
+    RadioAgcMeters meters;
+    RadioFilterMode activeMode = RadioFilterMode::Count; // Not sized yet
+    RadioFftState fft;
+    RadioFirState fir;
+    RadioConvState conv;
+};
+
+// The engine the marker receiver runs on; the phone modes always take the FIR chain
+RadioFilterMode radio_engine_mode(const RadioSettings& settings);
+
+// Sizes a pipeline for a snapshot: the engine it selects, that engine's buffers and FFT plans, all
+// from silence, with a first partitioned response. Allocates, and may lock the plan cache, so never
+// call it on the audio thread; the live radio builds a pipeline on the UI thread and hands it over.
+void radio_pipeline_init(RadioPipeline& pipeline, const RadioPipelineParams& params);
+
+// Whether a pipeline sized for one snapshot can take another without resizing: the same engine
+// and rate, and the same sizes for that engine
+bool radio_pipeline_fits(const RadioPipelineParams& sized, const RadioPipelineParams& params);
+
+// Takes a new snapshot, which must fit; the engine's design follows it. Never allocates.
+void radio_pipeline_set_params(RadioPipeline& pipeline, const RadioPipelineParams& params);
+
+// Designs the partitioned response for a snapshot into designer.response, if the snapshot has
+// moved since the last design; returns whether it did. Allocates, so not for the audio thread.
+bool radio_conv_design(RadioConvDesigner& designer, const RadioPipelineParams& params);
+
+// Copies a response into the partitioned engine, if that is what the pipeline runs, it is sized
+// for it and doesn't have it already. Never allocates.
+void radio_pipeline_set_conv_response(RadioPipeline& pipeline, const RadioConvResponse& response);
+
+// Output is a filter's delay behind the input; never allocates. Strided, so it can read and write
+// a channel of an interleaved buffer in place.
+void radio_pipeline_process(RadioPipeline& pipeline, const float* pInput, float* pOutput, uint32_t count, uint32_t inStride = 1, uint32_t outStride = 1);
+
+// Input to output delay of the engine in use, from its current design
+double radio_pipeline_latency_seconds(const RadioPipeline& pipeline);
+
+// Pieces the receiver bank shares: it runs the same STFT, with one forward transform for all of
+// its receivers
+void ensure_skirt_weights(RadioSkirt& skirt, double binHz, double widthHz, float skirtWidthRatio, float falloff);
+// Most bins a skirt can take at binHz, for the widest band pass the settings allow; reserve this
+// and ensure_skirt_weights never allocates
+uint32_t radio_skirt_max_bins(double binHz);
+void radio_fft_init(RadioFftState& state, uint32_t fftSize, uint32_t segmentCount, double sampleRate, Zing::FftBackend backend);
+void radio_fft_forward(RadioFftState& state, const RadioSettings::AgcSettings& inputAgc);
+// The rest of a hop, from a filtered spectrum: inverse, synthesis window, output AGC, and overlap-add
+// at fft's read position. The scratch, AGC and buffers are the caller's, so receivers can run it on
+// their own threads against one shared forward state.
+void radio_fft_synthesize(const RadioFftState& fft, const Zing::FftComplex* pSpectrum, Zing::FftComplex* pScratch, RadioAgcState& agc, const RadioSettings::AgcSettings& outputAgc, float gain, std::vector<float>& outBlock, std::vector<float>& olaSum);
+double radio_fft_latency_seconds(const RadioFftState& state);
+void apply_bandpass_bins(const RadioSkirt& skirt, const Zing::FftComplex* pIn, Zing::FftComplex* pOut, uint32_t fftSize, uint32_t frameStart, double binHz, double centerHz, double targetHz);
+void apply_agc_block(const std::vector<float>& input,
+                     float sampleRate,
+                     const RadioSettings::AgcSettings& settings,
+                     float& agcPower,
+                     float& agcGain,
+                     std::atomic<float>* powerOut,
+                     std::atomic<float>* powerOutPost,
+                     std::vector<float>* applyBlock);
@@ -32,6 +32,8 @@ RadioSettings radio_settings_load_settings(const toml::table& settings)
             return current;
         };
 
+        radioSettings.filterMode = RadioFilterMode(read_u32("radio_filter_mode", uint32_t(radioSettings.filterMode)));
+        radioSettings.demodMode = RadioDemodMode(read_u32("radio_demod_mode", uint32_t(radioSettings.demodMode)));
         radioSettings.fftHopDiv = read_u32("radio_fft_hop_div", radioSettings.fftHopDiv);
         radioSettings.enableFilter = read_bool("radio_enable_filter", radioSettings.enableFilter);
         radioSettings.markerWidthHz = read_float("radio_bandwidth_hz", radioSettings.markerWidthHz);
@@ -43,10 +45,38 @@ RadioSettings radio_settings_load_settings(const toml::table& settings)
         radioSettings.inputAgc.releaseMs = read_float("radio_agc_release", radioSettings.inputAgc.releaseMs);
         radioSettings.inputAgc.enabled = read_bool("radio_agc_enabled", radioSettings.inputAgc.enabled);
         radioSettings.outputGain = read_float("radio_output_gain", radioSettings.outputGain);
+        radioSettings.noiseReduction = read_float("radio_noise_reduction", radioSettings.noiseReduction);
         radioSettings.outputAgc.enabled = read_bool("radio_out_agc_enabled", radioSettings.outputAgc.enabled);
         radioSettings.outputAgc.targetDb = read_float("radio_out_agc_target", radioSettings.outputAgc.targetDb);
         radioSettings.outputAgc.attackMs = read_float("radio_out_agc_attack", radioSettings.outputAgc.attackMs);
         radioSettings.outputAgc.releaseMs = read_float("radio_out_agc_release", radioSettings.outputAgc.releaseMs);
+        radioSettings.cwDecoderEnabled = read_bool("radio_cw_decoder", radioSettings.cwDecoderEnabled);
+        radioSettings.cwInitialWpm = read_float("radio_cw_initial_wpm", radioSettings.cwInitialWpm);
+
+        // One table per slot, in order
+        if (auto pReceivers = settings["radio_receivers"].as_array())
+        {
+            const auto count = std::min(uint32_t(pReceivers->size()), RadioMaxReceivers);
+            for (uint32_t index = 0; index < count; index++)
+            {
+                auto pTable = pReceivers->get(index)->as_table();
+                if (!pTable)
+                    continue;
+
+                const auto& tab = *pTable;
+                auto& receiver = radioSettings.receivers[index];
+                receiver.enabled = tab["enabled"].value_or(receiver.enabled);
+                receiver.centerHz = tab["center_hz"].value_or(receiver.centerHz);
+                receiver.widthHz = tab["bandwidth_hz"].value_or(receiver.widthHz);
+                receiver.targetCenterHz = tab["target_center_hz"].value_or(receiver.targetCenterHz);
+                receiver.gain = tab["gain"].value_or(receiver.gain);
+                receiver.bus = uint32_t(tab["bus"].value_or(int64_t(receiver.bus)));
+                receiver.agc.enabled = tab["agc_enabled"].value_or(receiver.agc.enabled);
+                receiver.agc.targetDb = tab["agc_target"].value_or(receiver.agc.targetDb);
+                receiver.agc.attackMs = tab["agc_attack"].value_or(receiver.agc.attackMs);
+                receiver.agc.releaseMs = tab["agc_release"].value_or(receiver.agc.releaseMs);
+            }
+        }
     }
     catch (std::exception& ex)
     {
@@ -59,6 +89,8 @@ RadioSettings radio_settings_load_settings(const toml::table& settings)
 toml::table radio_settings_save_settings(const RadioSettings& settings)
 {
     toml::table tab;
+    tab.insert_or_assign("radio_filter_mode", int(settings.filterMode));
+    tab.insert_or_assign("radio_demod_mode", int(settings.demodMode));
     tab.insert_or_assign("radio_fft_hop_div", int(settings.fftHopDiv));
     tab.insert_or_assign("radio_enable_filter", settings.enableFilter);
     tab.insert_or_assign("radio_bandwidth_hz", settings.markerWidthHz);
@@ -70,15 +102,44 @@ toml::table radio_settings_save_settings(const RadioSettings& settings)
     tab.insert_or_assign("radio_agc_release", settings.inputAgc.releaseMs);
     tab.insert_or_assign("radio_agc_enabled", settings.inputAgc.enabled);
     tab.insert_or_assign("radio_output_gain", settings.outputGain);
+    tab.insert_or_assign("radio_noise_reduction", settings.noiseReduction);
     tab.insert_or_assign("radio_out_agc_enabled", settings.outputAgc.enabled);
     tab.insert_or_assign("radio_out_agc_target", settings.outputAgc.targetDb);
     tab.insert_or_assign("radio_out_agc_attack", settings.outputAgc.attackMs);
     tab.insert_or_assign("radio_out_agc_release", settings.outputAgc.releaseMs);
+    tab.insert_or_assign("radio_cw_decoder", settings.cwDecoderEnabled);
+    tab.insert_or_assign("radio_cw_initial_wpm", settings.cwInitialWpm);
+
+    toml::array receivers;
+    for (auto& receiver : settings.receivers)
+    {
+        toml::table receiverTab;
+        receiverTab.insert_or_assign("enabled", receiver.enabled);
+        receiverTab.insert_or_assign("center_hz", receiver.centerHz);
+        receiverTab.insert_or_assign("bandwidth_hz", receiver.widthHz);
+        receiverTab.insert_or_assign("target_center_hz", receiver.targetCenterHz);
+        receiverTab.insert_or_assign("gain", receiver.gain);
+        receiverTab.insert_or_assign("bus", int(receiver.bus));
+        receiverTab.insert_or_assign("agc_enabled", receiver.agc.enabled);
+        receiverTab.insert_or_assign("agc_target", receiver.agc.targetDb);
+        receiverTab.insert_or_assign("agc_attack", receiver.agc.attackMs);
+        receiverTab.insert_or_assign("agc_release", receiver.agc.releaseMs);
+        receivers.push_back(std::move(receiverTab));
+    }
+    tab.insert_or_assign("radio_receivers", std::move(receivers));
     return tab;
 }
 
 void radio_settings_validate_settings(RadioSettings& settings)
 {
+    if (uint32_t(settings.filterMode) >= uint32_t(RadioFilterMode::Count))
+    {
+        settings.filterMode = RadioFilterMode::Stft;
+    }
+    if (uint32_t(settings.demodMode) >= uint32_t(RadioDemodMode::Count))
+    {
+        settings.demodMode = RadioDemodMode::Cw;
+    }
     settings.fftHopDiv = std::clamp(settings.fftHopDiv, 1u, 8u);
     // Ensure hop div is a power of two
     if ((settings.fftHopDiv & (settings.fftHopDiv - 1)) != 0)
@@ -88,9 +149,9 @@ void radio_settings_validate_settings(RadioSettings& settings)
             v <<= 1;
         settings.fftHopDiv = v;
     }
-    settings.markerWidthHz = std::clamp(settings.markerWidthHz, 50.0f, 3000.0f);
+    settings.markerWidthHz = std::clamp(settings.markerWidthHz, 50.0f, RadioMaxWidthHz);
     settings.targetCenterHz = std::clamp(settings.targetCenterHz, 0.0f, 1000.0f);
-    settings.skirtWidthRatio = std::clamp(settings.skirtWidthRatio, 0.1f, 2.0f);
+    settings.skirtWidthRatio = std::clamp(settings.skirtWidthRatio, 0.1f, RadioMaxSkirtWidthRatio);
     settings.skirtFalloff = std::clamp(settings.skirtFalloff, 0.1f, 10.0f);
     auto validate_agc = [](RadioSettings::AgcSettings& agc) {
         if (agc.targetDb > 0.0f)
@@ -104,7 +165,18 @@ void radio_settings_validate_settings(RadioSettings& settings)
     };
     validate_agc(settings.inputAgc);
     validate_agc(settings.outputAgc);
+    for (auto& receiver : settings.receivers)
+    {
+        receiver.centerHz = std::clamp(receiver.centerHz, 0.0f, 96000.0f);
+        receiver.widthHz = std::clamp(receiver.widthHz, 50.0f, 3000.0f);
+        receiver.targetCenterHz = std::clamp(receiver.targetCenterHz, 0.0f, 1000.0f);
+        receiver.gain = std::clamp(receiver.gain, 0.1f, 50.0f);
+        receiver.bus = std::min(receiver.bus, RadioMaxBuses - 1);
+        validate_agc(receiver.agc);
+    }
     settings.outputGain = std::clamp(settings.outputGain, 0.1f, 50.0f);
+    settings.noiseReduction = std::clamp(settings.noiseReduction, 0.0f, 1.0f);
+    settings.cwInitialWpm = std::clamp(settings.cwInitialWpm, 5.0f, 60.0f);
 }
 } // namespace
 
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 
 #include <zest/file/toml_utils.h>
@@ -9,8 +10,46 @@
 #include <zest/logger/logger.h>
 #include <zest/settings/settings.h>
 
+// STFT filters in the frequency domain with one large transform per hop. FIR mixes the marker
+// to baseband, decimates, filters with a short channel FIR and interpolates back; much lower
+// latency, with a filter shape that follows the skirt width rather than matching it bin for bin.
+// Partitioned applies the STFT's skirt as a minimum phase impulse response, convolved in
+// partitions the size of the audio callback; the delay is about one callback.
+enum class RadioFilterMode : uint32_t
+{
+    Stft,
+    Fir,
+    Partitioned,
+    Count
+};
+
+// What the marker receiver makes of its band. CW is the band pass, moved to the target center, and
+// runs on the filter mode chosen. The phone modes run on the FIR chain, so at the decimated rate:
+// USB and LSB take the marker band as the audio passband, with the suppressed carrier at its low
+// and high edges, and demodulate it Weaver style; the band's center goes to DC, the channel FIR
+// keeps one side of it, and mixing up or down by half the width puts the carrier at 0Hz, the right
+// way up for either sideband. AM takes the carrier at the marker center and plays its envelope.
+enum class RadioDemodMode : uint32_t
+{
+    Cw,
+    Usb,
+    Lsb,
+    Am,
+    Count
+};
+
+// Receivers beyond the marker one; fixed slots, so the UI can edit them while the radio runs
+constexpr uint32_t RadioMaxReceivers = 8;
+constexpr uint32_t RadioMaxBuses = 8; // Output channels a receiver can be sent to
+
+// Widest band pass the settings allow; the engines size their skirts for it up front
+constexpr float RadioMaxWidthHz = 6000.0f; // Wide enough for AM
+constexpr float RadioMaxSkirtWidthRatio = 2.0f;
+
 struct RadioSettings
 {
+    RadioFilterMode filterMode = RadioFilterMode::Stft;
+    RadioDemodMode demodMode = RadioDemodMode::Cw;
     uint32_t fftHopDiv = 2; // hop = frames / hopDiv (2 = 50% overlap)
     bool enableFilter = true;
     float markerWidthHz = 500.0f;
@@ -18,6 +57,7 @@ struct RadioSettings
     float skirtWidthRatio = 0.5f;
     float skirtFalloff = 1.0f;
     float outputGain = 10.0f;
+    float noiseReduction = 0.0f; // STFT only; 0 is off, 1 takes the noise down by up to 30dB
     struct AgcSettings
     {
         bool enabled = true;
@@ -28,6 +68,24 @@ struct RadioSettings
     };
     AgcSettings inputAgc{};
     AgcSettings outputAgc{};
+
+    // Morse decoding of the marker receiver's output; the speed estimate starts from cwInitialWpm
+    bool cwDecoderEnabled = true;
+    float cwInitialWpm = 20.0f;
+
+    // A channel of its own: the band around centerHz, moved to targetCenterHz and mixed into the
+    // output channel given by bus, with its own output AGC
+    struct ReceiverSettings
+    {
+        bool enabled = false;
+        float centerHz = 1000.0f;
+        float widthHz = 500.0f;
+        float targetCenterHz = 750.0f;
+        float gain = 10.0f;
+        uint32_t bus = 0;
+        AgcSettings agc{};
+    };
+    std::array<ReceiverSettings, RadioMaxReceivers> receivers{};
 };
 
 RadioSettings& GetRadioSettings();
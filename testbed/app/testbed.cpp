@@ -12,6 +12,7 @@
 
 #include <zing/audio/audio.h>
 #include <zing/audio/audio_analysis.h>
+#include <zing/audio/cw_decoder.h>
 #include <zing/audio/midi.h>
 
 #include <config_testbed_app.h>
@@ -54,6 +55,17 @@ bool showDemoWindow = false;
 std::future<void> fontLoaderFuture;
 std::future<std::shared_ptr<libremidi::reader>> midiReaderFuture;
 
+// Radio DSP timing, run off the UI thread
+std::future<std::vector<RadioBenchmarkResult>> radioBenchmarkFuture;
+std::vector<RadioBenchmarkResult> radioBenchmarkResults;
+
+// Decoded Morse, and evaluations of the decoder on recordings or synthetic CW
+std::string cwText;
+std::future<RadioCwEvaluation> cwEvaluationFuture;
+std::optional<RadioCwEvaluation> cwEvaluation;
+float cwSyntheticWpm = 20.0f;
+float cwSyntheticSnrDb = -10.0f;
+
 } //namespace
 
 void register_windows()
@@ -266,6 +278,9 @@ void init()
 
     bulk_vendor_init();
 
+    radio_receivers_start();
+    radio_publish_params();
+
     audio_init([=](auto hostTime, auto pInput, auto pOutput, auto numSamples) {
         auto& ctx = GetAudioContext();
 
@@ -314,6 +329,7 @@ void tick()
 {
     auto& ctx = GetAudioContext();
     layout_manager_update();
+    radio_publish_params();
 }
 
 void draw_menu()
@@ -346,21 +362,8 @@ void update_analysis()
     auto& ctx = GetAudioContext();
     for (auto [Id, pAnalysis] : ctx.analysisChannels)
     {
-        // analysisDataCache-> <analysis thread> -> analysisData -> <ui thread> -> uiDataCache
-        // Find any data from the analysis thread
-        std::shared_ptr<AudioAnalysisData> spNewData;
-        while (pAnalysis->analysisData.try_dequeue(spNewData))
-        {
-            // If we cached data, then return it to the pool
-            if (pAnalysis->uiDataCache)
-            {
-                // Return to the pool
-                pAnalysis->analysisDataCache.enqueue(pAnalysis->uiDataCache);
-            }
-
-            // New copy
-            pAnalysis->uiDataCache = spNewData;
-        }
+        // Newest complete frame from the analysis; older unread ones are skipped and counted
+        pAnalysis->uiDataCache = triple_buffer_read(pAnalysis->results);
     }
 }
 
@@ -509,6 +512,23 @@ void draw()
                 };
                 if (ImGui::CollapsingHeader("Band Pass Filter", ImGuiTreeNodeFlags_None))
                 {
+                    int demodMode = int(radioSettings.demodMode);
+                    if (ImGui::Combo("Mode##bandpass_demod", &demodMode, "CW\0USB\0LSB\0AM\0"))
+                    {
+                        radioSettings.demodMode = RadioDemodMode(demodMode);
+                    }
+
+                    // The phone modes always run on the FIR chain
+                    const bool cwMode = radioSettings.demodMode == RadioDemodMode::Cw;
+                    ImGui::BeginDisabled(!cwMode);
+                    int filterMode = int(radio_engine_mode(radioSettings));
+                    if (ImGui::Combo("Filter##bandpass_mode", &filterMode, "STFT\0FIR\0Partitioned\0"))
+                    {
+                        radioSettings.filterMode = RadioFilterMode(filterMode);
+                    }
+                    ImGui::EndDisabled();
+                    ImGui::Text("Latency (ms): %.1f", radio_latency_ms());
+
                     int hopDivOptions[] = {1, 2, 4, 8};
                     int hopDivIndex = 0;
                     for (int i = 0; i < 4; ++i)
@@ -531,7 +551,7 @@ void draw()
                     }
 
                     float markerWidth = radioSettings.markerWidthHz;
-                    if (ImGui::SliderFloat("Bandwidth (Hz)##bandpass_width", &markerWidth, 50.0f, 3000.0f, "%.0f"))
+                    if (ImGui::SliderFloat("Bandwidth (Hz)##bandpass_width", &markerWidth, 50.0f, 6000.0f, "%.0f", ImGuiSliderFlags_Logarithmic))
                     {
                         radioSettings.markerWidthHz = markerWidth;
                         Waterfall_Get().markerWidthHz = markerWidth;
@@ -543,11 +563,22 @@ void draw()
                         radioSettings.outputGain = outputGain;
                     }
 
+                    // Works on the STFT's bins, so only that filter has it
+                    ImGui::BeginDisabled(radio_engine_mode(radioSettings) != RadioFilterMode::Stft);
+                    float noiseReduction = radioSettings.noiseReduction;
+                    if (ImGui::SliderFloat("Noise Reduction##bandpass_noise_reduction", &noiseReduction, 0.0f, 1.0f, "%.2f"))
+                    {
+                        radioSettings.noiseReduction = noiseReduction;
+                    }
+                    ImGui::EndDisabled();
+
+                    ImGui::BeginDisabled(!cwMode);
                     float targetCenterHz = radioSettings.targetCenterHz;
                     if (ImGui::SliderFloat("Target Center (Hz)##bandpass_target_center", &targetCenterHz, 0.0f, 1000.0f, "%.0f"))
                     {
                         radioSettings.targetCenterHz = targetCenterHz;
                     }
+                    ImGui::EndDisabled();
 
                     float skirtFalloff = radioSettings.skirtFalloff;
                     if (ImGui::SliderFloat("Skirt Falloff##bandpass_skirt_falloff", &skirtFalloff, 0.1f, 10.0f, "%.2f"))
@@ -660,6 +691,236 @@ void draw()
                     ImGui::PopStyleColor();
                     ImGui::Text("Power (dB): %.1f", outAgcPowerDb);
                 }
+
+                if (ImGui::CollapsingHeader("Receivers", ImGuiTreeNodeFlags_None))
+                {
+                    const auto stats = radio_receivers_stats();
+                    ImGui::Text("Active: %u  Forward FFT: %.1f us/hop  Receivers: %.1f us/hop", stats.activeReceivers, stats.forwardUs, stats.receiversUs);
+                    ImGui::Text("Latency (ms): %.1f  Underruns: %llu  Dropped: %llu", stats.latencyMs, (unsigned long long)stats.underruns, (unsigned long long)stats.droppedBlocks);
+
+                    // Into the first free slot, listening where the marker is
+                    if (ImGui::Button("Add at Marker##receivers_add"))
+                    {
+                        for (auto& receiver : radioSettings.receivers)
+                        {
+                            if (!receiver.enabled)
+                            {
+                                receiver.centerHz = float(std::abs(radio_marker_center_hz()));
+                                receiver.widthHz = std::min(radioSettings.markerWidthHz, 3000.0f);
+                                receiver.targetCenterHz = radioSettings.targetCenterHz;
+                                receiver.gain = radioSettings.outputGain;
+                                receiver.enabled = true;
+                                break;
+                            }
+                        }
+                    }
+
+                    const float nyquist = float(ctx.audioDeviceSettings.sampleRate) * 0.5f;
+                    const int maxBus = int(std::clamp(ctx.outputState.channelCount, 1u, RadioMaxBuses)) - 1;
+                    for (uint32_t index = 0; index < RadioMaxReceivers; index++)
+                    {
+                        auto& receiver = radioSettings.receivers[index];
+                        if (!receiver.enabled)
+                        {
+                            continue;
+                        }
+
+                        ImGui::PushID(int(index));
+                        if (ImGui::TreeNode("Receiver", "Receiver %u: %.0f Hz", index + 1, receiver.centerHz))
+                        {
+                            float centerHz = receiver.centerHz;
+                            if (ImGui::SliderFloat("Center (Hz)", &centerHz, 0.0f, nyquist, "%.0f"))
+                            {
+                                receiver.centerHz = centerHz;
+                            }
+                            float widthHz = receiver.widthHz;
+                            if (ImGui::SliderFloat("Bandwidth (Hz)", &widthHz, 50.0f, 3000.0f, "%.0f"))
+                            {
+                                receiver.widthHz = widthHz;
+                            }
+                            float targetHz = receiver.targetCenterHz;
+                            if (ImGui::SliderFloat("Target Center (Hz)", &targetHz, 0.0f, 1000.0f, "%.0f"))
+                            {
+                                receiver.targetCenterHz = targetHz;
+                            }
+                            float gain = receiver.gain;
+                            if (ImGui::SliderFloat("Gain", &gain, 0.1f, 50.0f, "%.2f"))
+                            {
+                                receiver.gain = gain;
+                            }
+                            int bus = std::min(int(receiver.bus), maxBus);
+                            if (ImGui::SliderInt("Output Channel", &bus, 0, maxBus))
+                            {
+                                receiver.bus = uint32_t(bus);
+                            }
+                            bool agcEnabled = receiver.agc.enabled;
+                            if (ImGui::Checkbox("AGC", &agcEnabled))
+                            {
+                                receiver.agc.enabled = agcEnabled;
+                            }
+                            ImGui::SameLine();
+                            if (ImGui::Button("Remove"))
+                            {
+                                receiver.enabled = false;
+                            }
+
+                            ImGui::PushStyleColor(ImGuiCol_PlotHistogram, IM_COL32(0, 200, 0, 255));
+                            ImGui::ProgressBar(agc_bar(radio_receiver_power(index)), ImVec2(-1.0f, 6.0f), "");
+                            ImGui::PopStyleColor();
+                            ImGui::TreePop();
+                        }
+                        ImGui::PopID();
+                    }
+                }
+
+                // Read even when collapsed, so the queue doesn't fill up
+                std::array<char, 256> cwChars;
+                while (auto count = radio_cw_read_text(cwChars.data(), uint32_t(cwChars.size())))
+                {
+                    cwText.append(cwChars.data(), count);
+                }
+                if (cwText.size() > 4096)
+                {
+                    cwText.erase(0, cwText.size() - 4096);
+                }
+
+                if (ImGui::CollapsingHeader("CW Decoder", ImGuiTreeNodeFlags_None))
+                {
+                    ImGui::Checkbox("Enabled##cw_enabled", &radioSettings.cwDecoderEnabled);
+                    ImGui::SameLine();
+                    ImGui::Text("WPM: %.1f  SNR (dB): %.1f", radio_cw_wpm(), radio_cw_snr_db());
+                    float initialWpm = radioSettings.cwInitialWpm;
+                    if (ImGui::SliderFloat("Initial WPM##cw_initial_wpm", &initialWpm, 5.0f, 60.0f, "%.0f"))
+                    {
+                        radioSettings.cwInitialWpm = initialWpm;
+                    }
+
+                    ImGui::BeginChild("CwText", ImVec2(-1.0f, ImGui::GetTextLineHeightWithSpacing() * 4.0f), true);
+                    ImGui::TextWrapped("%s", cwText.c_str());
+                    if (ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
+                    {
+                        ImGui::SetScrollHereY(1.0f);
+                    }
+                    ImGui::EndChild();
+                    if (ImGui::Button("Clear##cw_clear"))
+                    {
+                        cwText.clear();
+                    }
+
+                    // Offline runs through the filter in use and a fresh decoder. A recording is
+                    // scored against the text in a .txt file next to it, if there is one.
+                    if (cwEvaluationFuture.valid())
+                    {
+                        if (cwEvaluationFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                        {
+                            cwEvaluation = cwEvaluationFuture.get();
+                        }
+                        else
+                        {
+                            ImGui::TextUnformatted("Evaluating...");
+                        }
+                    }
+                    else
+                    {
+                        if (ImGui::Button("Evaluate Recording##cw_eval_file"))
+                        {
+                            char const* lFilterPatterns[1] = {"*.sdr"};
+                            auto pTarget = tinyfd_openFileDialog("Evaluate Recording", "c:/cw.sdr", 1, lFilterPatterns, "SDR CW Files", false);
+                            if (pTarget != nullptr)
+                            {
+                                auto filePath = fs::path(pTarget);
+                                auto input = file_read(filePath);
+                                std::vector<float> samples(input.size() / 4);
+                                memcpy(samples.data(), input.data(), samples.size() * 4);
+
+                                std::string reference;
+                                auto referencePath = fs::path(filePath).replace_extension(".txt");
+                                if (fs::exists(referencePath))
+                                {
+                                    auto text = file_read(referencePath);
+                                    reference.assign(text.begin(), text.end());
+                                }
+                                cwEvaluationFuture = std::async(std::launch::async, [params = radio_live_params(GetRadioSettings()), samples = std::move(samples), reference = std::move(reference)]() {
+                                    return radio_cw_evaluate(params, samples, reference);
+                                });
+                            }
+                        }
+
+                        ImGui::SliderFloat("Synthetic WPM##cw_synth_wpm", &cwSyntheticWpm, 5.0f, 60.0f, "%.0f");
+                        ImGui::SliderFloat("Synthetic SNR (dB)##cw_synth_snr", &cwSyntheticSnrDb, -30.0f, 20.0f, "%.0f");
+                        if (ImGui::Button("Evaluate Synthetic##cw_eval_synth"))
+                        {
+                            // Keyed on the marker, so the filter passes it; the SNR is over the whole band
+                            const auto toneHz = std::abs(radio_marker_center_hz());
+                            const auto sampleRate = float(std::max(1u, ctx.audioDeviceSettings.sampleRate));
+                            cwEvaluationFuture = std::async(std::launch::async, [params = radio_live_params(GetRadioSettings()), toneHz, sampleRate, wpm = cwSyntheticWpm, snrDb = cwSyntheticSnrDb]() {
+                                const std::string reference = "CQ CQ DE M0ABC M0ABC K THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 73";
+                                return radio_cw_evaluate(params, cw_synthesize(reference, wpm, toneHz, sampleRate, snrDb, 1), reference);
+                            });
+                        }
+                    }
+
+                    if (cwEvaluation)
+                    {
+                        ImGui::Text("%s: %.1f s  WPM: %.1f  SNR (dB): %.1f", radio_filter_mode_name(cwEvaluation->mode), cwEvaluation->seconds, cwEvaluation->wpm, cwEvaluation->snrDb);
+                        if (cwEvaluation->characterErrorRate >= 0.0)
+                        {
+                            ImGui::Text("Character error rate: %.1f%%", cwEvaluation->characterErrorRate * 100.0);
+                        }
+                        ImGui::Text("Filter: %.1f ns/sample  Decoder: %.1f ns/sample  %.0fx real time", cwEvaluation->filterNsPerSample, cwEvaluation->decoderNsPerSample, cwEvaluation->realtimeFactor);
+                        ImGui::TextWrapped("%s", cwEvaluation->text.c_str());
+                    }
+                }
+
+                if (ImGui::CollapsingHeader("Benchmark##radio", ImGuiTreeNodeFlags_None))
+                {
+                    if (radioBenchmarkFuture.valid())
+                    {
+                        if (radioBenchmarkFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                        {
+                            radioBenchmarkResults = radioBenchmarkFuture.get();
+                        }
+                        else
+                        {
+                            ImGui::TextUnformatted("Benchmarking...");
+                        }
+                    }
+                    else if (ImGui::Button("Run Benchmark##radio_benchmark"))
+                    {
+                        // The snapshot is taken here; the live state is the UI thread's to read
+                        radioBenchmarkFuture = std::async(std::launch::async, [params = radio_live_params(GetRadioSettings())]() {
+                            return radio_benchmark(params, 2.0);
+                        });
+                    }
+
+                    if (!radioBenchmarkResults.empty() && ImGui::BeginTable("RadioBenchmark", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchSame))
+                    {
+                        ImGui::TableSetupColumn("Mode");
+                        ImGui::TableSetupColumn("Filter");
+                        ImGui::TableSetupColumn("Frames");
+                        ImGui::TableSetupColumn("ns/sample");
+                        ImGui::TableSetupColumn("us/callback");
+                        ImGui::TableSetupColumn("Latency (ms)");
+                        ImGui::TableHeadersRow();
+                        for (auto& result : radioBenchmarkResults)
+                        {
+                            ImGui::TableNextRow();
+                            ImGui::TableSetColumnIndex(0);
+                            ImGui::TextUnformatted(radio_demod_mode_name(result.demod));
+                            ImGui::TableSetColumnIndex(1);
+                            ImGui::TextUnformatted(radio_filter_mode_name(result.mode));
+                            ImGui::TableSetColumnIndex(2);
+                            ImGui::Text("%u", result.callbackFrames);
+                            ImGui::TableSetColumnIndex(3);
+                            ImGui::Text("%.1f", result.nsPerSample);
+                            ImGui::TableSetColumnIndex(4);
+                            ImGui::Text("%.2f", result.usPerCallback);
+                            ImGui::TableSetColumnIndex(5);
+                            ImGui::Text("%.1f", result.latencyMs);
+                        }
+                        ImGui::EndTable();
+                    }
+                }
             }
 
         }
@@ -682,6 +943,8 @@ void cleanup()
 
     layout_manager_save();
 
+    radio_receivers_stop();
+
     // Get the settings
     audio_destroy();
 }
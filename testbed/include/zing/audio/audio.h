@@ -2,6 +2,8 @@
 
 #include <zing/pch.h>
 
+#include <semaphore>
+
 #include <zest/thread/thread_utils.h>
 
 #include <zing/audio/audio_analysis_settings.h>
@@ -26,7 +28,12 @@ struct tsf;
 #include <ableton/platforms/Config.hpp>
 #include <ableton/Link.hpp>
 
-#include <kiss_fftr.h>
+#include <zing/audio/cw_skimmer.h>
+#include <zing/audio/fft.h>
+#include <zing/audio/sample_ring.h>
+#include <zing/audio/spectrum_partition.h>
+#include <zing/audio/triple_buffer.h>
+#include <zing/audio/zoom_fft.h>
 
 union SDL_Event;
 
@@ -38,12 +45,6 @@ using ChannelId = std::pair<uint32_t, uint32_t>;
 constexpr uint32_t Channel_Out = 0;
 constexpr uint32_t Channel_In = 1;
 
-struct AudioBundle
-{
-    ChannelId channel;
-    std::vector<float> data;
-};
-
 struct AudioSettings
 {
     std::atomic<bool> enableMetronome = false;
@@ -80,39 +81,87 @@ struct AudioChannelState
     double deltaTime = 1.0f / (double)sampleRate;
 };
 
+struct AudioSpectrumPeak
+{
+    double hz = 0.0;          // Interpolated between bins
+    uint32_t bin = 0;         // Nearest bin
+    float powerDb = 0.0f;     // dBFS; a full scale sine at the peak is 0dB
+    float snrDb = 0.0f;       // Above the lowest noise floor within a few bins of the peak
+    uint32_t persistence = 1; // Consecutive spectra with a peak within a bin or so of this one
+};
+
 struct AudioAnalysisData
 {
     // Double buffer the data
     std::vector<float> spectrumBuckets;
     std::vector<float> spectrum;
-    std::vector<float> audio;
+    std::vector<float> audio; // Snapshot of the history the spectrum was taken from, for display
+
+    // Noise floor from minimum statistics over the last noiseWindowSeconds; normalized like
+    // spectrum, per bin and per bucket. noiseFloorLevel is the bucket mean, for scaling displays.
+    std::vector<float> noiseFloor;
+    std::vector<float> noiseFloorBuckets;
+    float noiseFloorLevel = 0.0f;
+
+    // Running sum of the linear bin power; cumulativePower[k] covers bins [0, k). Scaled by the
+    // window's noise bandwidth so a band sums to its mean square power (a full scale sine is 0.5).
+    // Query it with audio_analysis_band_power.
+    std::vector<double> cumulativePower;
+    double binHz = 0.0;
+
+    // Frequency of spectrum[0]; -Nyquist for a two sided I/Q spectrum
+    double minHz = 0.0;
+    // Mean square power of a full scale sine, or of a full scale complex tone for I/Q; 0dBFS
+    float fullScalePower = 0.5f;
+
+    // Strongest local maxima above the noise floor, strongest first
+    std::vector<AudioSpectrumPeak> peaks;
+
+    // Morse decoded across the band by the skimmer, when it is on; input channel 0 only
+    std::vector<CwSpot> spots;
+
+    // Zoom spectrum, normalized like spectrum; the usable part of the zoom span.
+    // Bin i is centered on zoomMinHz + i * (zoomMaxHz - zoomMinHz) / zoomSpectrum.size()
+    std::vector<float> zoomSpectrum;
+    double zoomMinHz = 0.0;
+    double zoomMaxHz = 0.0;
     uint32_t currentBuffer = 0;
     std::vector<float> frameCache;
 };
 
-struct SpectrumPartitionSettings
-{
-    uint32_t limit = 0;
-    uint32_t n = 0;
-};
-
-inline bool operator==(const SpectrumPartitionSettings& a, const SpectrumPartitionSettings& b)
-{
-    return ((a.limit == b.limit) && (a.n == b.n));
-}
-
 // Channel_In/Out/?, count
 using ChannelId = std::pair<uint32_t, uint32_t>;
 
+struct AudioAnalysisHistorySpans
+{
+    const float* pFirst = nullptr;
+    uint32_t firstCount = 0;
+    const float* pSecond = nullptr;
+    uint32_t secondCount = 0;
+};
+
 struct AudioAnalysis
 {
     // FFT
-    kiss_fftr_cfg cfg;
-    std::vector<kiss_fft_scalar> fftIn;
-    std::vector<kiss_fft_cpx> fftOut;
+    const FftPlan* fftPlan = nullptr; // Owned by the FFT plan cache
+    std::vector<float> fftIn;
+    std::vector<FftComplex> fftOut;
     std::vector<float> fftMag;
+    std::vector<float> welchMag; // Power of the older Welch segments, before it is summed into fftMag
+    uint32_t welchSegments = 1;  // Segments in the last spectrum
     std::vector<float> window;
 
+    // Sample history; a ring of the most recent input, shared by every output buffer.
+    // historyWrite is the next slot to write, so it is also the oldest sample once full.
+    std::vector<float> history;
+    uint32_t historyWrite = 0;
+    float audioMin = 0.0f;
+    float audioMax = 0.0f;
+
+    // Samples since the last spectrum (worker) and since the last wake (audio thread)
+    uint32_t hopSamples = 0;
+    uint32_t postedSamples = 0;
+
     AudioChannelState channel;
     ChannelId thisChannel;
 
@@ -122,31 +171,87 @@ struct AudioAnalysis
 
     uint32_t outputSamples = 0; // The FFT output frames
 
+    // Input channels 0/1 as one I/Q stream; ring blocks and the history hold interleaved I, Q pairs,
+    // and the spectrum is two sided, fft-shifted so -Nyquist comes first
+    bool iq = false;
+    std::vector<FftComplex> fftInComplex;
+
     float totalWin = 0.0f;
+    float windowEnbw = 1.0f; // Equivalent noise bandwidth of the window, in bins
 
-    float currentMaxSpectrum;
-    uint32_t maxSpectrumIndex;
+    // Strongest peak of the last spectrum, normalized like the spectrum, and its bin
+    float currentMaxSpectrum = 0.0f;
+    uint32_t maxSpectrumIndex = 0;
 
     std::atomic<glm::vec4> spectrumBands = glm::vec4(0.0);
 
     bool fftConfigured = false;
     bool audioActive = false;
-    std::atomic_bool quitThread = true;
-    std::atomic_bool exited = true;
-    std::thread analysisThread;
 
-    std::vector<float> spectrumPartitions;
-    SpectrumPartitionSettings lastSpectrumPartitions;
+    // Set while a scheduler worker owns this channel; blocks must be processed in order
+    std::atomic_bool busy = false;
+
+    SpectrumPartition spectrumPartition;
     std::vector<float> spectrumBucketsEma;
 
-    // Bundles pending processing
-    moodycamel::ConcurrentQueue<std::shared_ptr<AudioBundle>> processBundles;
+    // Minimum statistics noise floor state, per bin, in linear power
+    std::vector<float> noiseSmoothed;
+    std::vector<float> noiseActiveMin; // Minimum over the current sub-window
+    std::vector<float> noiseSubMins;   // Minimum of each of the previous sub-windows, a row each
+    std::vector<float> noiseWindowMin; // Minimum over noiseSubMins
+    uint32_t noiseSubIndex = 0;
+    uint32_t noiseSubSpectra = 0;      // Spectra so far in the current sub-window
+    std::vector<float> noiseFloorPower; // The floor itself, before it goes to dB
+
+    std::vector<uint32_t> peakCandidates; // Bins
+    std::vector<AudioSpectrumPeak> previousPeaks;
+
+    CwSkimmer skimmer;
+
+    // Narrowband zoom around ctx.analysisZoomCenterHz; fed every block, transformed every hop
+    ZoomFft zoom;
+    std::vector<float> zoomPower;
 
-    moodycamel::ConcurrentQueue<std::shared_ptr<AudioAnalysisData>> analysisData;
-    moodycamel::ConcurrentQueue<std::shared_ptr<AudioAnalysisData>> analysisDataCache;
+    // Samples from the audio thread, deinterleaved straight into preallocated blocks
+    SampleRing ring;
 
-    // Current UI Cache; only used on the UI thread
-    std::shared_ptr<AudioAnalysisData> uiDataCache;
+    // Results, written by whichever worker owns the channel and read by the UI
+    TripleBuffer<AudioAnalysisData> results;
+
+    // The newest results; only used on the UI thread, and valid until it next reads the buffer
+    const AudioAnalysisData* uiDataCache = nullptr;
+};
+
+// A range of work split into chunks, shared between whichever workers are free.
+// Lives on the posting thread's stack until every chunk has finished.
+struct AudioAnalysisParallelJob
+{
+    const FftParallelRange* pFn = nullptr;
+    uint32_t count = 0;
+    uint32_t chunkSize = 0;
+    uint32_t chunks = 0;
+    uint32_t nextChunk = 0;              // Guarded by the scheduler's jobMutex
+    std::atomic<uint32_t> remaining = 0; // Chunks not yet finished
+};
+
+// A fixed pool of workers shared by all analysis channels.
+// Workers sleep on the semaphore until the audio thread posts a block, then take
+// whichever channel has pending work. A worker with a large transform can post it as a
+// parallel job, and idle workers help with it before looking for more blocks.
+struct AudioAnalysisScheduler
+{
+    std::vector<std::thread> workers;
+    std::vector<std::shared_ptr<AudioAnalysis>> channels;
+
+    std::counting_semaphore<> wake{ 0 };
+    std::atomic<uint32_t> sleepingWorkers = 0;
+    std::atomic<uint32_t> pendingBlocks = 0;
+    std::atomic<uint32_t> nextChannel = 0;
+    std::atomic_bool quit = true;
+
+    std::mutex jobMutex;
+    std::vector<AudioAnalysisParallelJob*> jobs;
+    std::atomic<uint32_t> jobCount = 0;
 };
 
 using fnMidiBroadcast = std::function<void(const libremidi::message&)>;
@@ -170,9 +275,10 @@ struct AudioContext
     // so use system mutex, we don't need to spin
     std::map<ChannelId, std::shared_ptr<AudioAnalysis>> analysisChannels;
     AudioAnalysisSettings audioAnalysisSettings;
+    AudioAnalysisScheduler analysisScheduler;
 
-    std::atomic<uint64_t> analysisWriteGeneration = 0;
-    std::atomic<uint64_t> analysisReadGeneration = 0;
+    // Center of the zoom analysis; the UI keeps it on the waterfall marker
+    std::atomic<double> analysisZoomCenterHz = 1000.0;
 
     std::thread::id threadId;
     std::vector<std::string> m_deviceNames;
@@ -189,8 +295,6 @@ struct AudioContext
     PaStreamParameters m_outputParams;
     PaStream* m_pStream = nullptr;
     
-    // Bundles of audio data passed out of the audio thread to analysis
-    moodycamel::ConcurrentQueue<std::shared_ptr<AudioBundle>> spareBundles;
 
     std::atomic<std::chrono::microseconds> m_outputLatency;
 
@@ -239,8 +343,6 @@ void audio_destroy();
 void audio_show_link_gui();
 void audio_show_settings_gui();
 
-std::shared_ptr<AudioBundle> audio_get_bundle();
-void audio_retire_bundle(std::shared_ptr<AudioBundle>& pBundle);
 
 std::string audio_to_channel_name(ChannelId Id);
 ChannelId audio_to_channel_id(uint32_t type, uint32_t channel);
@@ -11,8 +11,48 @@ void audio_analysis_destroy_all();
 void audio_analysis_create_all();
 
 bool audio_analysis_start(AudioAnalysis& analyis, const AudioChannelState& state);
-void audio_analysis_stop(AudioAnalysis& analyis);
-void audio_analysis_update(AudioAnalysis& analysis, AudioBundle& bundle);
+// Count is in floats; frames * 2 for I/Q
+void audio_analysis_update(AudioAnalysis& analysis, const float* pSamples, uint32_t count);
+
+// How the current settings spread spectrum bins over the display buckets; shared by the
+// analysis, the plots and anything mapping a display position (the marker) to Hz.
+// Two sided is for the spectra of I/Q channels.
+SpectrumPartitionSettings audio_analysis_partition_settings(bool twoSided = false);
+
+// True if the channel is analysed as an I/Q pair, with a two sided spectrum
+bool audio_analysis_is_iq(const ChannelId& id);
+
+// Samples between spectra, from the requested spectra per second
+uint32_t audio_analysis_hop_size(const AudioAnalysis& analysis);
+
+// Mean square power between loHz and hiHz, from the spectrum's prefix sum; O(1) for any band.
+// Band edges fall between bins proportionally. Bins spread a sine over the window's main lobe,
+// so a band should be a few bins wider than the signal it is meant to catch.
+float audio_analysis_band_power(const AudioAnalysisData& data, double loHz, double hiHz);
+
+void audio_analysis_history_write(AudioAnalysis& analysis, const float* pSamples, uint32_t count);
+AudioAnalysisHistorySpans audio_analysis_history_spans(const AudioAnalysis& analysis, uint32_t count);
+
+void audio_analysis_scheduler_start(AudioAnalysisScheduler& scheduler, uint32_t workerCount, const std::vector<std::shared_ptr<AudioAnalysis>>& channels);
+void audio_analysis_scheduler_stop(AudioAnalysisScheduler& scheduler);
+
+// Splits [0, count) between the calling thread and any idle workers; returns when all of it is done.
+// The caller always takes part, so this is safe to call from a worker even if the others are busy.
+void audio_analysis_parallel_for(AudioAnalysisScheduler& scheduler, uint32_t count, const FftParallelRange& fn);
+
+struct AudioAnalysisScalingResult
+{
+    uint32_t threads = 0;
+    double nsPerTransform = 0.0;
+    double speedup = 0.0; // Against the direct transform on one thread
+};
+
+// Times a size point real FFT on private worker pools of 1..maxThreads threads.
+// Slow; call off the audio and UI threads.
+std::vector<AudioAnalysisScalingResult> audio_analysis_benchmark_scaling(uint32_t size, uint32_t maxThreads, double secondsPerCount = 0.25);
+
+// Audio thread; after publishing frames to the channel's ring, wake a worker if a spectrum is due
+void audio_analysis_post(AudioAnalysis& analysis, uint32_t frames);
 
 uint32_t audio_analysis_read_index(AudioAnalysisData& analysis);
 uint32_t audio_analysis_write_index(AudioAnalysisData& analysis);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <bit>
 #include <cmath>
 
 #include <zest/file/toml_utils.h>
@@ -16,6 +17,24 @@ struct AudioAnalysisSettings
 {
     uint32_t frames = 4096;
     uint32_t spectrumBuckets = 512;
+    uint32_t spectrumScale = 0; // SpectrumScale
+    float spectrumZoomMinHz = 300.0f;
+    float spectrumZoomMaxHz = 1100.0f;
+    uint32_t analysisThreads = 2;
+    bool iqInput = false;           // Input channels 0/1 are I/Q, analysed as one complex stream
+    uint32_t fftBackend = 1; // FftBackend::SplitRadix
+    float spectraPerSecond = 60.0f; // Sets the analysis hop, independent of the device buffer size
+    bool zoomEnabled = false;       // Narrowband zoom FFT around the waterfall marker
+    uint32_t zoomDecimation = 32;   // Power of 2; the zoom spans sampleRate / zoomDecimation
+    uint32_t zoomFrames = 2048;     // Zoom FFT size at the decimated rate
+    uint32_t welchSegments = 1;     // Overlapping segments averaged into each spectrum; 1 is a plain periodogram
+    float welchOverlap = 0.5f;      // Fraction of a segment shared with the next
+    float noiseWindowSeconds = 1.5f; // Minimum statistics window for the noise floor
+    uint32_t peakCount = 16;        // Strongest spectral peaks listed per spectrum
+    float peakMinSnrDb = 6.0f;      // Above the noise floor
+    bool skimmerEnabled = false;    // Decode Morse on every strong enough carrier in the band
+    uint32_t skimmerTracks = 32;    // Signals decoded at once
+    float skimmerSnrDb = 12.0f;     // Above the noise floor, to start decoding a signal
     float blendFactor = 100.0f;
     bool blendFFT = true;
     bool filterFFT = true;
@@ -43,6 +62,24 @@ inline AudioAnalysisSettings audioanalysis_load_settings(const toml::table& sett
     {
         analysisSettings.frames = settings["frames"].value_or(analysisSettings.frames);
         analysisSettings.spectrumBuckets = settings["spectrum_buckets"].value_or(analysisSettings.spectrumBuckets);
+        analysisSettings.spectrumScale = settings["spectrum_scale"].value_or(analysisSettings.spectrumScale);
+        analysisSettings.spectrumZoomMinHz = settings["spectrum_zoom_min_hz"].value_or(analysisSettings.spectrumZoomMinHz);
+        analysisSettings.spectrumZoomMaxHz = settings["spectrum_zoom_max_hz"].value_or(analysisSettings.spectrumZoomMaxHz);
+        analysisSettings.analysisThreads = settings["analysis_threads"].value_or(analysisSettings.analysisThreads);
+        analysisSettings.fftBackend = settings["fft_backend"].value_or(analysisSettings.fftBackend);
+        analysisSettings.spectraPerSecond = settings["spectra_per_second"].value_or(analysisSettings.spectraPerSecond);
+        analysisSettings.zoomEnabled = settings["zoom_enabled"].value_or(analysisSettings.zoomEnabled);
+        analysisSettings.zoomDecimation = settings["zoom_decimation"].value_or(analysisSettings.zoomDecimation);
+        analysisSettings.zoomFrames = settings["zoom_frames"].value_or(analysisSettings.zoomFrames);
+        analysisSettings.welchSegments = settings["welch_segments"].value_or(analysisSettings.welchSegments);
+        analysisSettings.welchOverlap = settings["welch_overlap"].value_or(analysisSettings.welchOverlap);
+        analysisSettings.noiseWindowSeconds = settings["noise_window_seconds"].value_or(analysisSettings.noiseWindowSeconds);
+        analysisSettings.iqInput = settings["iq_input"].value_or(analysisSettings.iqInput);
+        analysisSettings.peakCount = settings["peak_count"].value_or(analysisSettings.peakCount);
+        analysisSettings.peakMinSnrDb = settings["peak_min_snr_db"].value_or(analysisSettings.peakMinSnrDb);
+        analysisSettings.skimmerEnabled = settings["skimmer_enabled"].value_or(analysisSettings.skimmerEnabled);
+        analysisSettings.skimmerTracks = settings["skimmer_tracks"].value_or(analysisSettings.skimmerTracks);
+        analysisSettings.skimmerSnrDb = settings["skimmer_snr_db"].value_or(analysisSettings.skimmerSnrDb);
         analysisSettings.blendFactor = settings["blend_factor"].value_or(analysisSettings.blendFactor);
         analysisSettings.blendFFT = settings["blend_fft"].value_or(analysisSettings.blendFFT);
         analysisSettings.filterFFT = settings["filter_fft"].value_or(analysisSettings.filterFFT);
@@ -73,6 +110,24 @@ inline toml::table audioanalysis_save_settings(const AudioAnalysisSettings& sett
     auto tab = toml::table{
         { "frames", int(settings.frames) },
         { "spectrum_buckets", int(settings.spectrumBuckets) },
+        { "spectrum_scale", int(settings.spectrumScale) },
+        { "spectrum_zoom_min_hz", settings.spectrumZoomMinHz },
+        { "spectrum_zoom_max_hz", settings.spectrumZoomMaxHz },
+        { "analysis_threads", int(settings.analysisThreads) },
+        { "fft_backend", int(settings.fftBackend) },
+        { "spectra_per_second", settings.spectraPerSecond },
+        { "zoom_enabled", settings.zoomEnabled },
+        { "zoom_decimation", int(settings.zoomDecimation) },
+        { "zoom_frames", int(settings.zoomFrames) },
+        { "welch_segments", int(settings.welchSegments) },
+        { "welch_overlap", settings.welchOverlap },
+        { "noise_window_seconds", settings.noiseWindowSeconds },
+        { "iq_input", settings.iqInput },
+        { "peak_count", int(settings.peakCount) },
+        { "peak_min_snr_db", settings.peakMinSnrDb },
+        { "skimmer_enabled", settings.skimmerEnabled },
+        { "skimmer_tracks", int(settings.skimmerTracks) },
+        { "skimmer_snr_db", settings.skimmerSnrDb },
         { "blend_factor", settings.blendFactor },
         { "blend_fft", settings.blendFFT },
         { "filter_fft", settings.filterFFT },
@@ -93,8 +148,24 @@ inline toml::table audioanalysis_save_settings(const AudioAnalysisSettings& sett
 
 inline void audio_analysis_validate_settings(AudioAnalysisSettings& settings)
 {
-    settings.frames = std::clamp(settings.frames, 64u, 4096u);
-    settings.spectrumBuckets = std::clamp(settings.spectrumBuckets, 64u, settings.frames);
+    // Above 4096 is the large FFT mode; the display stays at up to 4096 buckets regardless
+    settings.frames = std::clamp(settings.frames, 64u, 262144u);
+    settings.spectrumBuckets = std::clamp(settings.spectrumBuckets, 64u, std::min(settings.frames, 4096u));
+    settings.spectrumScale = std::clamp(settings.spectrumScale, 0u, 3u);
+    settings.spectrumZoomMinHz = std::clamp(settings.spectrumZoomMinHz, 0.0f, 23990.0f);
+    settings.spectrumZoomMaxHz = std::clamp(settings.spectrumZoomMaxHz, settings.spectrumZoomMinHz + 10.0f, 24000.0f);
+    settings.analysisThreads = std::clamp(settings.analysisThreads, 1u, 8u);
+    settings.fftBackend = std::clamp(settings.fftBackend, 0u, 1u);
+    settings.spectraPerSecond = std::clamp(settings.spectraPerSecond, 1.0f, 1000.0f);
+    settings.zoomDecimation = std::bit_floor(std::clamp(settings.zoomDecimation, 2u, 256u));
+    settings.zoomFrames = std::bit_floor(std::clamp(settings.zoomFrames, 256u, 8192u));
+    settings.welchSegments = std::clamp(settings.welchSegments, 1u, 16u);
+    settings.welchOverlap = std::clamp(settings.welchOverlap, 0.0f, 0.9f);
+    settings.noiseWindowSeconds = std::clamp(settings.noiseWindowSeconds, 0.2f, 10.0f);
+    settings.peakCount = std::clamp(settings.peakCount, 0u, 64u);
+    settings.peakMinSnrDb = std::clamp(settings.peakMinSnrDb, 0.0f, 60.0f);
+    settings.skimmerTracks = std::clamp(settings.skimmerTracks, 1u, 64u); // CwSkimmerMaxTracks
+    settings.skimmerSnrDb = std::clamp(settings.skimmerSnrDb, 3.0f, 40.0f);
     settings.blendFactor = std::clamp(settings.blendFactor, 1.0f, 1000.0f);
     if (settings.compThresholdDb > 0.0f)
     {
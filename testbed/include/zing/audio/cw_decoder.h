@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Zing
+{
+
+// Single producer, single consumer queue of decoded characters, from the audio thread to the UI.
+// Fixed size; when the UI stops reading, new characters are dropped.
+constexpr uint32_t CwTextQueueSize = 1024; // Power of 2
+
+struct CwTextQueue
+{
+    std::array<char, CwTextQueueSize> text{};
+    alignas(64) std::atomic<uint32_t> writeIndex = 0;
+    alignas(64) std::atomic<uint32_t> readIndex = 0;
+};
+
+// Producer; false if the queue is full
+bool cw_text_queue_push(CwTextQueue& queue, char c);
+
+// Consumer; copies out up to maxCount characters and returns how many
+uint32_t cw_text_queue_pop(CwTextQueue& queue, char* pOut, uint32_t maxCount);
+
+// Morse decoder for a keyed tone at a known frequency, cheap enough to run per sample inside the
+// radio block. The tone is mixed to DC and integrated over short ticks, which gives its envelope
+// a few hundred times a second; everything after that runs per tick.
+// The envelope is averaged over about a third of a dot and compared against thresholds between
+// the tracked noise and signal levels, with hysteresis, to give the key state. Mark lengths are
+// sorted into dots and dashes around twice the current dot estimate, and each one nudges the
+// estimate, so the speed follows the sender. Spaces longer than 2 dots end a character and longer
+// than 5 end a word.
+// The envelope can also come from elsewhere, a level per tick; the skimmer feeds it spectrum bins,
+// one tick per analysis hop.
+constexpr float CwTickSeconds = 0.002f;
+constexpr uint32_t CwMaxSmoothTicks = 32;
+
+struct CwDecoder
+{
+    float tickSeconds = CwTickSeconds;
+    float sampleRate = 0.0f; // 0 when fed levels
+    double toneHz = -1.0;
+
+    // NCO; a unit phasor rotated once per sample and renormalized per tick
+    double phasorRe = 1.0;
+    double phasorIm = 0.0;
+    double stepRe = 1.0;
+    double stepIm = 0.0;
+
+    // Integrate and dump
+    uint32_t tickSamples = 0;
+    uint32_t tickFill = 0;
+    double accRe = 0.0;
+    double accIm = 0.0;
+
+    // Per tick levels; the last few for the average
+    std::array<float, CwMaxSmoothTicks> levels{};
+    uint32_t levelIndex = 0;
+    uint32_t warmupTicks = 0;
+    float noiseLevel = 0.0f;
+    float markLevel = 0.0f;
+    float noiseFall = 0.0f; // Per tick smoothing coefficients
+    float noiseRise = 0.0f;
+    float markRate = 0.0f;
+    float markDecay = 0.0f;
+
+    // Keying
+    bool keyDown = false;
+    uint32_t runTicks = 0; // Length of the current mark or space
+    uint32_t minMarkTicks = 1;
+    float dotTicks = 0.0f;
+    uint32_t symbol = 1;   // Morse tree index; 1 is empty, a dot doubles it, a dash doubles and adds 1
+    bool wordEnded = true; // No space due until another character
+
+    // For the UI
+    std::atomic<float> wpm = 0.0f;
+    std::atomic<float> snrDb = 0.0f;
+
+    CwTextQueue text;
+};
+
+// Resets the decoder for a sample rate; the speed estimate starts at initialWpm
+void cw_decoder_init(CwDecoder& decoder, float sampleRate, float initialWpm);
+
+// Resets the decoder to be fed a level every tickSeconds, rather than samples
+void cw_decoder_init_ticks(CwDecoder& decoder, float tickSeconds, float initialWpm);
+
+// One tick's envelope; any scale, as the thresholds are relative to the noise. A noise level on
+// the same scale, when the caller has a better one, replaces the decoder's own estimate.
+void cw_decoder_push_level(CwDecoder& decoder, float level, float noiseLevel = 0.0f);
+
+// Retunes the mixer; the tone the radio has put the signal on
+void cw_decoder_set_tone(CwDecoder& decoder, double toneHz);
+
+// Strided, so it can read a channel of an interleaved buffer in place
+void cw_decoder_process(CwDecoder& decoder, const float* pSamples, uint32_t count, uint32_t stride);
+
+// The character for a Morse tree index, or 0 if there isn't one
+char cw_symbol_char(uint32_t symbol);
+
+// Keys text at wpm as a tone, with Gaussian noise for a signal to noise ratio over the whole band.
+// Elements have 5ms raised cosine edges; for testing the decoder without a recording.
+std::vector<float> cw_synthesize(const std::string& text, float wpm, double toneHz, float sampleRate, float snrDb, uint32_t seed);
+
+// Edit distance between the two, over the length of the reference. Case and repeated spaces are
+// ignored, as is space at either end.
+double cw_character_error_rate(const std::string& decoded, const std::string& reference);
+
+} // namespace Zing
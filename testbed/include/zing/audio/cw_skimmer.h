@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <zing/audio/cw_decoder.h>
+#include <zing/audio/fft.h>
+
+namespace Zing
+{
+
+// Decodes every keyed carrier in the band at once, from the spectra the analysis already makes.
+// Each spectrum, local maxima well clear of the noise floor start a track, unless they fall within
+// a few bins of one already running, which they join. A track's level is the amplitude over its
+// few bins, fed to a decoder of its own as one tick, so a spectrum costs a pass over the peaks and
+// a few operations per track on top of the FFT. The decoders key against the analysis noise floor
+// rather than their own, which a single bin is too noisy to track.
+// Noise now and then throws up a peak strong enough to start a track, but never the same one
+// again, so a track is only kept and published once peaks have kept joining it. Tracks no peak
+// has joined for a while are retired.
+// The keying is only seen once per analysis hop, and smeared over the analysis window; a short
+// window at a high spectrum rate suits it best.
+constexpr uint32_t CwSkimmerMaxTracks = 64;
+constexpr uint32_t CwSkimmerTextSize = 48; // Characters of recent text kept per track
+
+struct CwSkimmerTrack
+{
+    bool active = false;
+    uint32_t bin = 0;
+    uint32_t ageTicks = 0;
+    uint32_t idleTicks = 0; // Since a peak last joined
+    uint32_t peakHits = 0;  // Spectra a peak joined in
+    std::string text;
+    CwDecoder decoder;
+};
+
+struct CwSkimmerSettings
+{
+    float tickSeconds = 0.0f; // The analysis hop
+    double binHz = 0.0;
+    double minHz = 0.0;       // Of bin 0
+    float seedSnrDb = 12.0f;  // A peak has to be this far over the floor to start a track
+    uint32_t maxTracks = 32;
+    float initialWpm = 20.0f;
+};
+
+struct CwSkimmer
+{
+    CwSkimmerSettings settings;
+    uint32_t bins = 0;
+    std::array<CwSkimmerTrack, CwSkimmerMaxTracks> tracks;
+    std::vector<uint32_t> activeList; // Track indices, rebuilt each spectrum
+};
+
+// One published decode
+struct CwSpot
+{
+    double hz = 0.0;
+    float wpm = 0.0f;
+    float snrDb = 0.0f;
+    float seconds = 0.0f; // Since the track started
+    std::string callsign; // Empty until something like one has been sent
+    std::string text;
+};
+
+// pPower and pNoise are the spectrum and its noise floor, in linear power per bin; pCandidates
+// are bins of local maxima to consider for new tracks. The tracks are decoded through
+// parallelFor when there are enough of them to be worth the handoff.
+void cw_skimmer_update(CwSkimmer& skimmer, const CwSkimmerSettings& settings, const float* pPower, const float* pNoise, uint32_t bins, const uint32_t* pCandidates, uint32_t candidateCount, const FftParallelFor& parallelFor);
+
+void cw_skimmer_reset(CwSkimmer& skimmer);
+
+// Tracks with something decoded, lowest frequency first
+void cw_skimmer_spots(const CwSkimmer& skimmer, std::vector<CwSpot>& spots);
+
+// The last word that looks like a callsign: a 1 to 3 character prefix with a letter in it, then
+// a digit and a 1 to 4 letter suffix, as in M0ABC, K1AB or 9A1AA. One after DE is preferred.
+std::string cw_find_callsign(const std::string& text);
+
+} // namespace Zing
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+extern "C" {
+#include <soundpipe/h/soundpipe.h>
+}
+
+#include <kiss_fft.h>
+
+namespace Zing
+{
+
+// Same layout as kiss; keeps .r/.i in the DSP code regardless of backend
+using FftComplex = kiss_fft_cpx;
+
+enum class FftBackend : uint32_t
+{
+    Kiss,
+    SplitRadix,
+    Count
+};
+
+enum class FftKind : uint32_t
+{
+    Complex,
+    Real
+};
+
+enum class FftDirection : uint32_t
+{
+    Forward,
+    Inverse
+};
+
+// A cached transform. Plans are immutable once built, so one plan can be shared by
+// any number of threads; they are owned by the cache and live until fft_destroy_all().
+struct FftPlan
+{
+    FftBackend backend = FftBackend::Kiss;
+    FftKind kind = FftKind::Complex;
+    FftDirection direction = FftDirection::Forward;
+    uint32_t size = 0;
+
+    // Kiss (complex only)
+    kiss_fft_cfg kissCfg = nullptr;
+
+    // Split radix (complex, power of 2 only)
+    // One block of w^k and w^3k twiddles (k < n/4) per level n >= 8, laid out for 2-wide complex SIMD.
+    std::vector<float> twiddles;
+    std::vector<uint32_t> levelOffsets; // Indexed by log2(n)
+
+    // Real transforms are an N/2 complex transform plus a split/merge pass
+    const FftPlan* half = nullptr;
+    std::vector<FftComplex> realTwiddles;
+
+    // Large complex plans (see FftSixStepMinSize) can also run as rows * cols = size. Pass 1 does a
+    // cols point FFT per row and twiddles it, pass 2 a rows point FFT per column. The transposes
+    // are folded into the strided reads and the column gathers.
+    uint32_t rows = 0;
+    uint32_t cols = 0;
+    const FftPlan* rowPlan = nullptr; // cols points
+    const FftPlan* colPlan = nullptr; // rows points
+    std::vector<FftComplex> sixStepTwiddles; // w^(row * k), rows * cols
+};
+
+// Power of 2 complex plans this big can also run as a six step transform. Each pass is a batch of
+// independent small FFTs that fit in cache, and that batch can be shared out between threads.
+// On one thread the direct transform is quicker, so the six step is only used with a parallelFor.
+constexpr uint32_t FftSixStepMinSize = 16384;
+
+// Runs fn over [0, count) in ranges, possibly on several threads; returns when all are done.
+// An empty FftParallelFor runs everything on the calling thread.
+using FftParallelRange = std::function<void(uint32_t begin, uint32_t end)>;
+using FftParallelFor = std::function<void(uint32_t count, const FftParallelRange& fn)>;
+
+struct FftBenchmarkResult
+{
+    FftBackend backend = FftBackend::Kiss;
+    FftKind kind = FftKind::Real;
+    uint32_t size = 0;
+    double nsPerTransform = 0.0;
+    double mflops = 0.0;
+};
+
+void fft_set_backend(FftBackend backend);
+FftBackend fft_get_backend();
+const char* fft_backend_name(FftBackend backend);
+bool fft_backend_supports(FftBackend backend, uint32_t size);
+
+// Process wide plan cache, keyed by backend, size, kind and direction.
+// Uses the active backend, falling back to kiss for sizes the backend can't do.
+const FftPlan* fft_plan(uint32_t size, FftKind kind, FftDirection direction);
+const FftPlan* fft_plan(FftBackend backend, uint32_t size, FftKind kind, FftDirection direction);
+
+// Re-fetch a cached plan pointer if it is missing, the wrong size, or the backend has changed
+void fft_plan_update(const FftPlan*& plan, uint32_t size, FftKind kind, FftDirection direction);
+
+void fft_destroy_all();
+
+// All transforms are unnormalized, matching kiss_fft / kiss_fftr / kiss_fftri.
+// Complex: size in, size out.
+void fft_complex(const FftPlan* plan, const FftComplex* in, FftComplex* out);
+// Real forward: size floats in, size/2 + 1 bins out.
+void fft_real_forward(const FftPlan* plan, const float* in, FftComplex* out);
+// Real inverse: size/2 + 1 bins in, size floats out. Imaginary DC/Nyquist parts are ignored.
+void fft_real_inverse(const FftPlan* plan, const FftComplex* in, float* out);
+// As above, with size/2 of caller owned scratch; the one to use from the audio thread, since the
+// overload above keeps a thread local buffer that grows on first use.
+void fft_real_inverse(const FftPlan* plan, const FftComplex* in, float* out, FftComplex* pScratch);
+
+// As above, with large plans run as a six step split up by parallelFor. Results match the
+// direct transform to float rounding.
+void fft_complex(const FftPlan* plan, const FftComplex* in, FftComplex* out, const FftParallelFor& parallelFor);
+void fft_real_forward(const FftPlan* plan, const float* in, FftComplex* out, const FftParallelFor& parallelFor);
+
+// Times every backend on power of 2 sizes in [minSize, maxSize].
+// Slow; call off the audio and UI threads.
+std::vector<FftBenchmarkResult> fft_benchmark(uint32_t minSize, uint32_t maxSize, FftKind kind, double secondsPerSize = 0.05);
+
+} // namespace Zing
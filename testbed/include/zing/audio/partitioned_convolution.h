@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <zing/audio/fft.h>
+
+namespace Zing
+{
+
+// Uniformly partitioned overlap-save convolution of a real signal with a complex impulse response.
+// The response is cut into blockSize partitions, each transformed once; every block of input is
+// transformed once into a frequency domain delay line, and the output block is the inverse of the
+// sum of each partition times the input spectrum that many blocks ago. The delay is one block,
+// however long the response, and the cost per sample grows with the response length / blockSize.
+struct PartitionedConvolution
+{
+    uint32_t blockSize = 0;     // Power of 2
+    uint32_t partitions = 0;    // In use by the current response
+    uint32_t maxPartitions = 0;
+
+    const FftPlan* planFwd = nullptr; // 2 * blockSize; owned by the FFT plan cache
+    const FftPlan* planInv = nullptr;
+
+    // maxPartitions spectra of 2 * blockSize bins each; the response is pre-scaled for the inverse
+    std::vector<FftComplex> irSpectra;
+    // Delay line of input spectra, in the same layout; head is the newest
+    std::vector<FftComplex> inputSpectra;
+    uint32_t head = 0;
+
+    std::vector<FftComplex> window; // The previous and current input blocks
+    std::vector<FftComplex> accum;
+    std::vector<FftComplex> timeOut;
+};
+
+// Sizes everything for responses up to maxIrLength; later responses within that don't allocate
+void partitioned_convolution_init(PartitionedConvolution& conv, uint32_t blockSize, uint32_t maxIrLength);
+
+// Takes a new response; the input history is kept, so the switch is seamless apart from the
+// change in the filter itself
+void partitioned_convolution_set_ir(PartitionedConvolution& conv, const FftComplex* pIr, uint32_t length);
+
+// Takes the first partitions of another instance's irSpectra, transformed by set_ir with the same
+// block size; the transforms can then run away from the thread that processes. Never allocates.
+void partitioned_convolution_copy_ir(PartitionedConvolution& conv, const FftComplex* pIrSpectra, uint32_t partitions);
+
+void partitioned_convolution_reset(PartitionedConvolution& conv);
+
+// blockSize real samples in, blockSize filtered complex samples out
+void partitioned_convolution_process(PartitionedConvolution& conv, const float* pIn, FftComplex* pOut);
+
+// The minimum phase response for a magnitude, from the folded real cepstrum. A linear phase filter
+// delays by half its length, which would give back the latency the partitioning saves; the
+// minimum phase version has the same magnitude with its energy as early as possible.
+struct MinimumPhase
+{
+    uint32_t size = 0; // Power of 2
+    const FftPlan* planFwd = nullptr;
+    const FftPlan* planInv = nullptr;
+    std::vector<FftComplex> work;
+    std::vector<FftComplex> ir; // size samples; the result
+};
+
+void minimum_phase_init(MinimumPhase& design, uint32_t size);
+
+// pMagnitude has size bins around the whole circle, so a one sided (analytic) response is fine.
+// Zeros are raised to floorGain, as the log needs something to work with.
+void minimum_phase_design(MinimumPhase& design, const float* pMagnitude, float floorGain);
+
+} // namespace Zing
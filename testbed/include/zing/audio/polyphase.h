@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <zing/audio/fft.h>
+
+namespace Zing
+{
+
+// Multirate building blocks, shared by the zoom analysis and the radio's time domain receiver.
+//
+// The half-band filter is a Blackman-Harris windowed sinc with its cutoff at a quarter of the
+// higher rate; 4K + 3 taps, every other one zero apart from the center. Only the K + 1 odd taps
+// either side of the center are stored, so each 2:1 output costs K + 1 multiplies per channel.
+// The outer quarter either side of the lower rate's Nyquist is the transition band; the inner
+// 75% is clean to better than 90dB.
+constexpr uint32_t HalfBandK = 15;
+constexpr uint32_t HalfBandTaps = (4 * HalfBandK) + 3;
+constexpr uint32_t HalfBandCenter = (HalfBandTaps - 1) / 2;
+constexpr double HalfBandUsableFraction = 0.75;
+
+// 4 term Blackman-Harris; ~92dB sidelobes
+double blackman_harris(uint32_t i, uint32_t size);
+
+// Rescales a recursively stepped unit phasor; rounding would otherwise slowly grow or shrink it.
+// Once per block is plenty.
+void normalize_phasor(double& re, double& im);
+void normalize_phasor(float& re, float& im);
+
+// The odd taps, scaled so the DC gain is exactly 1
+using HalfBandCoeffs = std::array<float, HalfBandK + 1>;
+HalfBandCoeffs half_band_design();
+
+// The filters below work a block at a time over a linear history rather than a sample at a time
+// round a ring: with the taps as the outer loop, every output in the block is independent, so the
+// inner loop vectorizes and no sample waits on the previous one's sum. The history is moved down
+// after each block.
+constexpr uint32_t HalfBandBlock = 128; // Outputs per pass
+constexpr uint32_t HalfBandHistory = (2 * HalfBandK) + 1;
+
+// 2:1 complex decimator. Only every other input meets the odd taps; those are kept as separate
+// real and imaginary planes. The inputs in between only ever meet the center tap, so they just
+// go round a short delay.
+struct HalfBandDecimator
+{
+    std::array<float, HalfBandHistory + HalfBandBlock> re{};
+    std::array<float, HalfBandHistory + HalfBandBlock> im{};
+    std::array<FftComplex, HalfBandK + 1> center{}; // Power of 2, so it wraps with a mask
+    uint32_t centerWrite = 0;
+    bool skip = false; // Only every other input produces an output
+};
+
+void half_band_decimator_reset(HalfBandDecimator& stage);
+
+// Decimates pData by 2 in place; returns the number of outputs. The group delay is
+// HalfBandCenter samples at the input rate.
+uint32_t half_band_decimate(const HalfBandCoeffs& taps, HalfBandDecimator& stage, FftComplex* pData, uint32_t count);
+
+// 1:2 real interpolator; the polyphase form of zero stuffing followed by the half-band, so
+// there are no multiplies by the stuffed zeros
+struct HalfBandInterpolator
+{
+    std::array<float, HalfBandHistory + HalfBandBlock> delay{};
+};
+
+void half_band_interpolator_reset(HalfBandInterpolator& stage);
+
+// 2 * count outputs into pOut, which must not overlap pIn. The group delay is HalfBandCenter
+// samples at the output rate.
+void half_band_interpolate(const HalfBandCoeffs& taps, HalfBandInterpolator& stage, const float* pIn, uint32_t count, float* pOut);
+
+// Blackman windowed sinc low pass, ~74dB stopband. Odd length, long enough for the transition
+// band, capped at maxTaps.
+uint32_t fir_low_pass_taps(double transitionHz, double sampleRate, uint32_t maxTaps);
+// count taps with unity DC gain, cutoff at the middle of the transition band
+void fir_design_low_pass(float* pTaps, uint32_t count, double cutoffHz, double sampleRate);
+
+// Real taps on complex samples; block at a time as above, with the history and the block in
+// separate real and imaginary planes
+constexpr uint32_t FirComplexBlock = 128;
+
+struct FirComplex
+{
+    std::vector<float> taps;
+    std::vector<float> re; // tapCount - 1 of history, then the block
+    std::vector<float> im;
+    uint32_t tapCount = 0;
+};
+
+// Sizes for up to maxTaps, so later designs within that don't allocate
+void fir_complex_init(FirComplex& fir, uint32_t maxTaps);
+void fir_complex_reset(FirComplex& fir);
+// Designs count taps with fir_design_low_pass, clearing the history if the length changed
+void fir_complex_design_low_pass(FirComplex& fir, uint32_t count, double cutoffHz, double sampleRate);
+// Filters pData in place
+void fir_complex_process(FirComplex& fir, FftComplex* pData, uint32_t count);
+
+} // namespace Zing
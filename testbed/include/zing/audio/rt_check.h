@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Zing
+{
+
+// Debug check that the audio callback stays real time safe. Built with ZING_RT_CHECK, heap
+// allocations (operator new/delete everywhere, malloc/free where the CRT lets us hook them) and
+// lock attempts made while the audio thread is inside an RT_CHECK_SCOPE are recorded as
+// violations, keyed by the innermost scope name and the calling address. Without the flag the
+// macros compile away and nothing is hooked.
+enum class RtViolationKind
+{
+    Alloc,
+    Free,
+    Lock
+};
+
+struct RtViolation
+{
+    RtViolationKind kind = RtViolationKind::Alloc;
+    const char* pScope = nullptr;  // Innermost RT_CHECK_SCOPE
+    const char* pWhat = nullptr;   // Lock name, or nullptr for the allocator
+    const void* pCaller = nullptr; // Return address into the offending code
+    uint64_t size = 0;             // Bytes for the first allocation seen at this site
+    std::atomic<uint64_t> hits = 0;
+};
+
+// Distinct sites; repeats of the same one only bump its hit count
+constexpr uint32_t RtCheckMaxViolations = 64;
+
+// Installs the CRT hooks where needed; call once before the stream starts
+void rt_check_init();
+
+// Enter/leave a checked region on this thread; returns/takes the previous scope name
+const char* rt_check_enter(const char* pName);
+void rt_check_leave(const char* pPrevious);
+
+// Records a violation if this thread is inside a checked region
+void rt_check_blocking(const char* pWhat);
+
+// UI side; the recorded sites in the order they were first seen
+uint32_t rt_check_violation_count();
+const RtViolation& rt_check_violation(uint32_t index);
+uint64_t rt_check_total_hits();
+
+// Cleared by the audio thread as it next enters a region
+void rt_check_request_clear();
+
+// Assert on the next violation, so it can be caught in the debugger with the offending stack
+void rt_check_set_break(bool enable);
+bool rt_check_get_break();
+
+const char* rt_check_kind_name(RtViolationKind kind);
+
+#ifdef ZING_RT_CHECK
+struct RtCheckScope
+{
+    explicit RtCheckScope(const char* pName)
+        : pPrevious(rt_check_enter(pName))
+    {
+    }
+    ~RtCheckScope()
+    {
+        rt_check_leave(pPrevious);
+    }
+    const char* pPrevious;
+};
+
+#define RT_CHECK_SCOPE(name) Zing::RtCheckScope rtCheckScope_##name(#name)
+#define RT_CHECK_BLOCKING(name) Zing::rt_check_blocking(#name)
+#else
+#define RT_CHECK_SCOPE(name)
+#define RT_CHECK_BLOCKING(name)
+#endif
+
+} // namespace Zing
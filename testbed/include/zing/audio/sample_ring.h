@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace Zing
+{
+
+// Single producer, single consumer ring of fixed size sample blocks, for getting audio out of the
+// audio callback. All memory is allocated up front; the producer fills a block in place and
+// publishes it, and the consumer reads it in place and releases it. Neither side locks or allocates.
+// When the consumer falls too far behind, the producer drops the new block and counts it.
+struct SampleRing
+{
+    uint32_t blockSize = 0;     // Floats per block
+    uint32_t blockCount = 0;    // Power of 2
+    std::vector<float> samples; // blockCount * blockSize
+    std::vector<uint32_t> used; // Floats written to each block
+
+    // Free running; index & (blockCount - 1) is the block. Each is only written by one side.
+    alignas(64) std::atomic<uint64_t> writeIndex = 0;
+    alignas(64) std::atomic<uint64_t> readIndex = 0;
+
+    // Producer side statistics
+    std::atomic<uint64_t> writtenBlocks = 0;
+    std::atomic<uint64_t> droppedBlocks = 0;
+};
+
+// Not thread safe; call before either side starts
+void sample_ring_init(SampleRing& ring, uint32_t blockSize, uint32_t blockCount);
+
+// Producer; the next free block, or nullptr (counted as a drop) if the ring is full.
+// Publish it with the number of floats written.
+float* sample_ring_write_begin(SampleRing& ring);
+void sample_ring_write_end(SampleRing& ring, uint32_t count);
+
+// Consumer; the oldest published block and its size, or nullptr if there are none.
+// The block is not reused until it is released.
+const float* sample_ring_read_begin(SampleRing& ring, uint32_t& count);
+void sample_ring_read_end(SampleRing& ring);
+
+// Published blocks not yet released
+uint32_t sample_ring_pending(const SampleRing& ring);
+
+} // namespace Zing
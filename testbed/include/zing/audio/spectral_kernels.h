@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include <zing/audio/fft.h>
+
+namespace Zing
+{
+
+// Inner loops of the spectrum analysis, with SSE2/AVX2/NEON versions picked once at startup
+// from what the CPU reports. All ISAs use the same math, so they only differ by rounding.
+enum class SpectralIsa : uint32_t
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON,
+    Count
+};
+
+SpectralIsa spectral_detect_isa();
+SpectralIsa spectral_get_isa();
+// Clamps to what the CPU supports; used to A/B the kernels from the settings UI
+void spectral_set_isa(SpectralIsa isa);
+const char* spectral_isa_name(SpectralIsa isa);
+
+// out[i] = in[i] * window[i]
+void spectral_window(const float* in, const float* window, float* out, uint32_t count);
+
+// out[i] = (re * re + im * im) * scale
+void spectral_power(const FftComplex* in, float* out, uint32_t count, float scale);
+
+// out[i] = clamp(10 * log10(max(in[i], 1e-10)) / dbRange + 1, 0, 1)
+// The log is a range-reduced atanh series rather than std::log10; the error against
+// std::log10 is below 1e-4 dB over the clamped range (see spectral_measure_db_error).
+void spectral_power_to_db(const float* in, float* out, uint32_t count, float dbRange);
+
+// sum(a[i] * b[i])
+float spectral_dot(const float* a, const float* b, uint32_t count);
+
+// Scalar form of the approximation used by spectral_power_to_db
+float spectral_fast_db(float power);
+
+struct SpectralDbError
+{
+    float maxDbError = 0.0f;
+    float maxNormalizedError = 0.0f;
+};
+
+// Sweeps powers from 1e-12 to 1e4 and compares against std::log10.
+// maxDbError is the raw approximation; maxNormalizedError is the active kernel's clamped output.
+SpectralDbError spectral_measure_db_error(float dbRange);
+
+} // namespace Zing
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Zing
+{
+
+// How display buckets are spread over the FFT bins. A two sided (I/Q) spectrum runs from
+// -Nyquist to +Nyquist, where Log and Mel have no meaning; it is shown linearly instead.
+enum class SpectrumScale : uint32_t
+{
+    Linear, // 0 -> Nyquist
+    Log,    // 20Hz (or the first bin) -> Nyquist
+    Mel,    // 0 -> Nyquist, even in mel
+    Zoomed, // Linear over [zoomMinHz, zoomMaxHz]
+    Count
+};
+
+struct SpectrumPartitionSettings
+{
+    uint32_t limit = 0; // Number of spectrum samples (frames / 2 + 1, or frames if two sided)
+    uint32_t n = 0;     // Number of buckets
+    bool twoSided = false; // Bin limit / 2 is DC; bin 0 is -Nyquist
+    SpectrumScale scale = SpectrumScale::Linear;
+    float sampleRate = 0.0f;
+    float zoomMinHz = 0.0f;
+    float zoomMaxHz = 0.0f;
+};
+
+inline bool operator==(const SpectrumPartitionSettings& a, const SpectrumPartitionSettings& b)
+{
+    return ((a.limit == b.limit) && (a.n == b.n) && (a.twoSided == b.twoSided) && (a.scale == b.scale) && (a.sampleRate == b.sampleRate) && (a.zoomMinHz == b.zoomMinHz) && (a.zoomMaxHz == b.zoomMaxHz));
+}
+
+// A sparse bins -> buckets weight matrix. Each bucket reads a contiguous run of bins, weighted by
+// how much of each bin's width falls inside the bucket, and normalized to an average.
+struct SpectrumPartition
+{
+    SpectrumPartitionSettings settings;
+    std::vector<uint32_t> firstBin;     // Per bucket
+    std::vector<uint32_t> weightOffset; // Per bucket, plus one past the end
+    std::vector<float> weights;
+};
+
+// Rebuilds the matrix if the settings differ from the last build; returns true if it did
+bool spectrum_partition_build(SpectrumPartition& partition, const SpectrumPartitionSettings& settings);
+void spectrum_partition_apply(const SpectrumPartition& partition, const float* spectrum, float* buckets);
+
+// Display position [0..1] <-> frequency, for axes and markers
+double spectrum_partition_hz_at(const SpectrumPartitionSettings& settings, double x);
+double spectrum_partition_x_at(const SpectrumPartitionSettings& settings, double hz);
+const char* spectrum_scale_name(SpectrumScale scale);
+
+} // namespace Zing
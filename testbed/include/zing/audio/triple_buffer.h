@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Zing
+{
+
+// Latest value publication from one writer thread to one reader thread. The writer always owns a
+// back slot to fill, so it never waits or throws work away; publishing swaps it with the middle
+// slot. The reader swaps the middle slot into the front when it is fresh, so it always sees the
+// newest complete frame in O(1). Frames replaced before the reader got to them are skipped, and
+// counted from the generation stamped on each one.
+constexpr uint32_t TripleBufferFresh = 4; // Set on middle when it holds an unread frame
+constexpr uint32_t TripleBufferIndexMask = 3;
+
+template <typename T>
+struct TripleBuffer
+{
+    T slots[3];
+    uint64_t slotGeneration[3] = { 0, 0, 0 }; // Written by whichever side owns the slot
+
+    // Writer owned
+    uint32_t back = 0;
+
+    // Shared; the last published slot, plus TripleBufferFresh until the reader takes it
+    std::atomic<uint32_t> middle = 1;
+
+    // Frames published so far; readable from anywhere
+    std::atomic<uint64_t> generation = 0;
+
+    // Reader owned
+    uint32_t front = 2;
+    uint64_t readFrames = 0;
+    uint64_t skippedFrames = 0;
+};
+
+// Writer; the slot to fill. It may hold an older frame, so everything in it must be rewritten.
+template <typename T>
+T& triple_buffer_write(TripleBuffer<T>& buffer)
+{
+    return buffer.slots[buffer.back];
+}
+
+// Writer; make the slot from triple_buffer_write the newest frame
+template <typename T>
+void triple_buffer_publish(TripleBuffer<T>& buffer)
+{
+    buffer.slotGeneration[buffer.back] = buffer.generation.load(std::memory_order_relaxed) + 1;
+
+    // Release the frame; acquire the slot the reader last released
+    buffer.back = buffer.middle.exchange(buffer.back | TripleBufferFresh, std::memory_order_acq_rel) & TripleBufferIndexMask;
+    buffer.generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Reader; the newest frame, or nullptr before the first is published. The frame stays valid,
+// and unchanged, until the next call.
+template <typename T>
+const T* triple_buffer_read(TripleBuffer<T>& buffer)
+{
+    if (buffer.middle.load(std::memory_order_relaxed) & TripleBufferFresh)
+    {
+        const auto lastGeneration = buffer.slotGeneration[buffer.front];
+        buffer.front = buffer.middle.exchange(buffer.front, std::memory_order_acq_rel) & TripleBufferIndexMask;
+
+        const auto newGeneration = buffer.slotGeneration[buffer.front];
+        buffer.skippedFrames += newGeneration - lastGeneration - 1;
+        buffer.readFrames++;
+    }
+    return buffer.slotGeneration[buffer.front] != 0 ? &buffer.slots[buffer.front] : nullptr;
+}
+
+} // namespace Zing
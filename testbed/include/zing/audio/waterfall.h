@@ -3,6 +3,8 @@
 
 #include <vector>
 
+#include <zing/audio/spectrum_partition.h>
+
 // Forward-declare to keep this header light.
 // Include <imgui.h> and <implot.h> in Waterfall.cpp and in any TU that calls Draw().
 struct ImVec2;
@@ -17,6 +19,7 @@ struct Waterfall
     int accumulateN = 8; // spectra per committed row
     int accCount = 0;
     std::vector<float> accPowerSum; // sum of POWER per bin (mag^2) across accCount
+    float accNoisePowerSum = 0.0f;  // same, for the analysis noise floor
 
     // ---- Auto noise tracking ----
     float emaNoiseDb = -90.0f; // internal auto estimate (dB)
@@ -56,7 +59,8 @@ void Waterfall_Init(Waterfall& wf, int bins, int rows = 50);
 void Waterfall_Reset(Waterfall& wf);
 
 // Feed one spectrum snapshot (magnitudes). This ACCUMULATES and commits every wf.accumulateN calls.
-void Waterfall_AccumulateMag(Waterfall& wf, const float* spectrumMag, int spectrumCount);
+// noiseMag is the noise floor the analysis estimated for the snapshot, on the same scale.
+void Waterfall_AccumulateMag(Waterfall& wf, const float* spectrumMag, int spectrumCount, float noiseMag);
 
 // Build ordered buffer for drawing (oldest at top, newest at bottom)
 void Waterfall_BuildUpload(Waterfall& wf);
@@ -67,7 +71,8 @@ float Waterfall_CeilDb(const Waterfall& wf);
 
 // UI + draw (ImGui + ImPlot)
 void Waterfall_DrawControls(Waterfall& wf);
-void Waterfall_DrawPlot(Waterfall& wf, const char* plotTitle, float maxHz, ImVec2 plotSize);
+// Bins are drawn evenly; the partition maps them (and the marker) to Hz
+void Waterfall_DrawPlot(Waterfall& wf, const char* plotTitle, const Zing::SpectrumPartitionSettings& partition, ImVec2 plotSize);
 
 // Shared marker access
 Waterfall& Waterfall_Get();
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <zing/audio/fft.h>
+#include <zing/audio/polyphase.h>
+
+namespace Zing
+{
+
+// Narrowband analysis around a center frequency. The input is mixed to baseband with a complex
+// NCO, decimated by a cascade of 2:1 half-band filters, and a small complex FFT is taken at the
+// decimated rate. At 48kHz, a 2048 point zoom decimated by 32 shows ~1.1kHz in 0.73Hz bins, for
+// the cost of the mixer, the filters and a 2k FFT.
+struct ZoomFftSettings
+{
+    float sampleRate = 0.0f;
+    uint32_t decimation = 0; // Power of 2
+    uint32_t frames = 0;     // FFT size at the decimated rate
+    bool complexInput = false; // I/Q input; the center may then be anywhere in +/-sampleRate / 2
+};
+
+inline bool operator==(const ZoomFftSettings& a, const ZoomFftSettings& b)
+{
+    return ((a.sampleRate == b.sampleRate) && (a.decimation == b.decimation) && (a.frames == b.frames) && (a.complexInput == b.complexInput));
+}
+
+// The outer edges of the decimated band sit in the half-band transition and may carry aliases;
+// this much of the span around the center is clean to better than 90dB.
+constexpr double ZoomFftUsableFraction = HalfBandUsableFraction;
+
+struct ZoomFft
+{
+    ZoomFftSettings settings;
+    double centerHz = 0.0;
+
+    // NCO; a unit phasor rotated once per sample and renormalized per block
+    double phasorRe = 1.0;
+    double phasorIm = 0.0;
+    double stepRe = 1.0;
+    double stepIm = 0.0;
+
+    // Shared half-band kernel; only the non-zero odd taps either side of the center
+    HalfBandCoeffs taps{};
+    std::vector<HalfBandDecimator> stages;
+    std::vector<FftComplex> scratch;
+
+    // Decimated history; historyWrite is the oldest sample
+    std::vector<FftComplex> history;
+    uint32_t historyWrite = 0;
+
+    const FftPlan* fftPlan = nullptr; // Owned by the FFT plan cache
+    std::vector<float> window;
+    float totalWin = 0.0f;
+    std::vector<FftComplex> fftIn;
+    std::vector<FftComplex> fftOut;
+    std::vector<float> fftMag;
+};
+
+// Rebuilds filters, history and plan if the settings changed; returns true if it did
+bool zoom_fft_configure(ZoomFft& zoom, const ZoomFftSettings& settings);
+
+// Retunes the NCO. The history was mixed at the old center, so it is cleared on a move.
+void zoom_fft_set_center(ZoomFft& zoom, double centerHz);
+
+// Mix and decimate a block of input into the history
+void zoom_fft_process(ZoomFft& zoom, const float* pSamples, uint32_t count);
+void zoom_fft_process_complex(ZoomFft& zoom, const FftComplex* pSamples, uint32_t count);
+
+// Power spectrum of the history; frames bins running up from centerHz - span / 2, with the same
+// scaling as the full band spectrum, so a tone reads the same level in both.
+void zoom_fft_power(ZoomFft& zoom, float* pPower);
+
+// The decimated sample rate, which is also the full span of the zoom spectrum
+double zoom_fft_span_hz(const ZoomFftSettings& settings);
+double zoom_fft_bin_hz(const ZoomFftSettings& settings);
+
+} // namespace Zing
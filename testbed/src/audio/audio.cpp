@@ -1,6 +1,8 @@
 #include <zing/pch.h>
 
+#include <bit>
 #include <format>
+#include <future>
 
 #include <zest/settings/settings.h>
 
@@ -9,8 +11,12 @@
 #include <zing/audio/audio_analysis_settings.h>
 #include <zing/audio/audio_device_settings.h>
 #include <zing/audio/audio_samples.h>
+#include <zing/audio/fft.h>
+#include <zing/audio/rt_check.h>
+#include <zing/audio/spectral_kernels.h>
 #include <zing/audio/midi.h>
 #include <zing/audio/waterfall.h>
+#include <zing/audio/zoom_fft.h>
 
 //#define LIBREMIDI_HEADER_ONLY
 #include <libremidi/libremidi.hpp>
@@ -35,6 +41,10 @@ namespace
 
 std::vector<uint32_t> frameSizes{128, 256, 512, 1024, 2048, 4096};
 std::vector<std::string> frameNames{"128", "256", "512", "1024", "2048", "4096"};
+
+// Above 4096 is the large FFT mode, shared between the analysis workers
+std::vector<uint32_t> analysisFrameSizes{128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072, 262144};
+std::vector<std::string> analysisFrameNames{"128", "256", "512", "1024", "2048", "4096", "8k", "16k", "32k", "64k", "128k", "256k"};
 std::vector<double> sampleRates = {
     8000.0,
     9600.0,
@@ -53,6 +63,17 @@ std::vector<double> sampleRates = {
 uint32_t defaultFrameIndex = 1;
 AudioContext audioContext;
 
+struct FftBenchmarkState
+{
+    std::future<std::vector<FftBenchmarkResult>> pending;
+    std::vector<FftBenchmarkResult> results;
+    std::future<std::vector<AudioAnalysisScalingResult>> scalingPending;
+    std::vector<AudioAnalysisScalingResult> scalingResults;
+    SpectralDbError dbError;
+    bool dbErrorValid = false;
+};
+FftBenchmarkState fftBenchmark;
+
 struct OutputCompressorState
 {
     std::vector<sp_compressor*> comps;
@@ -161,23 +182,6 @@ AudioContext& GetAudioContext()
     return audioContext;
 }
 
-std::shared_ptr<AudioBundle> audio_get_bundle()
-{
-    std::shared_ptr<AudioBundle> bundle;
-    if (audioContext.spareBundles.try_dequeue(bundle))
-    {
-        return bundle;
-    }
-
-    return std::make_shared<AudioBundle>();
-}
-
-void audio_retire_bundle(std::shared_ptr<AudioBundle>& pBundle)
-{
-    //std::fill(pBundle->data.begin(), pBundle->data.end(), 0.0f);
-    audioContext.spareBundles.enqueue(pBundle);
-}
-
 void audio_start_playing()
 {
 }
@@ -280,6 +284,7 @@ int audio_tick(const void* inputBuffer, void* outputBuffer, unsigned long nBuffe
     PROFILE_NAME_THREAD(Audio);
 
     PROFILE_SCOPE(Tick);
+    RT_CHECK_SCOPE(Tick);
 
     auto fracSec = (nBufferFrames / (double)ctx.outputState.sampleRate);
     static const uint64_t oneSecondNs = uint64_t(duration_cast<nanoseconds>(seconds(1)).count());
@@ -314,25 +319,51 @@ int audio_tick(const void* inputBuffer, void* outputBuffer, unsigned long nBuffe
 
         auto sendAnalysis = [&](auto& state, const float* pBuffer, uint32_t frames, const ChannelId& Id) {
             PROFILE_SCOPE(SendAnalysis);
+            RT_CHECK_SCOPE(SendAnalysis);
             auto itrAnalysis = ctx.analysisChannels.find(Id);
             if (itrAnalysis != ctx.analysisChannels.end())
             {
-                // Copy the audio data into a processing bundle and add it to the queue
-                auto pBundle = audio_get_bundle();
-                pBundle->data.resize(nBufferFrames);
-                pBundle->channel = Id;
+                auto& analysis = *itrAnalysis->second;
 
-                // Copy with stride
-                auto stride = state.channelCount;
+                // Deinterleave straight into the channel's ring, a block at a time; an I/Q pair
+                // keeps this channel and the next one interleaved
+                const auto stride = state.channelCount;
+                const uint32_t pairStride = analysis.iq ? 2 : 1;
+                const auto blockFrames = analysis.ring.blockSize / pairStride;
                 auto pSource = pBuffer + Id.second;
-                for (uint32_t count = 0; count < frames; count++)
+                for (uint32_t done = 0; done < frames;)
                 {
-                    pBundle->data[count] = *pSource;
-                    pSource += stride;
-                }
+                    // Full; the analysis is too far behind, and the ring has counted the drop
+                    float* pBlock = sample_ring_write_begin(analysis.ring);
+                    if (!pBlock)
+                    {
+                        break;
+                    }
+
+                    const auto count = std::min(frames - done, blockFrames);
+                    if (analysis.iq)
+                    {
+                        for (uint32_t frame = 0; frame < count; frame++)
+                        {
+                            pBlock[frame * 2] = pSource[0];
+                            pBlock[(frame * 2) + 1] = (stride > 1) ? pSource[1] : 0.0f;
+                            pSource += stride;
+                        }
+                    }
+                    else
+                    {
+                        for (uint32_t frame = 0; frame < count; frame++)
+                        {
+                            pBlock[frame] = *pSource;
+                            pSource += stride;
+                        }
+                    }
+                    sample_ring_write_end(analysis.ring, count * pairStride);
 
-                // Forward the bundle to the processor
-                itrAnalysis->second->processBundles.enqueue(pBundle);
+                    // Forward the block to the processor
+                    audio_analysis_post(analysis, count);
+                    done += count;
+                }
             }
         };
 
@@ -667,6 +698,9 @@ void audio_destroy()
     }
     destroy_output_compressor();
 
+    // Stream is closed, so nobody is holding a plan
+    fft_destroy_all();
+
     ctx.audioTickEnableMutex.unlock();
 }
 
@@ -737,6 +771,7 @@ bool audio_init(const AudioCB& fnCallback)
         }
 
         audio_enumerate_devices();
+        rt_check_init();
 
         ctx.m_initialized = true;
     }
@@ -932,7 +967,11 @@ void audio_show_settings_gui()
         }
         return frameIndex;
     };
-    auto frameIndex = getFrameIndex(analysisSettings.frames);
+    auto analysisFrameIndex = int(std::distance(analysisFrameSizes.begin(), std::find(analysisFrameSizes.begin(), analysisFrameSizes.end(), analysisSettings.frames)));
+    if (analysisFrameIndex >= int(analysisFrameSizes.size()))
+    {
+        analysisFrameIndex = int(defaultFrameIndex);
+    }
 
     if (ImGui::CollapsingHeader("Device Settings", ImGuiTreeNodeFlags_None))
     {
@@ -1007,12 +1046,111 @@ void audio_show_settings_gui()
             }
 
             int index = 0;
-            if (Combo("Analysis Frames", &frameIndex, frameNames))
+            if (Combo("Analysis Frames", &analysisFrameIndex, analysisFrameNames))
+            {
+                analysisSettings.frames = analysisFrameSizes[analysisFrameIndex];
+                audioResetRequired = true;
+            }
+
+            bool iqInput = analysisSettings.iqInput;
+            if (ImGui::Checkbox("I/Q Input", &iqInput))
+            {
+                // Input channels 0/1 become one complex analysis
+                analysisSettings.iqInput = iqInput;
+                audioResetRequired = true;
+            }
+
+            int analysisThreads = int(analysisSettings.analysisThreads);
+            if (ImGui::SliderInt("Analysis Threads", &analysisThreads, 1, 8))
             {
-                analysisSettings.frames = frameSizes[frameIndex];
+                analysisSettings.analysisThreads = uint32_t(analysisThreads);
                 audioResetRequired = true;
             }
 
+            // Blocks the audio thread threw away because the analysis was too far behind, and
+            // spectra the UI never saw because a newer one replaced them first
+            for (auto& [id, pAnalysis] : ctx.analysisChannels)
+            {
+                const auto dropped = pAnalysis->ring.droppedBlocks.load(std::memory_order_relaxed);
+                const auto written = pAnalysis->ring.writtenBlocks.load(std::memory_order_relaxed);
+                const auto& results = pAnalysis->results;
+                ImGui::Text("%s: %llu blocks, %llu dropped; %llu spectra, %llu shown, %llu skipped", audio_to_channel_name(id).c_str(),
+                    (unsigned long long)written,
+                    (unsigned long long)dropped,
+                    (unsigned long long)results.generation.load(std::memory_order_relaxed),
+                    (unsigned long long)results.readFrames,
+                    (unsigned long long)results.skippedFrames);
+            }
+
+            float spectraPerSecond = analysisSettings.spectraPerSecond;
+            if (ImGui::SliderFloat("Spectra / Second", &spectraPerSecond, 1.0f, 1000.0f, "%.0f", ImGuiSliderFlags_Logarithmic))
+            {
+                // Hop is re-read on every block; no need to reset the device
+                analysisSettings.spectraPerSecond = spectraPerSecond;
+            }
+
+            // Both change how much history is kept
+            int welchSegments = int(analysisSettings.welchSegments);
+            if (ImGui::SliderInt("Welch Segments", &welchSegments, 1, 16))
+            {
+                analysisSettings.welchSegments = uint32_t(welchSegments);
+                audioResetRequired = true;
+            }
+
+            float welchOverlap = analysisSettings.welchOverlap;
+            if (ImGui::SliderFloat("Welch Overlap", &welchOverlap, 0.0f, 0.9f, "%.2f"))
+            {
+                analysisSettings.welchOverlap = welchOverlap;
+                audioResetRequired = true;
+            }
+
+            float noiseWindow = analysisSettings.noiseWindowSeconds;
+            if (ImGui::SliderFloat("Noise Window (s)", &noiseWindow, 0.2f, 10.0f, "%.1f"))
+            {
+                // No need to reset the device
+                analysisSettings.noiseWindowSeconds = noiseWindow;
+            }
+
+            int peakCount = int(analysisSettings.peakCount);
+            if (ImGui::SliderInt("Peaks", &peakCount, 0, 64))
+            {
+                // No need to reset the device
+                analysisSettings.peakCount = uint32_t(peakCount);
+            }
+
+            float peakMinSnr = analysisSettings.peakMinSnrDb;
+            if (ImGui::SliderFloat("Peak SNR (dB)", &peakMinSnr, 0.0f, 60.0f, "%.1f"))
+            {
+                // No need to reset the device
+                analysisSettings.peakMinSnrDb = peakMinSnr;
+            }
+
+            // Keying is sampled once per hop and smeared over the window, so fast Morse needs
+            // a high spectrum rate and fewer frames; no need to reset the device
+            bool skimmer = analysisSettings.skimmerEnabled;
+            if (ImGui::Checkbox("CW Skimmer", &skimmer))
+            {
+                analysisSettings.skimmerEnabled = skimmer;
+            }
+            if (analysisSettings.skimmerEnabled)
+            {
+                const float rate = float(std::max(1u, ctx.audioDeviceSettings.sampleRate));
+                ImGui::SameLine();
+                ImGui::Text("Window: %.0f ms  Hop: %.1f ms", 1000.0f * float(analysisSettings.frames) / rate, 1000.0f / std::max(analysisSettings.spectraPerSecond, 1.0f));
+
+                int skimmerTracks = int(analysisSettings.skimmerTracks);
+                if (ImGui::SliderInt("Skimmer Tracks", &skimmerTracks, 1, int(CwSkimmerMaxTracks)))
+                {
+                    analysisSettings.skimmerTracks = uint32_t(skimmerTracks);
+                }
+
+                float skimmerSnr = analysisSettings.skimmerSnrDb;
+                if (ImGui::SliderFloat("Skimmer SNR (dB)", &skimmerSnr, 3.0f, 40.0f, "%.1f"))
+                {
+                    analysisSettings.skimmerSnrDb = skimmerSnr;
+                }
+            }
+
             auto spectrumBucketsIndex = getFrameIndex(analysisSettings.spectrumBuckets);
             if (Combo("Spectrum Buckets", &spectrumBucketsIndex, frameNames))
             {
@@ -1020,6 +1158,29 @@ void audio_show_settings_gui()
                 audioResetRequired = true;
             }
 
+            // The bucket matrix is rebuilt on the next spectrum; no need to reset the device
+            std::vector<std::string> scaleNames;
+            for (uint32_t scale = 0; scale < uint32_t(SpectrumScale::Count); scale++)
+            {
+                scaleNames.push_back(spectrum_scale_name(SpectrumScale(scale)));
+            }
+            int scaleIndex = int(analysisSettings.spectrumScale);
+            if (Combo("Spectrum Scale", &scaleIndex, scaleNames))
+            {
+                analysisSettings.spectrumScale = uint32_t(scaleIndex);
+            }
+
+            if (SpectrumScale(analysisSettings.spectrumScale) == SpectrumScale::Zoomed)
+            {
+                float zoomMin = analysisSettings.spectrumZoomMinHz;
+                float zoomMax = analysisSettings.spectrumZoomMaxHz;
+                if (ImGui::DragFloatRange2("Zoom (Hz)", &zoomMin, &zoomMax, 5.0f, 0.0f, float(ctx.audioDeviceSettings.sampleRate) * 0.5f, "%.0f"))
+                {
+                    analysisSettings.spectrumZoomMinHz = zoomMin;
+                    analysisSettings.spectrumZoomMaxHz = zoomMax;
+                }
+            }
+
             // Note; negative DB
             float dB = -analysisSettings.audioDecibelRange;
             if (ImGui::SliderFloat("Decibel (DbFS)", &dB, -120.0f, -1.0f))
@@ -1120,6 +1281,221 @@ void audio_show_settings_gui()
         {
             Waterfall_DrawControls(Waterfall_Get());
         }
+
+        if (ImGui::CollapsingHeader("FFT", ImGuiTreeNodeFlags_None))
+        {
+            std::vector<std::string> backendNames;
+            for (uint32_t backend = 0; backend < uint32_t(FftBackend::Count); backend++)
+            {
+                backendNames.push_back(fft_backend_name(FftBackend(backend)));
+            }
+
+            int backendIndex = int(analysisSettings.fftBackend);
+            if (Combo("Backend##fft_backend", &backendIndex, backendNames))
+            {
+                // Plans are re-fetched on the next transform; no need to reset the device
+                analysisSettings.fftBackend = uint32_t(backendIndex);
+                fft_set_backend(FftBackend(backendIndex));
+            }
+
+            // Anything up to what the CPU reports; not saved, since it is picked at startup
+            std::vector<std::string> isaNames;
+            for (uint32_t isa = 0; isa <= uint32_t(spectral_detect_isa()); isa++)
+            {
+                isaNames.push_back(spectral_isa_name(SpectralIsa(isa)));
+            }
+            int isaIndex = int(spectral_get_isa());
+            if (Combo("Kernels##spectral_isa", &isaIndex, isaNames))
+            {
+                spectral_set_isa(SpectralIsa(isaIndex));
+            }
+
+            if (ImGui::Button("Check dB Error##spectral_error"))
+            {
+                fftBenchmark.dbError = spectral_measure_db_error(analysisSettings.audioDecibelRange);
+                fftBenchmark.dbErrorValid = true;
+            }
+            if (fftBenchmark.dbErrorValid)
+            {
+                ImGui::SameLine();
+                ImGui::Text("Max %.2e dB, %.2e normalized", fftBenchmark.dbError.maxDbError, fftBenchmark.dbError.maxNormalizedError);
+            }
+
+            if (fftBenchmark.pending.valid())
+            {
+                if (fftBenchmark.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                {
+                    fftBenchmark.results = fftBenchmark.pending.get();
+                }
+                else
+                {
+                    ImGui::TextUnformatted("Benchmarking...");
+                }
+            }
+            else if (ImGui::Button("Run Benchmark##fft_benchmark"))
+            {
+                fftBenchmark.pending = std::async(std::launch::async, []() {
+                    return fft_benchmark(256, 262144, FftKind::Real);
+                });
+            }
+
+            if (!fftBenchmark.results.empty() && ImGui::BeginTable("FftBenchmark", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchSame))
+            {
+                ImGui::TableSetupColumn("Size");
+                ImGui::TableSetupColumn("Backend");
+                ImGui::TableSetupColumn("us");
+                ImGui::TableSetupColumn("MFLOPS");
+                ImGui::TableHeadersRow();
+                for (auto& result : fftBenchmark.results)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("%u", result.size);
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::TextUnformatted(fft_backend_name(result.backend));
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%.2f", result.nsPerTransform / 1000.0);
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%.0f", result.mflops);
+                }
+                ImGui::EndTable();
+            }
+
+            // How the large FFT scales when shared between worker threads
+            const uint32_t scalingSize = std::max(analysisSettings.frames, 65536u);
+            if (fftBenchmark.scalingPending.valid())
+            {
+                if (fftBenchmark.scalingPending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                {
+                    fftBenchmark.scalingResults = fftBenchmark.scalingPending.get();
+                }
+                else
+                {
+                    ImGui::TextUnformatted("Benchmarking...");
+                }
+            }
+            else if (ImGui::Button(std::format("Run Scaling Benchmark ({} points)##fft_scaling", scalingSize).c_str()))
+            {
+                const uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+                fftBenchmark.scalingPending = std::async(std::launch::async, [scalingSize, maxThreads]() {
+                    return audio_analysis_benchmark_scaling(scalingSize, std::min(maxThreads, 16u));
+                });
+            }
+
+            if (!fftBenchmark.scalingResults.empty() && ImGui::BeginTable("FftScaling", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchSame))
+            {
+                ImGui::TableSetupColumn("Threads");
+                ImGui::TableSetupColumn("us");
+                ImGui::TableSetupColumn("vs Direct");
+                ImGui::TableHeadersRow();
+                for (auto& result : fftBenchmark.scalingResults)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("%u", result.threads);
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text("%.1f", result.nsPerTransform / 1000.0);
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%.2fx", result.speedup);
+                }
+                ImGui::EndTable();
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Zoom##Analysis", ImGuiTreeNodeFlags_None))
+        {
+            // Filters and plans are rebuilt by the workers on the next block; no need to reset the device
+            ImGui::Checkbox("Zoom Around Marker", &analysisSettings.zoomEnabled);
+
+            std::vector<std::string> decimationNames;
+            std::vector<std::string> zoomFrameNames;
+            for (uint32_t decimation = 2; decimation <= 256; decimation *= 2)
+            {
+                decimationNames.push_back(std::to_string(decimation));
+            }
+            for (uint32_t frames = 256; frames <= 8192; frames *= 2)
+            {
+                zoomFrameNames.push_back(std::to_string(frames));
+            }
+
+            int decimationIndex = std::countr_zero(analysisSettings.zoomDecimation) - 1;
+            if (Combo("Decimation##zoom", &decimationIndex, decimationNames))
+            {
+                analysisSettings.zoomDecimation = 2u << decimationIndex;
+            }
+
+            int zoomFrameIndex = std::countr_zero(analysisSettings.zoomFrames) - 8;
+            if (Combo("Frames##zoom", &zoomFrameIndex, zoomFrameNames))
+            {
+                analysisSettings.zoomFrames = 256u << zoomFrameIndex;
+            }
+
+            const ZoomFftSettings zoomSettings{ float(ctx.audioDeviceSettings.sampleRate), analysisSettings.zoomDecimation, analysisSettings.zoomFrames };
+            ImGui::Text("Span %.0f Hz, %.2f Hz bins, %.2f s window",
+                zoom_fft_span_hz(zoomSettings) * ZoomFftUsableFraction,
+                zoom_fft_bin_hz(zoomSettings),
+                1.0 / zoom_fft_bin_hz(zoomSettings));
+        }
+
+#ifdef ZING_RT_CHECK
+        if (ImGui::CollapsingHeader("Real Time Check##Audio", ImGuiTreeNodeFlags_None))
+        {
+            // Allocations and locks seen inside the audio callback, one row per calling site;
+            // resolve the caller address against the binary for the stack
+            bool breakOnViolation = rt_check_get_break();
+            if (ImGui::Checkbox("Assert On Violation", &breakOnViolation))
+            {
+                rt_check_set_break(breakOnViolation);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear##rt_check"))
+            {
+                rt_check_request_clear();
+            }
+
+            const auto count = rt_check_violation_count();
+            if (count == 0)
+            {
+                ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "No violations");
+            }
+            else
+            {
+                ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%u sites, %llu violations", count, (unsigned long long)rt_check_total_hits());
+                if (ImGui::BeginTable("RtViolations", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchSame))
+                {
+                    ImGui::TableSetupColumn("Kind");
+                    ImGui::TableSetupColumn("Scope");
+                    ImGui::TableSetupColumn("Detail");
+                    ImGui::TableSetupColumn("Caller");
+                    ImGui::TableSetupColumn("Hits");
+                    ImGui::TableHeadersRow();
+                    for (uint32_t i = 0; i < count; i++)
+                    {
+                        const auto& violation = rt_check_violation(i);
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0);
+                        ImGui::TextUnformatted(rt_check_kind_name(violation.kind));
+                        ImGui::TableSetColumnIndex(1);
+                        ImGui::TextUnformatted(violation.pScope ? violation.pScope : "");
+                        ImGui::TableSetColumnIndex(2);
+                        if (violation.pWhat)
+                        {
+                            ImGui::TextUnformatted(violation.pWhat);
+                        }
+                        else if (violation.kind == RtViolationKind::Alloc)
+                        {
+                            ImGui::Text("%llu bytes", (unsigned long long)violation.size);
+                        }
+                        ImGui::TableSetColumnIndex(3);
+                        ImGui::Text("%p", violation.pCaller);
+                        ImGui::TableSetColumnIndex(4);
+                        ImGui::Text("%llu", (unsigned long long)violation.hits.load(std::memory_order_relaxed));
+                    }
+                    ImGui::EndTable();
+                }
+            }
+        }
+#endif
     }
 
     if (ImGui::Button("Reset"))
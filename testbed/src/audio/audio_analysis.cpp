@@ -7,6 +7,7 @@
 
 #include <zing/audio/audio_analysis.h>
 #include <zing/audio/audio_analysis_settings.h>
+#include <zing/audio/spectral_kernels.h>
 
 #include <zest/logger/logger.h>
 #include <zest/time/profiler.h>
@@ -16,13 +17,48 @@
 namespace Zing
 {
 
-void audio_analysis_gen_linear_space(AudioAnalysis& analysis, uint32_t limit, uint32_t n);
 void audio_analysis_calculate_spectrum(AudioAnalysis& analysis, AudioAnalysisData& analysisData);
 void audio_analysis_calculate_spectrum_bands(AudioAnalysis& analysis, AudioAnalysisData& analysisData);
 void audio_analysis_calculate_audio(AudioAnalysis& analysis, AudioAnalysisData& analysisData);
+void audio_analysis_calculate_zoom(AudioAnalysis& analysis, AudioAnalysisData& analysisData);
+void audio_analysis_calculate_noise_floor(AudioAnalysis& analysis, AudioAnalysisData& analysisData);
+void audio_analysis_calculate_peaks(AudioAnalysis& analysis, AudioAnalysisData& analysisData);
+void audio_analysis_calculate_skimmer(AudioAnalysis& analysis, AudioAnalysisData& analysisData);
 
 namespace
 {
+
+constexpr uint32_t AudioSnapshotMaxFrames = 4096;
+
+// How far the analysis may fall behind the audio thread before blocks are dropped
+constexpr double AudioRingSeconds = 1.0;
+
+// Minimum statistics: the window is tracked as this many sub-window minima, so the floor can
+// rise again one sub-window after the noise does. The periodogram is smoothed first.
+constexpr uint32_t NoiseSubWindows = 8;
+constexpr float NoiseSmoothingSeconds = 0.1f;
+
+// The minimum of a noisy bin sits below its mean, by less as more Welch segments steady it.
+// Fitted on white noise with the default frames, hop and window; within 0.1dB over 1..16 segments.
+constexpr float NoiseBiasOneSegment = 2.55f;
+constexpr float NoiseBiasPerOctave = 0.29f;
+
+// A carrier held for longer than the noise window becomes its own floor; the lowest floor this
+// many bins either side is clear of the main lobe of any peak, so a steady one still stands out.
+constexpr uint32_t PeakFloorBins = 8;
+
+// Samples between the starts of successive Welch segments
+uint32_t audio_analysis_welch_step(const AudioAnalysisSettings& settings)
+{
+    return std::max(1u, uint32_t(float(settings.frames) * (1.0f - settings.welchOverlap)));
+}
+
+// Floats per frame in ring blocks and the history; I/Q pairs are interleaved
+uint32_t audio_analysis_stride(const AudioAnalysis& analysis)
+{
+    return analysis.iq ? 2 : 1;
+}
+
 /// Creates a Hamming Window for FFT
 ///
 /// FFT requires a window function to get smooth results
@@ -50,13 +86,22 @@ void audio_analysis_create_all()
 {
     auto& ctx = Zing::GetAudioContext();
 
-    // Initialize the analysis
+    fft_set_backend(FftBackend(ctx.audioAnalysisSettings.fftBackend));
+
+    // Initialize the analysis; an I/Q pair is one analysis on the first channel, which is sent both
+    const bool iq = ctx.audioAnalysisSettings.iqInput && ctx.inputState.channelCount >= 2;
     for (uint32_t channel = 0; channel < ctx.inputState.channelCount; channel++)
     {
+        if (iq && channel == 1)
+        {
+            continue;
+        }
+
         auto pAnalysis = std::make_shared<AudioAnalysis>();
         auto id = audio_to_channel_id(Channel_In, channel);
         ctx.analysisChannels[id] = pAnalysis;
         pAnalysis->thisChannel = id;
+        pAnalysis->iq = iq && channel == 0;
         audio_analysis_start(*pAnalysis, ctx.inputState);
     }
 
@@ -68,129 +113,475 @@ void audio_analysis_create_all()
         pAnalysis->thisChannel = id;
         audio_analysis_start(*pAnalysis, ctx.inputState);
     }
+
+    std::vector<std::shared_ptr<AudioAnalysis>> channels;
+    for (auto& [id, pAnalysis] : ctx.analysisChannels)
+    {
+        channels.push_back(pAnalysis);
+    }
+    audio_analysis_scheduler_start(ctx.analysisScheduler, ctx.audioAnalysisSettings.analysisThreads, channels);
 }
 
 void audio_analysis_destroy_all()
 {
     auto& ctx = Zing::GetAudioContext();
 
-    for (auto& [name, analysis] : ctx.analysisChannels)
+    // Workers must be gone before the channels they reference
+    audio_analysis_scheduler_stop(ctx.analysisScheduler);
+
+    ctx.analysisChannels.clear();
+}
+
+bool audio_analysis_start(AudioAnalysis& analysis, const AudioChannelState& state)
+{
+    analysis.channel = state;
+
+    auto& ctx = GetAudioContext();
+    const auto frames = ctx.audioAnalysisSettings.frames;
+    analysis.outputSamples = analysis.iq ? frames : (frames / 2) + 1;
+
+    // Hamming window
+    analysis.window = audio_analysis_create_window(frames);
+    analysis.totalWin = 0.0f;
+    float totalWinSquared = 0.0f;
+    for (auto& win : analysis.window)
+    {
+        analysis.totalWin += win;
+        totalWinSquared += win * win;
+    }
+    analysis.windowEnbw = float(frames) * totalWinSquared / std::max(analysis.totalWin * analysis.totalWin, 1e-6f);
+
+    if (analysis.iq)
     {
-        audio_analysis_stop(*analysis);
-        if (analysis->cfg)
+        analysis.fftInComplex.resize(frames, FftComplex{ 0.0f, 0.0f });
+    }
+    else
+    {
+        analysis.fftIn.resize(frames, 0.0f);
+    }
+    analysis.fftOut.resize(analysis.outputSamples);
+    analysis.fftMag.resize(analysis.outputSamples);
+    analysis.welchMag.resize(analysis.outputSamples);
+
+    // Enough history for every Welch segment
+    const auto welchSegments = ctx.audioAnalysisSettings.welchSegments;
+    const auto historyFrames = frames + ((welchSegments - 1) * audio_analysis_welch_step(ctx.audioAnalysisSettings));
+    analysis.history.assign(historyFrames * audio_analysis_stride(analysis), 0.0f);
+    analysis.historyWrite = 0;
+
+    fft_plan_update(analysis.fftPlan, frames, analysis.iq ? FftKind::Complex : FftKind::Real, FftDirection::Forward);
+
+    // A block per device buffer; a larger buffer is split over several
+    const auto blockFrames = std::max(64u, ctx.audioDeviceSettings.frames);
+    const auto blockCount = uint32_t(std::ceil(AudioRingSeconds * double(state.sampleRate) / double(blockFrames)));
+    sample_ring_init(analysis.ring, blockFrames * audio_analysis_stride(analysis), blockCount);
+
+    return true;
+}
+
+namespace
+{
+
+void audio_analysis_process_block(AudioAnalysis& analysis, const float* pSamples, uint32_t count)
+{
+    if (!analysis.inputDumpPath.empty())
+    {
+        if (analysis.thisChannel.first == Channel_In && analysis.inputCache.size() < analysis.maxInputSize)
+        {
+            analysis.inputCache.insert(analysis.inputCache.end(), pSamples, pSamples + count);
+        }
+
+        // Finished
+        if (analysis.inputCache.size() >= analysis.maxInputSize)
         {
-            kiss_fftr_free(analysis->cfg);
-            analysis->cfg = nullptr;
+            // Dump to file
+            fs::create_directories(analysis.inputDumpPath.parent_path());
+            std::ofstream outFile(analysis.inputDumpPath, std::ios::binary);
+            outFile.write((const char*)analysis.inputCache.data(), analysis.inputCache.size() * sizeof(float));
+            outFile.close();
+            //ZEST_LOG_INFO("Audio analysis dumped input to {}", analysis.inputDumpPath.string());
+            analysis.inputCache.clear();
+            analysis.inputDumpPath.clear();
         }
     }
-    ctx.analysisChannels.clear();
+
+    audio_analysis_update(analysis, pSamples, count);
 }
 
-bool audio_analysis_start(AudioAnalysis& analysis, const AudioChannelState& state)
+// Claim the first channel with pending blocks and drain it.
+// Starting point rotates so that no channel is starved; a channel is only ever owned by one worker,
+// which keeps its blocks in order (and is the ring's single consumer).
+bool audio_analysis_run_pending(AudioAnalysisScheduler& scheduler)
 {
-    // Stop the thread
-    audio_analysis_stop(analysis);
+    const auto channelCount = uint32_t(scheduler.channels.size());
+    if (channelCount == 0)
+    {
+        return false;
+    }
+
+    const auto first = scheduler.nextChannel.fetch_add(1);
+    for (uint32_t offset = 0; offset < channelCount; offset++)
+    {
+        auto& analysis = *scheduler.channels[(first + offset) % channelCount];
+        if (sample_ring_pending(analysis.ring) == 0)
+        {
+            continue;
+        }
 
-    // Kick off the thread
-    auto pAnalysis = &analysis;
+        if (analysis.busy.exchange(true, std::memory_order_acquire))
+        {
+            continue;
+        }
 
-    // 3 spare cache buffers
-    // 1 is held by the UI most of the time as the 'last good'
-    // 1 for current processing, and 1 in the pipe
-    pAnalysis->analysisDataCache.enqueue(std::make_shared<AudioAnalysisData>());
-    pAnalysis->analysisDataCache.enqueue(std::make_shared<AudioAnalysisData>());
-    pAnalysis->analysisDataCache.enqueue(std::make_shared<AudioAnalysisData>());
+        // Read in place; the block isn't handed back to the audio thread until we're done with it
+        bool processed = false;
+        uint32_t count = 0;
+        while (const float* pSamples = sample_ring_read_begin(analysis.ring, count))
+        {
+            audio_analysis_process_block(analysis, pSamples, count);
+            sample_ring_read_end(analysis.ring);
+            scheduler.pendingBlocks--;
+            processed = true;
+        }
 
-    analysis.channel = state;
-    analysis.exited = false;
-    analysis.quitThread = false;
-    analysis.analysisThread = std::move(std::thread([=]() {
-        const auto wakeUpDelta = std::chrono::milliseconds(1);
-        for (;;)
-        {
-            // First check for quit
-            if (pAnalysis->quitThread.load())
+        analysis.busy.store(false, std::memory_order_release);
+
+        if (processed)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether some channel has blocks that no worker owns yet. Blocks on a busy channel don't count:
+// its owner drains them, and looks again after letting go, so nobody else needs to stay awake.
+bool audio_analysis_has_claimable(const AudioAnalysisScheduler& scheduler)
+{
+    if (scheduler.pendingBlocks.load() == 0)
+    {
+        return false;
+    }
+
+    for (const auto& pAnalysis : scheduler.channels)
+    {
+        if (!pAnalysis->busy.load(std::memory_order_acquire) && sample_ring_pending(pAnalysis->ring) > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether a posted parallel job still has chunks nobody has taken; ones that are only finishing
+// off don't need more helpers
+bool audio_analysis_has_open_job(AudioAnalysisScheduler& scheduler)
+{
+    if (scheduler.jobCount.load() == 0)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(scheduler.jobMutex);
+    return std::any_of(scheduler.jobs.begin(), scheduler.jobs.end(), [](const AudioAnalysisParallelJob* pJob) {
+        return pJob->nextChunk < pJob->chunks;
+    });
+}
+
+// Run one chunk of a posted parallel job; pOnly restricts it to that job
+bool audio_analysis_help_parallel(AudioAnalysisScheduler& scheduler, AudioAnalysisParallelJob* pOnly)
+{
+    if (scheduler.jobCount.load() == 0)
+    {
+        return false;
+    }
+
+    AudioAnalysisParallelJob* pJob = nullptr;
+    uint32_t chunk = 0;
+    {
+        // Jobs are only removed under the lock, so the pointers are good while we hold it
+        std::lock_guard<std::mutex> lock(scheduler.jobMutex);
+        for (auto pCandidate : scheduler.jobs)
+        {
+            if ((!pOnly || pCandidate == pOnly) && pCandidate->nextChunk < pCandidate->chunks)
             {
+                pJob = pCandidate;
+                chunk = pJob->nextChunk++;
                 break;
             }
+        }
+    }
 
-            std::shared_ptr<AudioBundle> spData;
-            if (!pAnalysis->processBundles.try_dequeue(spData))
-            {
+    if (!pJob)
+    {
+        return false;
+    }
+
+    const auto begin = chunk * pJob->chunkSize;
+    (*pJob->pFn)(begin, std::min(pJob->count, begin + pJob->chunkSize));
+
+    // The poster may return as soon as this hits 0, so it is the last touch
+    pJob->remaining.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void audio_analysis_worker(AudioAnalysisScheduler& scheduler, uint32_t workerIndex)
+{
 #ifdef DEBUG
-                Zest::Profiler::NameThread(std::format("Analysis: {}", audio_to_channel_name(pAnalysis->thisChannel)).c_str());
+    Zest::Profiler::NameThread(std::format("Analysis: {}", workerIndex).c_str());
+#else
+    UNUSED(workerIndex);
 #endif
-                // Sleep
-                std::this_thread::sleep_for(wakeUpDelta);
-                continue;
-            }
 
-            if (!pAnalysis->inputDumpPath.empty())
-            {
-                if (spData->channel.first == Channel_In && pAnalysis->inputCache.size() < pAnalysis->maxInputSize)
-                {
-                    pAnalysis->inputCache.insert(pAnalysis->inputCache.end(), spData->data.begin(), spData->data.end());
-                }
+    for (;;)
+    {
+        if (scheduler.quit.load())
+        {
+            break;
+        }
 
-                // Finished
-                if (pAnalysis->inputCache.size() >= pAnalysis->maxInputSize)
-                {
-                    // Dump to file
-                    fs::create_directories(pAnalysis->inputDumpPath.parent_path());
-                    std::ofstream outFile(pAnalysis->inputDumpPath, std::ios::binary);
-                    outFile.write((const char*)pAnalysis->inputCache.data(), pAnalysis->inputCache.size() * sizeof(float));
-                    outFile.close();
-                    //ZEST_LOG_INFO("Audio analysis dumped input to {}", pAnalysis->inputDumpPath.string());
-                    pAnalysis->inputCache.clear();
-                    pAnalysis->inputDumpPath.clear();
-                }
-            }
+        // Somebody is waiting on a parallel job; that comes before new spectra
+        if (audio_analysis_help_parallel(scheduler, nullptr))
+        {
+            continue;
+        }
 
-            audio_analysis_update(*pAnalysis, *spData);
+        if (audio_analysis_run_pending(scheduler))
+        {
+            continue;
+        }
 
-            audio_retire_bundle(spData);
+        // Register as a sleeper before the final check, so a block posted in between still wakes us.
+        // Work owned by another worker doesn't keep us up; we'd only spin until it was done.
+        scheduler.sleepingWorkers++;
+        if (!audio_analysis_has_claimable(scheduler) && !audio_analysis_has_open_job(scheduler) && !scheduler.quit.load())
+        {
+            scheduler.wake.acquire();
         }
-        pAnalysis->exited = true;
-    }));
-    return true;
+        scheduler.sleepingWorkers--;
+    }
 }
 
-void audio_analysis_stop(AudioAnalysis& analysis)
+} // namespace
+
+void audio_analysis_scheduler_start(AudioAnalysisScheduler& scheduler, uint32_t workerCount, const std::vector<std::shared_ptr<AudioAnalysis>>& channels)
 {
-    if (!analysis.exited)
+    audio_analysis_scheduler_stop(scheduler);
+
+    scheduler.channels = channels;
+
+    scheduler.quit = false;
+    for (uint32_t worker = 0; worker < std::max(1u, workerCount); worker++)
     {
-        analysis.quitThread = true;
-        analysis.analysisThread.join();
+        scheduler.workers.emplace_back([&scheduler, worker]() {
+            audio_analysis_worker(scheduler, worker);
+        });
     }
 }
 
-bool audio_analysis_init(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
+void audio_analysis_scheduler_stop(AudioAnalysisScheduler& scheduler)
 {
-    auto& ctx = GetAudioContext();
-    analysis.outputSamples = (ctx.audioAnalysisSettings.frames / 2) + 1;
+    if (scheduler.workers.empty())
+    {
+        return;
+    }
 
-    // Hamming window
-    analysis.window = audio_analysis_create_window(ctx.audioAnalysisSettings.frames);
-    analysis.totalWin = 0.0f;
-    for (auto& win : analysis.window)
+    scheduler.quit = true;
+    scheduler.wake.release(std::ptrdiff_t(scheduler.workers.size()));
+    for (auto& worker : scheduler.workers)
     {
-        analysis.totalWin += win;
+        worker.join();
     }
+    scheduler.workers.clear();
+    scheduler.channels.clear();
 
-    analysis.fftIn.resize(ctx.audioAnalysisSettings.frames, 0.0f);
-    analysis.fftOut.resize(analysis.outputSamples);
-    analysis.fftMag.resize(analysis.outputSamples);
+    // Drain any wake tokens left behind, so the next start begins asleep
+    while (scheduler.wake.try_acquire())
+    {
+    }
+    scheduler.pendingBlocks = 0;
+}
 
-    analysisData.spectrum.resize(analysis.outputSamples, (0));
-    analysisData.audio.resize(ctx.audioAnalysisSettings.frames, 0.0f);
+void audio_analysis_parallel_for(AudioAnalysisScheduler& scheduler, uint32_t count, const FftParallelRange& fn)
+{
+    const auto workerCount = uint32_t(scheduler.workers.size());
+    if (workerCount == 0 || count < 2)
+    {
+        fn(0, count);
+        return;
+    }
+
+    // A couple of chunks per thread, so a late helper still has something to take
+    AudioAnalysisParallelJob job;
+    job.pFn = &fn;
+    job.count = count;
+    job.chunkSize = std::max(1u, (count + ((workerCount + 1) * 2) - 1) / ((workerCount + 1) * 2));
+    job.chunks = (count + job.chunkSize - 1) / job.chunkSize;
+    job.remaining = job.chunks;
+
+    {
+        std::lock_guard<std::mutex> lock(scheduler.jobMutex);
+        scheduler.jobs.push_back(&job);
+    }
+    scheduler.jobCount++;
+
+    const auto sleeping = scheduler.sleepingWorkers.load();
+    if (sleeping > 0)
+    {
+        scheduler.wake.release(std::ptrdiff_t(std::min(sleeping, job.chunks - 1)));
+    }
+
+    while (audio_analysis_help_parallel(scheduler, &job))
+    {
+    }
+
+    // Helpers may still be finishing the chunks they took
+    while (job.remaining.load(std::memory_order_acquire) > 0)
+    {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(scheduler.jobMutex);
+        scheduler.jobs.erase(std::find(scheduler.jobs.begin(), scheduler.jobs.end(), &job));
+    }
+    scheduler.jobCount--;
+}
+
+std::vector<AudioAnalysisScalingResult> audio_analysis_benchmark_scaling(uint32_t size, uint32_t maxThreads, double secondsPerCount)
+{
+    using namespace std::chrono;
+
+    std::vector<AudioAnalysisScalingResult> results;
+
+    std::vector<float> in(size);
+    std::vector<FftComplex> out((size / 2) + 1);
+    for (uint32_t i = 0; i < size; i++)
+    {
+        in[i] = std::sin(float(i) * 0.01f) + (float((i * 7919u) % 1000u) / 1000.0f);
+    }
+
+    auto pPlan = fft_plan(size, FftKind::Real, FftDirection::Forward);
+    if (!pPlan)
+    {
+        return results;
+    }
+
+    auto time = [&](const FftParallelFor& parallelFor) {
+        // Warm the caches
+        fft_real_forward(pPlan, in.data(), out.data(), parallelFor);
+
+        uint64_t count = 0;
+        const auto start = steady_clock::now();
+        auto elapsed = duration<double>(0.0);
+        do
+        {
+            fft_real_forward(pPlan, in.data(), out.data(), parallelFor);
+            count++;
+            elapsed = steady_clock::now() - start;
+        } while (elapsed.count() < secondsPerCount);
+        return (elapsed.count() * 1e9) / double(count);
+    };
+
+    // The direct transform is the baseline; anything split has to beat it
+    const double directNs = time(FftParallelFor());
+
+    for (uint32_t threads = 1; threads <= std::max(1u, maxThreads); threads++)
+    {
+        // This thread plus threads - 1 helpers, with no channels to distract them
+        AudioAnalysisScheduler scheduler;
+        if (threads > 1)
+        {
+            audio_analysis_scheduler_start(scheduler, threads - 1, {});
+        }
+
+        AudioAnalysisScalingResult result;
+        result.threads = threads;
+        result.nsPerTransform = time([&scheduler](uint32_t count, const FftParallelRange& fn) {
+            audio_analysis_parallel_for(scheduler, count, fn);
+        });
+        result.speedup = directNs / result.nsPerTransform;
+        results.push_back(result);
+
+        audio_analysis_scheduler_stop(scheduler);
+    }
+    return results;
+}
 
-    analysis.cfg = kiss_fftr_alloc(ctx.audioAnalysisSettings.frames, 0, 0, 0);
+void audio_analysis_post(AudioAnalysis& analysis, uint32_t frames)
+{
+    auto& scheduler = GetAudioContext().analysisScheduler;
+
+    // The block is already visible to a worker, which may take it before this is counted;
+    // the count only decides whether workers sleep, so being briefly behind is harmless.
+    scheduler.pendingBlocks++;
 
+    // Blocks short of a hop only extend the history, so there's no point waking anybody until a
+    // spectrum is due; an awake worker will still pick them up.
+    analysis.postedSamples += frames;
+    if (analysis.postedSamples < audio_analysis_hop_size(analysis))
+    {
+        return;
+    }
+    analysis.postedSamples = 0;
+
+    // Only pay for the wake when somebody is actually asleep
+    if (scheduler.sleepingWorkers.load() > 0)
+    {
+        scheduler.wake.release();
+    }
+}
+
+uint32_t audio_analysis_hop_size(const AudioAnalysis& analysis)
+{
+    auto& ctx = GetAudioContext();
+    const auto spectraPerSecond = std::max(ctx.audioAnalysisSettings.spectraPerSecond, 1.0f);
+    return std::max(1u, uint32_t(float(analysis.channel.sampleRate) / spectraPerSecond));
+}
+
+bool audio_analysis_init(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
+{
+    auto& ctx = GetAudioContext();
+    analysisData.spectrum.resize(analysis.outputSamples, (0));
+    // The plot only needs the latest samples, not a large FFT's worth
+    analysisData.audio.resize(std::min(ctx.audioAnalysisSettings.frames, AudioSnapshotMaxFrames), 0.0f);
     return true;
 }
 
+// Append to the history ring; only the newest history.size() samples are kept
+void audio_analysis_history_write(AudioAnalysis& analysis, const float* pSamples, uint32_t count)
+{
+    const auto size = uint32_t(analysis.history.size());
+    if (count >= size)
+    {
+        memcpy(analysis.history.data(), pSamples + (count - size), sizeof(float) * size);
+        analysis.historyWrite = 0;
+        return;
+    }
+
+    const auto firstCount = std::min(count, size - analysis.historyWrite);
+    memcpy(&analysis.history[analysis.historyWrite], pSamples, sizeof(float) * firstCount);
+    memcpy(analysis.history.data(), pSamples + firstCount, sizeof(float) * (count - firstCount));
+    analysis.historyWrite = (analysis.historyWrite + count) % size;
+}
+
+// The newest count samples as (up to) two contiguous spans, oldest first
+AudioAnalysisHistorySpans audio_analysis_history_spans(const AudioAnalysis& analysis, uint32_t count)
+{
+    const auto size = uint32_t(analysis.history.size());
+    count = std::min(count, size);
+
+    const auto start = (analysis.historyWrite + size - count) % size;
+    AudioAnalysisHistorySpans spans;
+    spans.pFirst = &analysis.history[start];
+    spans.firstCount = std::min(count, size - start);
+    spans.pSecond = analysis.history.data();
+    spans.secondCount = count - spans.firstCount;
+    return spans;
+}
+
 // On thread; update
-void audio_analysis_update(AudioAnalysis& analysis, AudioBundle& bundle)
+void audio_analysis_update(AudioAnalysis& analysis, const float* pSamples, uint32_t count)
 {
     PROFILE_SCOPE(Audio_Analysis);
     auto& ctx = GetAudioContext();
@@ -202,48 +593,74 @@ void audio_analysis_update(AudioAnalysis& analysis, AudioBundle& bundle)
     // frequencies if the samples didn't perfectly tile (as they won't).
     // he windowing function smooths the outer edges to remove this transition and give more accurate results.
 
-    // Deque from our spare data cache
-    std::shared_ptr<AudioAnalysisData> spAnalysisData;
-    if (!analysis.analysisDataCache.try_dequeue(spAnalysisData))
+#ifdef _DEBUG
+    for (uint32_t i = 0; i < count; i++)
     {
-        return;
+        assert(std::isfinite(pSamples[i]));
     }
+#endif
 
-    auto& analysisData = *spAnalysisData;
-    if (analysisData.audio.empty())
+    // Always keep the history, even if there is no buffer to output into this time
+    audio_analysis_history_write(analysis, pSamples, count);
+
+    const auto stride = audio_analysis_stride(analysis);
+    const auto blockFrames = count / stride;
+
+    // The zoom's filters have to see every sample, not just the ones around a hop
+    if (ctx.audioAnalysisSettings.zoomEnabled)
     {
-        // Setup analysis
-        audio_analysis_init(analysis, analysisData);
+        const ZoomFftSettings zoomSettings{ float(analysis.channel.sampleRate), ctx.audioAnalysisSettings.zoomDecimation, ctx.audioAnalysisSettings.zoomFrames, analysis.iq };
+        zoom_fft_configure(analysis.zoom, zoomSettings);
+        zoom_fft_set_center(analysis.zoom, ctx.analysisZoomCenterHz.load());
+        if (analysis.iq)
+        {
+            zoom_fft_process_complex(analysis.zoom, reinterpret_cast<const FftComplex*>(pSamples), blockFrames);
+        }
+        else
+        {
+            zoom_fft_process(analysis.zoom, pSamples, blockFrames);
+        }
     }
 
-    auto& audioBuffer = analysisData.audio;
-
-#ifdef _DEBUG
-    for (auto& val : bundle.data)
+    // One spectrum per hop, however the device chops up the input. If a block spans several
+    // hops, only the latest spectrum is worth computing.
+    const auto hop = audio_analysis_hop_size(analysis);
+    analysis.hopSamples += blockFrames;
+    if (analysis.hopSamples < hop)
     {
-        assert(std::isfinite(val));
+        return;
     }
-#endif
+    analysis.hopSamples %= hop;
 
-    auto floatsToAdd = std::min(bundle.data.size(), audioBuffer.size());
-    auto floatsToMove = audioBuffer.size() - floatsToAdd;
+    // The back slot is always ours; the UI only ever holds the other two
+    auto& analysisData = triple_buffer_write(analysis.results);
+    if (analysisData.spectrum.empty())
+    {
+        // Setup analysis
+        audio_analysis_init(analysis, analysisData);
+    }
 
-    // Sliding input buffer
-    if (floatsToAdd > 0)
+    // Output buffers only carry a copy for the plots; the history itself stays in the ring.
+    // The plot shows I of an I/Q pair.
     {
-        const float* pSource;
-        float* pDest;
-        if (floatsToMove > 0)
+        const auto spans = audio_analysis_history_spans(analysis, uint32_t(analysisData.audio.size()) * stride);
+        if (stride == 1)
         {
-            pSource = (const float*)&audioBuffer[floatsToAdd];
-            pDest = (float*)&audioBuffer[0];
-
-            memmove(pDest, pSource, floatsToMove * sizeof(float));
+            memcpy(analysisData.audio.data(), spans.pFirst, sizeof(float) * spans.firstCount);
+            memcpy(analysisData.audio.data() + spans.firstCount, spans.pSecond, sizeof(float) * spans.secondCount);
+        }
+        else
+        {
+            auto pOut = analysisData.audio.data();
+            for (uint32_t i = 0; i < spans.firstCount; i += stride)
+            {
+                *pOut++ = spans.pFirst[i];
+            }
+            for (uint32_t i = 0; i < spans.secondCount; i += stride)
+            {
+                *pOut++ = spans.pSecond[i];
+            }
         }
-
-        pDest = (float*)&audioBuffer[floatsToMove];
-        pSource = (float*)&bundle.data[0];
-        memcpy(&audioBuffer[floatsToMove], &bundle.data[0], sizeof(float) * floatsToAdd);
     }
 
     audio_analysis_calculate_audio(analysis, analysisData);
@@ -253,44 +670,121 @@ void audio_analysis_update(AudioAnalysis& analysis, AudioBundle& bundle)
     {
         {
             PROFILE_SCOPE(FFT);
-            for (uint32_t i = 0; i < ctx.audioAnalysisSettings.frames; i++)
+
+            const auto frames = ctx.audioAnalysisSettings.frames;
+            fft_plan_update(analysis.fftPlan, frames, analysis.iq ? FftKind::Complex : FftKind::Real, FftDirection::Forward);
+
+            // Welch; the average of overlapping segments, newest first. Silence is all zeros, so one will do.
+            // The history is sized at start, so a live change to the segment count is capped by it.
+            const auto step = audio_analysis_welch_step(ctx.audioAnalysisSettings);
+            const auto historySegments = 1 + ((uint32_t(analysis.history.size()) / stride) - frames) / step;
+            const auto segments = analysis.audioActive ? std::min(ctx.audioAnalysisSettings.welchSegments, historySegments) : 1u;
+            analysis.welchSegments = segments;
+
+            // Power, scaled by the window gain and averaged over the segments
+            const auto winScale = std::max(analysis.totalWin, 1e-6f);
+            const float powerScale = 1.0f / (winScale * winScale * float(segments));
+
+            // Large transforms are shared with any idle workers; small ones aren't worth the handoff
+            auto& scheduler = ctx.analysisScheduler;
+            FftParallelFor parallelFor;
+            if (frames > FftSixStepMinSize && scheduler.workers.size() > 1)
             {
-                // Hamming window, FF
-                if (analysis.audioActive)
+                parallelFor = [&scheduler](uint32_t count, const FftParallelRange& fn) {
+                    audio_analysis_parallel_for(scheduler, count, fn);
+                };
+            }
+
+            for (uint32_t segment = 0; segment < segments; segment++)
+            {
+                // The segment is the oldest frames samples of the newest frames + segment * step
+                const auto spans = audio_analysis_history_spans(analysis, (frames + (segment * step)) * stride);
+                const auto firstCount = std::min(spans.firstCount / stride, frames);
+
+                if (analysis.iq)
                 {
-                    analysis.fftIn[i] = audioBuffer[i] * analysis.window[i];
+                    // Hamming window on both I and Q; a complex FFT of the pair
+                    if (analysis.audioActive)
+                    {
+                        const auto pFirst = reinterpret_cast<const FftComplex*>(spans.pFirst);
+                        const auto pSecond = reinterpret_cast<const FftComplex*>(spans.pSecond);
+                        for (uint32_t i = 0; i < frames; i++)
+                        {
+                            const auto& sample = (i < firstCount) ? pFirst[i] : pSecond[i - firstCount];
+                            analysis.fftInComplex[i] = FftComplex{ sample.r * analysis.window[i], sample.i * analysis.window[i] };
+                        }
+                    }
+                    else
+                    {
+                        std::fill(analysis.fftInComplex.begin(), analysis.fftInComplex.end(), FftComplex{ 0.0f, 0.0f });
+                    }
+
+                    if (parallelFor)
+                    {
+                        fft_complex(analysis.fftPlan, analysis.fftInComplex.data(), analysis.fftOut.data(), parallelFor);
+                    }
+                    else
+                    {
+                        fft_complex(analysis.fftPlan, analysis.fftInComplex.data(), analysis.fftOut.data());
+                    }
                 }
                 else
                 {
-                    analysis.fftIn[i] = 0.0f;
+                    // Hamming window, FF; gathered straight from the ring, the window split at the wrap
+                    if (analysis.audioActive)
+                    {
+                        spectral_window(spans.pFirst, analysis.window.data(), analysis.fftIn.data(), firstCount);
+                        spectral_window(spans.pSecond, analysis.window.data() + firstCount, analysis.fftIn.data() + firstCount, frames - firstCount);
+
+                        // Normalize; (x - min) / range, with the window already applied to x
+                        if (ctx.audioAnalysisSettings.normalizeAudio)
+                        {
+                            const float invRange = 1.0f / (analysis.audioMax - analysis.audioMin);
+                            for (uint32_t i = 0; i < frames; i++)
+                            {
+                                analysis.fftIn[i] = (analysis.fftIn[i] - analysis.audioMin * analysis.window[i]) * invRange;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        std::fill(analysis.fftIn.begin(), analysis.fftIn.end(), 0.0f);
+                    }
+
+                    if (parallelFor)
+                    {
+                        fft_real_forward(analysis.fftPlan, analysis.fftIn.data(), analysis.fftOut.data(), parallelFor);
+                    }
+                    else
+                    {
+                        fft_real_forward(analysis.fftPlan, analysis.fftIn.data(), analysis.fftOut.data());
+                    }
+
+                    // 0 for imaginary part
+                    analysis.fftOut[0].i = 0.0f;
                 }
-            }
-
-            kiss_fftr(analysis.cfg, analysis.fftIn.data(), analysis.fftOut.data());
 
-            // 0 for imaginary part
-            analysis.fftOut[0].i = 0.0f;
-
-            // Convert to dB
-            auto winScale = std::max(analysis.totalWin, 1e-6f);
-            for (uint32_t i = 1; i < analysis.outputSamples; i++)
-            {
-                const float real = analysis.fftOut[i].r;
-                const float imag = analysis.fftOut[i].i;
-                analysis.fftMag[i] = (real * real + imag * imag) / (winScale * winScale);
+                if (segment == 0)
+                {
+                    spectral_power(analysis.fftOut.data(), analysis.fftMag.data(), analysis.outputSamples, powerScale);
+                }
+                else
+                {
+                    spectral_power(analysis.fftOut.data(), analysis.welchMag.data(), analysis.outputSamples, powerScale);
+                    for (uint32_t i = 0; i < analysis.outputSamples; i++)
+                    {
+                        analysis.fftMag[i] += analysis.welchMag[i];
+                    }
+                }
             }
-            const float dcReal = analysis.fftOut[0].r;
-            const float dcImag = analysis.fftOut[0].i;
-            analysis.fftMag[0] = (dcReal * dcReal + dcImag * dcImag) / (winScale * winScale);
         }
 
         audio_analysis_calculate_spectrum(analysis, analysisData);
+        audio_analysis_calculate_zoom(analysis, analysisData);
     }
 
-    // Send it
-    analysis.analysisData.enqueue(spAnalysisData);
-
-    ctx.analysisWriteGeneration++;
+    // Send it; replaces any frame the UI hasn't picked up yet
+    triple_buffer_publish(analysis.results);
 }
 
 void audio_analysis_calculate_audio(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
@@ -306,19 +800,19 @@ void audio_analysis_calculate_audio(AudioAnalysis& analysis, AudioAnalysisData&
     // his is because the FF behaves as if your sample repeats forever, and would therefore generate extra
     // frequencies if the samples didn't perfectly tile (as they won't).
     // he windowing function smooths the outer edges to remove this transition and give more accurate results.
-    auto& audioBuf = analysisData.audio;
-    auto& audioBufOld = analysisData.audio[1 - analysisData.currentBuffer];
-
     analysis.audioActive = false;
 
     // Find the min/max
     auto maxAudio = -std::numeric_limits<float>::max();
     auto minAudio = std::numeric_limits<float>::max();
-    for (uint32_t i = 0; i < audioBuf.size(); i++)
+    const auto spans = audio_analysis_history_spans(analysis, ctx.audioAnalysisSettings.frames * audio_analysis_stride(analysis));
+    for (auto [pSamples, count] : { std::make_pair(spans.pFirst, spans.firstCount), std::make_pair(spans.pSecond, spans.secondCount) })
     {
-        auto fVal = audioBuf[i];
-        maxAudio = std::max(maxAudio, fVal);
-        minAudio = std::min(minAudio, fVal);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            maxAudio = std::max(maxAudio, pSamples[i]);
+            minAudio = std::min(minAudio, pSamples[i]);
+        }
     }
 
     // Only process active audio
@@ -327,14 +821,35 @@ void audio_analysis_calculate_audio(AudioAnalysis& analysis, AudioAnalysisData&
         analysis.audioActive = true;
     }
 
-    // Normalize
-    for (uint32_t i = 0; i < audioBuf.size(); i++)
+    // The history is shared, so normalization is applied to the FFT input, not in place
+    analysis.audioMin = minAudio;
+    analysis.audioMax = maxAudio;
+}
+
+void audio_analysis_calculate_zoom(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
+{
+    auto& ctx = GetAudioContext();
+    if (!ctx.audioAnalysisSettings.zoomEnabled || analysis.zoom.history.empty())
     {
-        if (ctx.audioAnalysisSettings.normalizeAudio)
-        {
-            audioBuf[i] = (audioBuf[i] - minAudio) / (maxAudio - minAudio);
-        }
+        analysisData.zoomSpectrum.clear();
+        return;
     }
+
+    PROFILE_SCOPE(Zoom);
+
+    const auto& settings = analysis.zoom.settings;
+    analysis.zoomPower.resize(settings.frames);
+    zoom_fft_power(analysis.zoom, analysis.zoomPower.data());
+
+    // Only hand on the part of the span the decimators keep clean
+    const auto usable = uint32_t(double(settings.frames) * ZoomFftUsableFraction);
+    const auto first = (settings.frames - usable) / 2;
+    const double binHz = zoom_fft_bin_hz(settings);
+
+    analysisData.zoomSpectrum.resize(usable);
+    spectral_power_to_db(analysis.zoomPower.data() + first, analysisData.zoomSpectrum.data(), usable, ctx.audioAnalysisSettings.audioDecibelRange);
+    analysisData.zoomMinHz = analysis.zoom.centerHz - (zoom_fft_span_hz(settings) * 0.5) + (double(first) * binHz);
+    analysisData.zoomMaxHz = analysisData.zoomMinHz + (double(usable) * binHz);
 }
 
 void audio_analysis_calculate_spectrum(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
@@ -342,58 +857,66 @@ void audio_analysis_calculate_spectrum(AudioAnalysis& analysis, AudioAnalysisDat
     PROFILE_SCOPE(Spectrum);
     auto& ctx = GetAudioContext();
 
-    float minSpec = std::numeric_limits<float>::max();
-    float maxSpec = std::numeric_limits<float>::min();
-
-    float maxSpectrumValue = std::numeric_limits<float>::min();
-    uint32_t maxSpectrumBucket = 0;
-
     auto& spectrum = analysisData.spectrum;
     auto& spectrumBuckets = analysisData.spectrumBuckets;
 
     //LOG(DBG, "Analysis Writing: " << (analysis.thisChannel == 0 ? "L" : "R") << ": " << audio_analysis_write_index(analysisData));
-    for (uint32_t i = 0; i < analysis.outputSamples; i++)
+    // Where 0Hz ends up in the spectrum
+    const uint32_t dcBin = analysis.iq ? (analysis.outputSamples / 2) : 0;
     {
-        // Magnitude
-        const float ref = 1.0f; // Source reference value, but we are +/1.0f
-
-        const bool hasNyquist = (ctx.audioAnalysisSettings.frames % 2) == 0;
-        // Magnitude * 2 because we are half the spectrum,
-        // divided by the total of the hamming window to compenstate
-        spectrum[i] = analysis.fftMag[i];
-        if (i != 0 && !(hasNyquist && i == (analysis.outputSamples - 1)))
+        if (analysis.iq)
         {
-            spectrum[i] *= 2.0f;
+            // Two sided; rotate so the negative frequencies come first, and -Nyquist is spectrum[0]
+            std::copy(analysis.fftMag.begin() + dcBin, analysis.fftMag.end(), spectrum.begin());
+            std::copy(analysis.fftMag.begin(), analysis.fftMag.begin() + dcBin, spectrum.begin() + (analysis.outputSamples - dcBin));
+            analysisData.minHz = -double(analysis.channel.sampleRate) * 0.5;
+            analysisData.fullScalePower = 1.0f;
         }
-        if (i == 0 && ctx.audioAnalysisSettings.suppressDc)
+        else
         {
-            spectrum[i] = 0.0f;
-            continue;
+            // Magnitude * 2 because we are half the spectrum; the window gain was divided out with the power.
+            // DC and Nyquist have no mirror image, so they stay as they are.
+            const bool hasNyquist = (ctx.audioAnalysisSettings.frames % 2) == 0;
+            const uint32_t doubledEnd = hasNyquist ? analysis.outputSamples - 1 : analysis.outputSamples;
+            spectrum[0] = analysis.fftMag[0];
+            for (uint32_t i = 1; i < doubledEnd; i++)
+            {
+                spectrum[i] = analysis.fftMag[i] * 2.0f;
+            }
+            if (doubledEnd < analysis.outputSamples)
+            {
+                spectrum[doubledEnd] = analysis.fftMag[doubledEnd];
+            }
+            analysisData.minHz = 0.0;
+            analysisData.fullScalePower = 0.5f;
         }
-        spectrum[i] = std::max(spectrum[i], std::numeric_limits<float>::min());
 
-        // assert(std::isfinite(spectrum[i]));
+        // Tracked on the linear power, before it is turned into dB
+        audio_analysis_calculate_noise_floor(analysis, analysisData);
 
-        if (spectrum[i] > maxSpectrumValue)
+        // Prefix sum for band queries; double, so a narrow band high up doesn't lose its few bits
+        auto& cumulative = analysisData.cumulativePower;
+        cumulative.resize(analysis.outputSamples + 1);
+        cumulative[0] = 0.0;
+        const double invEnbw = 1.0 / double(analysis.windowEnbw);
+        const bool skipDc = ctx.audioAnalysisSettings.suppressDc;
+        for (uint32_t i = 0; i < analysis.outputSamples; i++)
         {
-            maxSpectrumValue = spectrum[i];
-            maxSpectrumBucket = i;
+            cumulative[i + 1] = cumulative[i] + ((skipDc && i == dcBin) ? 0.0 : (double(spectrum[i]) * invEnbw));
         }
+        analysisData.binHz = double(analysis.channel.sampleRate) / double(ctx.audioAnalysisSettings.frames);
 
-        // Log based on a reference value of 1
-        spectrum[i] = std::max(spectrum[i], 1e-10f);
-        spectrum[i] = 10 * std::log10(spectrum[i] / ref);
+        audio_analysis_calculate_peaks(analysis, analysisData);
+        audio_analysis_calculate_skimmer(analysis, analysisData);
 
-        // Normalize by moving up and dividing
-        // Decibels are now positive from 0->1;
-        spectrum[i] /= ctx.audioAnalysisSettings.audioDecibelRange;
-        spectrum[i] += 1.0f;
-        spectrum[i] = std::clamp(spectrum[i], 0.0f, 1.0f);
+        // Log based on a reference value of 1 (we are +/-1.0f), then normalize so that
+        // decibels are positive from 0->1
+        spectral_power_to_db(spectrum.data(), spectrum.data(), analysis.outputSamples, ctx.audioAnalysisSettings.audioDecibelRange);
 
-        if (i != 0)
+        if (ctx.audioAnalysisSettings.suppressDc)
         {
-            minSpec = std::min(minSpec, spectrum[i]);
-            maxSpec = std::max(maxSpec, spectrum[i]);
+            spectrum[dcBin] = 0.0f;
+            analysisData.noiseFloor[dcBin] = 0.0f;
         }
     }
 
@@ -418,46 +941,27 @@ void audio_analysis_calculate_spectrum(AudioAnalysis& analysis, AudioAnalysisDat
     }
 
     {
-        uint32_t buckets = std::min(analysis.outputSamples, uint32_t(ctx.audioAnalysisSettings.spectrumBuckets));
-        buckets = std::max(buckets, 4u);
+        PROFILE_SCOPE(Buckets);
 
-        // Quantize into bigger buckets; filtering helps smooth the graph, and gives a more pleasant effect
-        uint32_t spectrumSamples = uint32_t(spectrum.size());
+        // Quantize into bigger buckets; filtering helps smooth the graph, and gives a more pleasant effect.
+        // The weight matrix only changes with the settings.
+        const auto partitionSettings = audio_analysis_partition_settings(analysis.iq);
+        assert(partitionSettings.limit == spectrum.size());
+        spectrum_partition_build(analysis.spectrumPartition, partitionSettings);
 
-        audio_analysis_gen_linear_space(analysis, spectrumSamples, buckets);
+        spectrumBuckets.resize(partitionSettings.n);
+        spectrum_partition_apply(analysis.spectrumPartition, spectrum.data(), spectrumBuckets.data());
 
-        auto itrPartition = analysis.spectrumPartitions.begin();
+        auto& noiseFloorBuckets = analysisData.noiseFloorBuckets;
+        noiseFloorBuckets.resize(partitionSettings.n);
+        spectrum_partition_apply(analysis.spectrumPartition, analysisData.noiseFloor.data(), noiseFloorBuckets.data());
 
-        if (buckets > 0)
+        float noiseTotal = 0.0f;
+        for (auto& noise : noiseFloorBuckets)
         {
-            float countPerBucket = (float)spectrumSamples / (float)buckets;
-            uint32_t currentBucket = 0;
-
-            float av = 0.0f;
-            uint32_t averageCount = 0;
-
-            spectrumBuckets.resize(buckets);
-
-            // Ignore the first spectrum sample
-            for (uint32_t i = 1; i < spectrumSamples; i++)
-            {
-                av += spectrum[i];
-                averageCount++;
-
-                if (i >= *itrPartition)
-                {
-                    spectrumBuckets[currentBucket++] = av / (float)averageCount;
-                    av = 0.0f; // reset sum for next average
-                    averageCount = 0;
-                    itrPartition++;
-                }
-
-                // Sanity
-                if (itrPartition == analysis.spectrumPartitions.end()
-                    || currentBucket >= buckets)
-                    break;
-            }
+            noiseTotal += noise;
         }
+        analysisData.noiseFloorLevel = noiseTotal / float(std::max<size_t>(1, noiseFloorBuckets.size()));
     }
 
     if (ctx.audioAnalysisSettings.blendFFT)
@@ -468,8 +972,8 @@ void audio_analysis_calculate_spectrum(AudioAnalysis& analysis, AudioAnalysisDat
         }
         else
         {
-            // Time in seconds for a full FFT frame
-            const float deltaTimeFrame = float(analysis.channel.deltaTime * ctx.audioAnalysisSettings.frames);
+            // Time in seconds between spectra
+            const float deltaTimeFrame = float(analysis.channel.deltaTime * audio_analysis_hop_size(analysis));
             const float blendSeconds = std::max(ctx.audioAnalysisSettings.blendFactor / 1000.0f, 1e-4f);
             const float alpha = std::clamp(1.0f - std::exp(-deltaTimeFrame / blendSeconds), 0.0f, 1.0f);
 
@@ -486,68 +990,259 @@ void audio_analysis_calculate_spectrum(AudioAnalysis& analysis, AudioAnalysisDat
     audio_analysis_calculate_spectrum_bands(analysis, analysisData);
 }
 
-// Divide the frequency spectrum into 4 values representing the average spectrum magnitude for
-// each value's frequency range, as requested by the user.
-// For example, vec4.x might end up containing 0->500Hz, vec4.y might be 500-1000Hz, etc.
-void audio_analysis_calculate_spectrum_bands(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
+// Minimum statistics (after Martin): smooth each bin's power over time, and take the minimum
+// over the last noiseWindowSeconds as the floor. Carriers come and go within the window, so
+// the minimum sits on the noise between them; the bias puts it back up to the mean noise power.
+void audio_analysis_calculate_noise_floor(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
 {
-    PROFILE_SCOPE(Bands);
+    PROFILE_SCOPE(NoiseFloor);
     auto& ctx = GetAudioContext();
 
-    auto blendFactor = 1.0f;
-    auto bands = glm::vec4(0.0f);
+    const auto& power = analysisData.spectrum;
+    const auto bins = uint32_t(power.size());
+
+    const float hopSeconds = float(analysis.channel.deltaTime * audio_analysis_hop_size(analysis));
+    const float subWindowSeconds = ctx.audioAnalysisSettings.noiseWindowSeconds / float(NoiseSubWindows);
+    const auto spectraPerSubWindow = std::max(1u, uint32_t(std::ceil(subWindowSeconds / std::max(hopSeconds, 1e-6f))));
 
-    // Calculate frequency per FFT sample
-    auto frequencyPerBucket = float(analysis.channel.sampleRate) / float(analysisData.spectrumBuckets.size());
-    auto spectrumOffsets = (ctx.audioAnalysisSettings.spectrumFrequencies / (uint32_t)frequencyPerBucket) + glm::uvec4(1, 1, 1, 0);
+    // (Re)start from this spectrum
+    if (analysis.noiseSmoothed.size() != bins)
+    {
+        analysis.noiseSmoothed.assign(power.begin(), power.end());
+        analysis.noiseActiveMin = analysis.noiseSmoothed;
+        analysis.noiseSubMins.assign(size_t(bins) * NoiseSubWindows, std::numeric_limits<float>::max());
+        analysis.noiseWindowMin.assign(bins, std::numeric_limits<float>::max());
+        analysis.noiseSubIndex = 0;
+        analysis.noiseSubSpectra = 0;
+    }
+
+    const float alpha = std::exp(-hopSeconds / NoiseSmoothingSeconds);
+    for (uint32_t i = 0; i < bins; i++)
+    {
+        analysis.noiseSmoothed[i] = (alpha * analysis.noiseSmoothed[i]) + ((1.0f - alpha) * power[i]);
+        analysis.noiseActiveMin[i] = std::min(analysis.noiseActiveMin[i], analysis.noiseSmoothed[i]);
+    }
 
-    for (uint32_t sample = 0; sample < analysisData.spectrumBuckets.size(); sample++)
+    // Retire the sub-window; the window minimum only needs redoing when one drops out
+    if (++analysis.noiseSubSpectra >= spectraPerSubWindow)
     {
-        for (uint32_t index = 0; index < 4; index++)
+        std::copy(analysis.noiseActiveMin.begin(), analysis.noiseActiveMin.end(), analysis.noiseSubMins.begin() + (size_t(analysis.noiseSubIndex) * bins));
+        analysis.noiseSubIndex = (analysis.noiseSubIndex + 1) % NoiseSubWindows;
+        analysis.noiseSubSpectra = 0;
+
+        std::copy(analysis.noiseSubMins.begin(), analysis.noiseSubMins.begin() + bins, analysis.noiseWindowMin.begin());
+        for (uint32_t row = 1; row < NoiseSubWindows; row++)
         {
-            if (sample < uint32_t(spectrumOffsets[index]))
+            const float* pRow = &analysis.noiseSubMins[size_t(row) * bins];
+            for (uint32_t i = 0; i < bins; i++)
             {
-                bands[index] += analysisData.spectrumBuckets[index];
-                break;
+                analysis.noiseWindowMin[i] = std::min(analysis.noiseWindowMin[i], pRow[i]);
             }
         }
+        analysis.noiseActiveMin = analysis.noiseSmoothed;
     }
 
-    // Divide out by the size of the buckets sampled so that each band is evenly weighted
-    float lastOffset = 0;
-    for (uint32_t index = 0; index < 4; index++)
+    const float bias = NoiseBiasOneSegment - (NoiseBiasPerOctave * std::log2(float(analysis.welchSegments)));
+
+    auto& noiseFloorPower = analysis.noiseFloorPower;
+    noiseFloorPower.resize(bins);
+    for (uint32_t i = 0; i < bins; i++)
     {
-        bands[index] /= float(spectrumOffsets[index] - lastOffset);
-        lastOffset = float(spectrumOffsets[index]);
+        noiseFloorPower[i] = std::min(analysis.noiseWindowMin[i], analysis.noiseActiveMin[i]) * bias;
     }
 
-    // Adjust by requested gain
-    bands = bands * ctx.audioAnalysisSettings.spectrumGains;
-
-    // Blend for smoother result
-    analysis.spectrumBands.store(bands * blendFactor + analysis.spectrumBands.load() * (1.0f - blendFactor));
+    analysisData.noiseFloor.resize(bins);
+    spectral_power_to_db(noiseFloorPower.data(), analysisData.noiseFloor.data(), bins, ctx.audioAnalysisSettings.audioDecibelRange);
 }
 
-// This is a simple linear partitioning of the frequencies
-void audio_analysis_gen_linear_space(AudioAnalysis& analysis, uint32_t limit, uint32_t n)
+// Local maxima clear of the noise floor, strongest first. The main lobe of a windowed sine is
+// close to a Gaussian, so a parabola through the log power of the bins either side of a maximum
+// finds its center and height to a small fraction of a bin, scalloping included.
+void audio_analysis_calculate_peaks(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
 {
-    SpectrumPartitionSettings settings;
-    settings.limit = limit;
-    settings.n = n;
+    PROFILE_SCOPE(Peaks);
+    auto& ctx = GetAudioContext();
+
+    const auto& power = analysisData.spectrum;
+    const auto& noiseFloorPower = analysis.noiseFloorPower;
+    const auto bins = uint32_t(power.size());
+    const float minSnr = std::pow(10.0f, ctx.audioAnalysisSettings.peakMinSnrDb / 10.0f);
+
+    auto localFloor = [&](uint32_t bin) {
+        const auto first = noiseFloorPower.begin() + std::max(bin, PeakFloorBins) - PeakFloorBins;
+        const auto last = noiseFloorPower.begin() + std::min(bin + PeakFloorBins + 1, bins);
+        return std::max(*std::min_element(first, last), 1e-30f);
+    };
+
+    // The end bins have only one neighbour, so they are never peaks
+    auto& candidates = analysis.peakCandidates;
+    candidates.clear();
+    for (uint32_t i = 1; i + 1 < bins; i++)
+    {
+        if (power[i] > power[i - 1] && power[i] >= power[i + 1] && power[i] > localFloor(i) * minSnr)
+        {
+            candidates.push_back(i);
+        }
+    }
+
+    const auto count = std::min(size_t(ctx.audioAnalysisSettings.peakCount), candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [&power](uint32_t a, uint32_t b) {
+        return power[a] > power[b];
+    });
+
+    auto& peaks = analysisData.peaks;
+    peaks.resize(count);
+    for (size_t index = 0; index < count; index++)
+    {
+        const auto bin = candidates[index];
+        const float a = std::log(std::max(power[bin - 1], 1e-30f));
+        const float b = std::log(power[bin]);
+        const float c = std::log(std::max(power[bin + 1], 1e-30f));
+        const float curve = a - (2.0f * b) + c;
+        const float delta = (curve < 0.0f) ? std::clamp(0.5f * (a - c) / curve, -0.5f, 0.5f) : 0.0f;
+        const float peakPower = std::exp(b - (0.25f * (a - c) * delta));
+
+        auto& peak = peaks[index];
+        peak.bin = bin;
+        peak.hz = analysisData.minHz + ((double(bin) + delta) * analysisData.binHz);
+        peak.powerDb = 10.0f * std::log10(peakPower / analysisData.fullScalePower);
+        peak.snrDb = 10.0f * std::log10(peakPower / localFloor(bin));
+
+        // Continues the nearest of the last spectrum's peaks, if one was close enough
+        peak.persistence = 1;
+        for (const auto& previous : analysis.previousPeaks)
+        {
+            if (std::abs(previous.hz - peak.hz) <= (1.5 * analysisData.binHz))
+            {
+                peak.persistence = std::max(peak.persistence, previous.persistence + 1);
+            }
+        }
+    }
+    analysis.previousPeaks.assign(peaks.begin(), peaks.end());
+
+    analysis.currentMaxSpectrum = 0.0f;
+    analysis.maxSpectrumIndex = 0;
+    if (!peaks.empty())
+    {
+        spectral_power_to_db(&power[peaks[0].bin], &analysis.currentMaxSpectrum, 1, ctx.audioAnalysisSettings.audioDecibelRange);
+        analysis.maxSpectrumIndex = peaks[0].bin;
+    }
+}
 
-    if (analysis.lastSpectrumPartitions == settings)
+// Decodes every carrier the peak search turns up, on the linear spectrum, one tick per hop. Only
+// the first input channel is skimmed; that's where the band comes in.
+void audio_analysis_calculate_skimmer(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
+{
+    auto& ctx = GetAudioContext();
+    const auto& settings = ctx.audioAnalysisSettings;
+    if (!settings.skimmerEnabled || analysis.thisChannel.first != Channel_In || analysis.thisChannel.second != 0)
     {
+        if (!analysis.skimmer.activeList.empty())
+        {
+            cw_skimmer_reset(analysis.skimmer);
+        }
+        analysisData.spots.clear();
         return;
     }
 
-    // Remember what we did last
-    analysis.lastSpectrumPartitions = settings;
+    CwSkimmerSettings skimmerSettings;
+    skimmerSettings.tickSeconds = float(analysis.channel.deltaTime * audio_analysis_hop_size(analysis));
+    skimmerSettings.binHz = analysisData.binHz;
+    skimmerSettings.minHz = analysisData.minHz;
+    skimmerSettings.seedSnrDb = settings.skimmerSnrDb;
+    skimmerSettings.maxTracks = settings.skimmerTracks;
+
+    // The tracks are independent, so they spread over the pool like a large transform does
+    auto& scheduler = ctx.analysisScheduler;
+    FftParallelFor parallelFor;
+    if (scheduler.workers.size() > 1)
+    {
+        parallelFor = [&scheduler](uint32_t count, const FftParallelRange& fn) {
+            audio_analysis_parallel_for(scheduler, count, fn);
+        };
+    }
+
+    cw_skimmer_update(analysis.skimmer, skimmerSettings, analysisData.spectrum.data(), analysis.noiseFloorPower.data(), uint32_t(analysisData.spectrum.size()),
+        analysis.peakCandidates.data(), uint32_t(analysis.peakCandidates.size()), parallelFor);
+    cw_skimmer_spots(analysis.skimmer, analysisData.spots);
+}
+
+// Prefix-sum band power over [loHz, hiHz]
+float audio_analysis_band_power(const AudioAnalysisData& data, double loHz, double hiHz)
+{
+    const auto& cumulative = data.cumulativePower;
+    if (cumulative.size() < 2 || data.binHz <= 0.0)
+    {
+        return 0.0f;
+    }
+
+    // Bin k covers [k - 0.5, k + 0.5] * binHz above minHz; interpolate into the bin an edge falls in
+    const auto bins = uint32_t(cumulative.size() - 1);
+    auto powerBelow = [&](double hz) {
+        const double x = std::clamp(((hz - data.minHz) / data.binHz) + 0.5, 0.0, double(bins));
+        const auto bin = std::min(uint32_t(x), bins - 1);
+        return cumulative[bin] + ((x - double(bin)) * (cumulative[bin + 1] - cumulative[bin]));
+    };
+
+    if (hiHz < loHz)
+    {
+        std::swap(loHz, hiHz);
+    }
+    return float(std::max(0.0, powerBelow(hiHz) - powerBelow(loHz)));
+}
+
+// Divide the frequency spectrum into 4 values representing the average spectrum magnitude for
+// each value's frequency range, as requested by the user.
+// For example, vec4.x might end up containing 0->500Hz, vec4.y might be 500-1000Hz, etc.
+void audio_analysis_calculate_spectrum_bands(AudioAnalysis& analysis, AudioAnalysisData& analysisData)
+{
+    PROFILE_SCOPE(Bands);
+    auto& ctx = GetAudioContext();
+
+    auto blendFactor = 1.0f;
+    auto bands = glm::vec4(0.0f);
 
-    analysis.spectrumPartitions.resize(n);
-    for (uint32_t i = 0; i < n; i++)
+    // Each band runs from the previous frequency up to its own. The mean bin power is used so
+    // that each band is evenly weighted, on the same normalized dB scale as the spectrum.
+    const auto binHz = std::max(analysisData.binHz, 1e-6);
+    double loHz = 0.0;
+    for (uint32_t index = 0; index < 4; index++)
     {
-        analysis.spectrumPartitions[i] = float(limit) * (float(i) / (float(n)));
+        const double hiHz = double(ctx.audioAnalysisSettings.spectrumFrequencies[index]);
+        const double bandBins = std::max(1.0, (hiHz - loHz) / binHz);
+        const float meanPower = float(double(audio_analysis_band_power(analysisData, loHz, hiHz)) * analysis.windowEnbw / bandBins);
+        spectral_power_to_db(&meanPower, &bands[index], 1, ctx.audioAnalysisSettings.audioDecibelRange);
+        loHz = hiHz;
     }
+
+    // Adjust by requested gain
+    bands = bands * ctx.audioAnalysisSettings.spectrumGains;
+
+    // Blend for smoother result
+    analysis.spectrumBands.store(bands * blendFactor + analysis.spectrumBands.load() * (1.0f - blendFactor));
+}
+
+SpectrumPartitionSettings audio_analysis_partition_settings(bool twoSided)
+{
+    auto& ctx = GetAudioContext();
+    const auto& analysisSettings = ctx.audioAnalysisSettings;
+
+    SpectrumPartitionSettings settings;
+    settings.twoSided = twoSided;
+    settings.limit = twoSided ? analysisSettings.frames : (analysisSettings.frames / 2) + 1;
+    settings.n = std::max(std::min(settings.limit, analysisSettings.spectrumBuckets), 4u);
+    settings.scale = SpectrumScale(analysisSettings.spectrumScale);
+    settings.sampleRate = float(ctx.audioDeviceSettings.sampleRate);
+    settings.zoomMinHz = analysisSettings.spectrumZoomMinHz;
+    settings.zoomMaxHz = analysisSettings.spectrumZoomMaxHz;
+    return settings;
+}
+
+bool audio_analysis_is_iq(const ChannelId& id)
+{
+    auto& ctx = GetAudioContext();
+    auto itr = ctx.analysisChannels.find(id);
+    return (itr != ctx.analysisChannels.end()) && itr->second->iq;
 }
 
 uint32_t audio_analysis_read_index(AudioAnalysisData& data)
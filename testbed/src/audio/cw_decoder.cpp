@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <random>
+
+#include <glm/gtc/constants.hpp>
+
+#include <zest/time/profiler.h>
+
+#include <zing/audio/cw_decoder.h>
+#include <zing/audio/polyphase.h>
+
+namespace Zing
+{
+
+namespace
+{
+
+constexpr uint32_t CwMaxSymbol = 256;  // 7 elements; nothing in the table is longer than 6
+constexpr float CwMinWpm = 5.0f;
+constexpr float CwMaxWpm = 60.0f;
+constexpr float CwMinMarkSeconds = 0.004f; // Shorter is a noise spike
+constexpr float CwMaxSnrDb = 60.0f;
+constexpr float CwMinMarkRatio = 2.0f; // Over the noise before anything is keyed; 6dB
+constexpr float CwKeyDownFraction = 0.5f; // Of the way from the noise to the signal
+constexpr float CwKeyUpFraction = 0.3f;
+constexpr float CwDotLearnRate = 0.2f;
+constexpr float CwNoiseFallSeconds = 0.05f;
+constexpr float CwNoiseRiseSeconds = 1.0f;
+constexpr float CwMarkSeconds = 0.01f;
+constexpr float CwMarkDecaySeconds = 2.0f;
+
+struct CwCode
+{
+    char c;
+    const char* pCode;
+};
+
+constexpr CwCode CwCodes[] = {
+    { 'A', ".-" }, { 'B', "-..." }, { 'C', "-.-." }, { 'D', "-.." }, { 'E', "." }, { 'F', "..-." },
+    { 'G', "--." }, { 'H', "...." }, { 'I', ".." }, { 'J', ".---" }, { 'K', "-.-" }, { 'L', ".-.." },
+    { 'M', "--" }, { 'N', "-." }, { 'O', "---" }, { 'P', ".--." }, { 'Q', "--.-" }, { 'R', ".-." },
+    { 'S', "..." }, { 'T', "-" }, { 'U', "..-" }, { 'V', "...-" }, { 'W', ".--" }, { 'X', "-..-" },
+    { 'Y', "-.--" }, { 'Z', "--.." }, { '0', "-----" }, { '1', ".----" }, { '2', "..---" },
+    { '3', "...--" }, { '4', "....-" }, { '5', "....." }, { '6', "-...." }, { '7', "--..." },
+    { '8', "---.." }, { '9', "----." }, { '.', ".-.-.-" }, { ',', "--..--" }, { '?', "..--.." },
+    { '/', "-..-." }, { '=', "-...-" }, { '+', ".-.-." }, { '-', "-....-" }, { '\'', ".----." },
+    { '(', "-.--." }, { ')', "-.--.-" }, { ':', "---..." }, { '@', ".--.-." },
+};
+
+constexpr uint32_t cw_code_symbol(const char* pCode)
+{
+    uint32_t symbol = 1;
+    for (; *pCode; pCode++)
+    {
+        symbol = (symbol * 2) + (*pCode == '-' ? 1 : 0);
+    }
+    return symbol;
+}
+
+constexpr std::array<char, CwMaxSymbol> cw_build_table()
+{
+    std::array<char, CwMaxSymbol> table{};
+    for (const auto& code : CwCodes)
+    {
+        table[cw_code_symbol(code.pCode)] = code.c;
+    }
+    return table;
+}
+
+constexpr auto CwTable = cw_build_table();
+
+const char* cw_char_code(char c)
+{
+    c = char(std::toupper((unsigned char)c));
+    for (const auto& code : CwCodes)
+    {
+        if (code.c == c)
+        {
+            return code.pCode;
+        }
+    }
+    return nullptr;
+}
+
+void cw_decoder_emit(CwDecoder& decoder, char c)
+{
+    cw_text_queue_push(decoder.text, c);
+    decoder.wordEnded = (c == ' ');
+}
+
+float cw_dot_ticks(float tickSeconds, float wpm)
+{
+    // PARIS is 50 dots, so a dot is 1.2s / wpm
+    return (1.2f / wpm) / tickSeconds;
+}
+
+// A mark has ended; sort it and learn the speed from it
+void cw_decoder_mark(CwDecoder& decoder, uint32_t ticks)
+{
+    if (ticks < decoder.minMarkTicks)
+    {
+        return;
+    }
+
+    const float length = float(ticks);
+    if (length < 2.0f * decoder.dotTicks)
+    {
+        decoder.symbol *= 2;
+        decoder.dotTicks += CwDotLearnRate * (length - decoder.dotTicks);
+    }
+    else
+    {
+        decoder.symbol = (decoder.symbol * 2) + 1;
+        decoder.dotTicks += CwDotLearnRate * ((length / 3.0f) - decoder.dotTicks);
+    }
+    decoder.dotTicks = std::clamp(decoder.dotTicks, cw_dot_ticks(decoder.tickSeconds, CwMaxWpm), cw_dot_ticks(decoder.tickSeconds, CwMinWpm));
+    decoder.wpm.store(1.2f / (decoder.dotTicks * decoder.tickSeconds), std::memory_order_relaxed);
+
+    // Too long to be anything; it will come out as unknown
+    if (decoder.symbol >= CwMaxSymbol)
+    {
+        decoder.symbol = CwMaxSymbol;
+    }
+}
+
+void cw_decoder_tick(CwDecoder& decoder, float level, float noiseLevel)
+{
+    // Average over about a third of a dot; as much smoothing as the speed allows
+    decoder.levels[decoder.levelIndex] = level;
+    decoder.levelIndex = (decoder.levelIndex + 1) % CwMaxSmoothTicks;
+    const auto smoothTicks = std::clamp(uint32_t(decoder.dotTicks / 3.0f), 1u, CwMaxSmoothTicks);
+    float sum = 0.0f;
+    for (uint32_t i = 1; i <= smoothTicks; i++)
+    {
+        sum += decoder.levels[(decoder.levelIndex + CwMaxSmoothTicks - i) % CwMaxSmoothTicks];
+    }
+    const float envelope = sum / float(smoothTicks);
+
+    // Nothing to go on until the average is full
+    if (decoder.warmupTicks < CwMaxSmoothTicks)
+    {
+        decoder.warmupTicks++;
+        decoder.noiseLevel = envelope;
+        decoder.markLevel = envelope;
+        return;
+    }
+
+    // The noise is followed between marks and the signal during them; the signal level slowly
+    // falls back towards the noise, so a weaker station can take over. The noise also creeps up
+    // under a long mark, so a steady carrier stops keying.
+    if (decoder.keyDown)
+    {
+        decoder.markLevel += decoder.markRate * (envelope - decoder.markLevel);
+        decoder.noiseLevel += decoder.markDecay * (envelope - decoder.noiseLevel);
+    }
+    else
+    {
+        // Quick to fall and slow to rise, so the start of a mark doesn't drag it up
+        const float noiseRate = envelope < decoder.noiseLevel ? decoder.noiseFall : decoder.noiseRise;
+        decoder.noiseLevel += noiseRate * (envelope - decoder.noiseLevel);
+        decoder.markLevel += decoder.markDecay * (decoder.noiseLevel - decoder.markLevel);
+    }
+    if (noiseLevel > 0.0f)
+    {
+        decoder.noiseLevel = noiseLevel;
+    }
+
+    const float noise = std::max(decoder.noiseLevel, 1e-9f);
+    const float mark = std::max(decoder.markLevel, noise);
+    const float downLevel = std::max(noise * CwMinMarkRatio, noise + (CwKeyDownFraction * (mark - noise)));
+    const float upLevel = noise + (CwKeyUpFraction * (std::max(mark, downLevel) - noise));
+    // Bounded, as the noise can go to nothing on a digitally silent input
+    decoder.snrDb.store(std::min(20.0f * std::log10(mark / noise), CwMaxSnrDb), std::memory_order_relaxed);
+
+    const bool keyDown = decoder.keyDown ? envelope > upLevel : envelope > downLevel;
+    if (keyDown != decoder.keyDown)
+    {
+        if (decoder.keyDown)
+        {
+            cw_decoder_mark(decoder, decoder.runTicks);
+        }
+        decoder.keyDown = keyDown;
+        decoder.runTicks = 0;
+    }
+    decoder.runTicks++;
+
+    // Character and word ends are timeouts on the space, so the text doesn't wait on the next mark
+    if (!decoder.keyDown)
+    {
+        const float space = float(decoder.runTicks);
+        if (decoder.symbol != 1 && space >= 2.0f * decoder.dotTicks)
+        {
+            const char c = cw_symbol_char(decoder.symbol);
+            cw_decoder_emit(decoder, c ? c : '*');
+            decoder.symbol = 1;
+        }
+        else if (!decoder.wordEnded && decoder.symbol == 1 && space >= 5.0f * decoder.dotTicks)
+        {
+            cw_decoder_emit(decoder, ' ');
+        }
+    }
+}
+
+std::string cw_normalize_text(const std::string& text)
+{
+    std::string out;
+    for (auto c : text)
+    {
+        if (std::isspace((unsigned char)c))
+        {
+            if (!out.empty() && out.back() != ' ')
+            {
+                out.push_back(' ');
+            }
+            continue;
+        }
+        out.push_back(char(std::toupper((unsigned char)c)));
+    }
+    if (!out.empty() && out.back() == ' ')
+    {
+        out.pop_back();
+    }
+    return out;
+}
+
+} // namespace
+
+bool cw_text_queue_push(CwTextQueue& queue, char c)
+{
+    const auto write = queue.writeIndex.load(std::memory_order_relaxed);
+    if ((write - queue.readIndex.load(std::memory_order_acquire)) >= CwTextQueueSize)
+    {
+        return false;
+    }
+    queue.text[write & (CwTextQueueSize - 1)] = c;
+    queue.writeIndex.store(write + 1, std::memory_order_release);
+    return true;
+}
+
+uint32_t cw_text_queue_pop(CwTextQueue& queue, char* pOut, uint32_t maxCount)
+{
+    const auto read = queue.readIndex.load(std::memory_order_relaxed);
+    const auto count = std::min(queue.writeIndex.load(std::memory_order_acquire) - read, maxCount);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pOut[i] = queue.text[(read + i) & (CwTextQueueSize - 1)];
+    }
+    queue.readIndex.store(read + count, std::memory_order_release);
+    return count;
+}
+
+char cw_symbol_char(uint32_t symbol)
+{
+    return symbol < CwMaxSymbol ? CwTable[symbol] : 0;
+}
+
+void cw_decoder_init_ticks(CwDecoder& decoder, float tickSeconds, float initialWpm)
+{
+    decoder.tickSeconds = tickSeconds;
+    decoder.sampleRate = 0.0f;
+    decoder.tickSamples = 0;
+
+    decoder.levels.fill(0.0f);
+    decoder.levelIndex = 0;
+    decoder.warmupTicks = 0;
+    decoder.noiseLevel = 0.0f;
+    decoder.markLevel = 0.0f;
+    decoder.noiseFall = 1.0f - std::exp(-tickSeconds / CwNoiseFallSeconds);
+    decoder.noiseRise = 1.0f - std::exp(-tickSeconds / CwNoiseRiseSeconds);
+    decoder.markRate = 1.0f - std::exp(-tickSeconds / CwMarkSeconds);
+    decoder.markDecay = 1.0f - std::exp(-tickSeconds / CwMarkDecaySeconds);
+
+    decoder.keyDown = false;
+    decoder.runTicks = 0;
+    decoder.minMarkTicks = std::max(1u, uint32_t(std::round(CwMinMarkSeconds / tickSeconds)));
+    decoder.dotTicks = cw_dot_ticks(tickSeconds, std::clamp(initialWpm, CwMinWpm, CwMaxWpm));
+    decoder.symbol = 1;
+    decoder.wordEnded = true;
+    decoder.wpm.store(std::clamp(initialWpm, CwMinWpm, CwMaxWpm), std::memory_order_relaxed);
+    decoder.snrDb.store(0.0f, std::memory_order_relaxed);
+}
+
+void cw_decoder_push_level(CwDecoder& decoder, float level, float noiseLevel)
+{
+    cw_decoder_tick(decoder, level, noiseLevel);
+}
+
+void cw_decoder_init(CwDecoder& decoder, float sampleRate, float initialWpm)
+{
+    cw_decoder_init_ticks(decoder, CwTickSeconds, initialWpm);
+
+    decoder.sampleRate = sampleRate;
+    decoder.tickSamples = std::max(1u, uint32_t(std::round(sampleRate * CwTickSeconds)));
+    decoder.tickFill = 0;
+    decoder.accRe = 0.0;
+    decoder.accIm = 0.0;
+    decoder.phasorRe = 1.0;
+    decoder.phasorIm = 0.0;
+
+    // Step depends on the rate
+    const double toneHz = decoder.toneHz;
+    decoder.toneHz = -1.0;
+    cw_decoder_set_tone(decoder, toneHz);
+}
+
+void cw_decoder_set_tone(CwDecoder& decoder, double toneHz)
+{
+    if (toneHz == decoder.toneHz)
+    {
+        return;
+    }
+    decoder.toneHz = toneHz;
+
+    const double omega = 2.0 * glm::pi<double>() * toneHz / std::max(1.0, double(decoder.sampleRate));
+    decoder.stepRe = std::cos(omega);
+    decoder.stepIm = -std::sin(omega);
+}
+
+void cw_decoder_process(CwDecoder& decoder, const float* pSamples, uint32_t count, uint32_t stride)
+{
+    PROFILE_SCOPE(CW_Decode);
+
+    if (decoder.tickSamples == 0)
+    {
+        return;
+    }
+
+    double re = decoder.phasorRe;
+    double im = decoder.phasorIm;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const double sample = pSamples[size_t(i) * stride];
+        decoder.accRe += sample * re;
+        decoder.accIm += sample * im;
+        const double nextRe = (re * decoder.stepRe) - (im * decoder.stepIm);
+        im = (re * decoder.stepIm) + (im * decoder.stepRe);
+        re = nextRe;
+
+        if (++decoder.tickFill == decoder.tickSamples)
+        {
+            normalize_phasor(re, im);
+
+            const float level = float(std::sqrt((decoder.accRe * decoder.accRe) + (decoder.accIm * decoder.accIm)) / double(decoder.tickSamples));
+            decoder.accRe = 0.0;
+            decoder.accIm = 0.0;
+            decoder.tickFill = 0;
+            cw_decoder_tick(decoder, level, 0.0f);
+        }
+    }
+    decoder.phasorRe = re;
+    decoder.phasorIm = im;
+}
+
+std::vector<float> cw_synthesize(const std::string& text, float wpm, double toneHz, float sampleRate, float snrDb, uint32_t seed)
+{
+    const auto dotSamples = uint32_t(sampleRate * 1.2f / std::max(wpm, 1.0f));
+    const auto edgeSamples = std::max(1u, uint32_t(sampleRate * 0.005f));
+
+    // Key on/off runs, in dots; half a second of silence either side
+    std::vector<std::pair<bool, uint32_t>> runs;
+    const auto leadDots = uint32_t(0.5f * sampleRate / float(std::max(1u, dotSamples))) + 1;
+    runs.push_back({ false, leadDots });
+    for (auto c : text)
+    {
+        if (c == ' ')
+        {
+            // A word gap is 7; the character gap before it already gave 3
+            runs.push_back({ false, 4 });
+            continue;
+        }
+
+        const char* pCode = cw_char_code(c);
+        if (!pCode)
+        {
+            continue;
+        }
+        for (const char* p = pCode; *p; p++)
+        {
+            runs.push_back({ true, *p == '-' ? 3u : 1u });
+            runs.push_back({ false, p[1] ? 1u : 3u });
+        }
+    }
+    runs.push_back({ false, leadDots });
+
+    size_t total = 0;
+    for (auto& run : runs)
+    {
+        total += size_t(run.second) * dotSamples;
+    }
+
+    // Keying envelope, with raised cosine edges inside each mark
+    std::vector<float> out(total, 0.0f);
+    size_t pos = 0;
+    for (auto& run : runs)
+    {
+        const size_t length = size_t(run.second) * dotSamples;
+        if (run.first)
+        {
+            const auto edge = std::min<size_t>(edgeSamples, length / 2);
+            for (size_t i = 0; i < length; i++)
+            {
+                float gain = 1.0f;
+                const size_t fromEdge = std::min(i, length - 1 - i);
+                if (fromEdge < edge)
+                {
+                    gain = 0.5f * (1.0f - std::cos(glm::pi<float>() * float(fromEdge) / float(edge)));
+                }
+                out[pos + i] = gain;
+            }
+        }
+        pos += length;
+    }
+
+    constexpr float amplitude = 0.5f;
+    const float noiseSigma = amplitude / std::sqrt(2.0f * std::pow(10.0f, snrDb / 10.0f));
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, noiseSigma);
+    const double omega = 2.0 * glm::pi<double>() * toneHz / double(sampleRate);
+    for (size_t i = 0; i < total; i++)
+    {
+        out[i] = (out[i] * amplitude * float(std::sin(omega * double(i)))) + noise(rng);
+    }
+    return out;
+}
+
+double cw_character_error_rate(const std::string& decoded, const std::string& reference)
+{
+    const auto a = cw_normalize_text(decoded);
+    const auto b = cw_normalize_text(reference);
+    if (b.empty())
+    {
+        return a.empty() ? 0.0 : 1.0;
+    }
+
+    // Levenshtein, a row at a time
+    std::vector<uint32_t> prev(b.size() + 1);
+    std::vector<uint32_t> row(b.size() + 1);
+    for (uint32_t j = 0; j <= b.size(); j++)
+    {
+        prev[j] = j;
+    }
+    for (uint32_t i = 1; i <= a.size(); i++)
+    {
+        row[0] = i;
+        for (uint32_t j = 1; j <= b.size(); j++)
+        {
+            const uint32_t substitute = prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+            row[j] = std::min({ prev[j] + 1, row[j - 1] + 1, substitute });
+        }
+        std::swap(prev, row);
+    }
+    return double(prev[b.size()]) / double(b.size());
+}
+
+} // namespace Zing
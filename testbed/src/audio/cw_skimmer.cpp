@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include <zest/time/profiler.h>
+
+#include <zing/audio/cw_skimmer.h>
+
+namespace Zing
+{
+
+namespace
+{
+
+constexpr uint32_t CwSkimmerTrackBins = 1;   // Either side of the track's bin, for the main lobe
+constexpr uint32_t CwSkimmerClusterBins = 3; // A peak this close to a track is part of it
+constexpr float CwSkimmerIdleSeconds = 10.0f;
+constexpr float CwSkimmerProbationSeconds = 2.0f; // To collect enough peaks, or be retired
+constexpr uint32_t CwSkimmerMinPeakHits = 4;
+constexpr uint32_t CwSkimmerParallelMinTracks = 16;
+
+bool cw_is_callsign(const std::string& word)
+{
+    if (word.size() < 3 || word.size() > 8)
+    {
+        return false;
+    }
+
+    size_t digit = std::string::npos;
+    for (size_t i = 0; i < word.size(); i++)
+    {
+        if (!std::isalnum((unsigned char)word[i]))
+        {
+            return false;
+        }
+        if (std::isdigit((unsigned char)word[i]))
+        {
+            digit = i;
+        }
+    }
+
+    if (digit == std::string::npos || digit < 1 || digit > 3)
+    {
+        return false;
+    }
+    const auto suffix = word.size() - digit - 1;
+    if (suffix < 1 || suffix > 4)
+    {
+        return false;
+    }
+    return std::any_of(word.begin(), word.begin() + digit, [](char c) {
+        return std::isalpha((unsigned char)c) != 0;
+    });
+}
+
+void cw_skimmer_start_track(CwSkimmer& skimmer, CwSkimmerTrack& track, uint32_t bin)
+{
+    track.active = true;
+    track.bin = bin;
+    track.ageTicks = 0;
+    track.idleTicks = 0;
+    track.peakHits = 1;
+    track.text.clear();
+    cw_decoder_init_ticks(track.decoder, skimmer.settings.tickSeconds, skimmer.settings.initialWpm);
+
+    // Anything left from the last signal on this slot
+    char discard[64];
+    while (cw_text_queue_pop(track.decoder.text, discard, uint32_t(sizeof(discard))) > 0)
+    {
+    }
+}
+
+// One tick of one track; tracks only touch their own state, so any number can run at once
+void cw_skimmer_track_tick(CwSkimmerTrack& track, const float* pPower, const float* pNoise, uint32_t bins)
+{
+    const uint32_t first = track.bin - std::min(track.bin, CwSkimmerTrackBins);
+    const uint32_t last = std::min(track.bin + CwSkimmerTrackBins, bins - 1);
+    float power = 0.0f;
+    float noise = 0.0f;
+    for (uint32_t bin = first; bin <= last; bin++)
+    {
+        power += pPower[bin];
+        noise += pNoise[bin];
+    }
+    cw_decoder_push_level(track.decoder, std::sqrt(power), std::sqrt(noise));
+    track.ageTicks++;
+
+    char chars[CwSkimmerTextSize];
+    const auto count = cw_text_queue_pop(track.decoder.text, chars, CwSkimmerTextSize);
+    track.text.append(chars, count);
+    if (track.text.size() > CwSkimmerTextSize)
+    {
+        track.text.erase(0, track.text.size() - CwSkimmerTextSize);
+    }
+}
+
+} // namespace
+
+void cw_skimmer_reset(CwSkimmer& skimmer)
+{
+    for (auto& track : skimmer.tracks)
+    {
+        track.active = false;
+    }
+    skimmer.activeList.clear();
+}
+
+void cw_skimmer_update(CwSkimmer& skimmer, const CwSkimmerSettings& settings, const float* pPower, const float* pNoise, uint32_t bins, const uint32_t* pCandidates, uint32_t candidateCount, const FftParallelFor& parallelFor)
+{
+    PROFILE_SCOPE(CW_Skimmer);
+
+    // The decoders count in ticks, and the tracks in bins; either changing starts over
+    if (bins != skimmer.bins || settings.tickSeconds != skimmer.settings.tickSeconds || settings.binHz != skimmer.settings.binHz)
+    {
+        cw_skimmer_reset(skimmer);
+        skimmer.bins = bins;
+    }
+    skimmer.settings = settings;
+    if (bins == 0 || settings.tickSeconds <= 0.0f)
+    {
+        return;
+    }
+
+    const uint32_t maxTracks = std::min(settings.maxTracks, CwSkimmerMaxTracks);
+    const auto idleLimit = uint32_t(CwSkimmerIdleSeconds / settings.tickSeconds);
+    const auto probationLimit = uint32_t(CwSkimmerProbationSeconds / settings.tickSeconds);
+
+    // Retire the quiet ones first, so their slots can be taken this spectrum
+    for (uint32_t index = 0; index < CwSkimmerMaxTracks; index++)
+    {
+        auto& track = skimmer.tracks[index];
+        if (!track.active)
+        {
+            continue;
+        }
+        if (index >= maxTracks || track.idleTicks > idleLimit || (track.peakHits < CwSkimmerMinPeakHits && track.ageTicks > probationLimit))
+        {
+            track.active = false;
+        }
+        track.idleTicks++;
+    }
+
+    // Peaks join the track they are close to, following its drift, or start a new one
+    const float seedSnr = std::pow(10.0f, settings.seedSnrDb / 10.0f);
+    for (uint32_t candidate = 0; candidate < candidateCount; candidate++)
+    {
+        const auto bin = pCandidates[candidate];
+        if (bin >= bins || pPower[bin] <= pNoise[bin] * seedSnr)
+        {
+            continue;
+        }
+
+        CwSkimmerTrack* pFree = nullptr;
+        bool joined = false;
+        for (uint32_t index = 0; index < maxTracks; index++)
+        {
+            auto& track = skimmer.tracks[index];
+            if (!track.active)
+            {
+                pFree = pFree ? pFree : &track;
+                continue;
+            }
+            const auto distance = std::max(bin, track.bin) - std::min(bin, track.bin);
+            if (distance <= CwSkimmerClusterBins)
+            {
+                if (distance == 1 && pPower[bin] > pPower[track.bin])
+                {
+                    track.bin = bin;
+                }
+                if (track.idleTicks > 0)
+                {
+                    track.peakHits++;
+                    track.idleTicks = 0;
+                }
+                joined = true;
+                break;
+            }
+        }
+
+        if (!joined && pFree)
+        {
+            cw_skimmer_start_track(skimmer, *pFree, bin);
+        }
+    }
+
+    skimmer.activeList.clear();
+    for (uint32_t index = 0; index < maxTracks; index++)
+    {
+        if (skimmer.tracks[index].active)
+        {
+            skimmer.activeList.push_back(index);
+        }
+    }
+
+    auto decode = [&skimmer, pPower, pNoise, bins](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            cw_skimmer_track_tick(skimmer.tracks[skimmer.activeList[i]], pPower, pNoise, bins);
+        }
+    };
+
+    const auto activeCount = uint32_t(skimmer.activeList.size());
+    if (parallelFor && activeCount >= CwSkimmerParallelMinTracks)
+    {
+        parallelFor(activeCount, decode);
+    }
+    else
+    {
+        decode(0, activeCount);
+    }
+}
+
+void cw_skimmer_spots(const CwSkimmer& skimmer, std::vector<CwSpot>& spots)
+{
+    spots.clear();
+    for (auto index : skimmer.activeList)
+    {
+        const auto& track = skimmer.tracks[index];
+        if (track.peakHits < CwSkimmerMinPeakHits || track.text.find_first_not_of(' ') == std::string::npos)
+        {
+            continue;
+        }
+
+        CwSpot spot;
+        spot.hz = skimmer.settings.minHz + (double(track.bin) * skimmer.settings.binHz);
+        spot.wpm = track.decoder.wpm.load(std::memory_order_relaxed);
+        spot.snrDb = track.decoder.snrDb.load(std::memory_order_relaxed);
+        spot.seconds = float(track.ageTicks) * skimmer.settings.tickSeconds;
+        spot.callsign = cw_find_callsign(track.text);
+        spot.text = track.text;
+        spots.push_back(std::move(spot));
+    }
+
+    std::sort(spots.begin(), spots.end(), [](const CwSpot& a, const CwSpot& b) {
+        return a.hz < b.hz;
+    });
+}
+
+std::string cw_find_callsign(const std::string& text)
+{
+    std::string last;
+    std::string afterDe;
+    std::string previous;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        const auto end = std::min(text.find(' ', start), text.size());
+        std::string word = text.substr(start, end - start);
+        start = end + 1;
+        if (word.empty())
+        {
+            continue;
+        }
+
+        std::transform(word.begin(), word.end(), word.begin(), [](char c) {
+            return char(std::toupper((unsigned char)c));
+        });
+        if (cw_is_callsign(word))
+        {
+            last = word;
+            if (previous == "DE")
+            {
+                afterDe = word;
+            }
+        }
+        previous = std::move(word);
+    }
+    return afterDe.empty() ? last : afterDe;
+}
+
+} // namespace Zing
@@ -2,6 +2,7 @@
 #include <zing/pch.h>
 
 #include <zing/audio/audio.h>
+#include <zing/audio/audio_analysis.h>
 #include <zing/audio/waterfall.h>
 
 using namespace Zing;
@@ -13,6 +14,10 @@ void draw_waterfall()
     auto& ctx = GetAudioContext();
     auto& wf = Waterfall_Get();
 
+    // The zoom analysis follows the marker
+    const bool twoSided = audio_analysis_is_iq(audio_to_channel_id(Channel_In, 0));
+    ctx.analysisZoomCenterHz = spectrum_partition_hz_at(audio_analysis_partition_settings(twoSided), wf.markerX);
+
     for (auto [Id, pAnalysis] : ctx.analysisChannels)
     {
         if (Id.first != Channel_In || Id.second != 0)
@@ -30,19 +35,25 @@ void draw_waterfall()
         if (!spectrumBuckets.empty())
         {
             auto bucketCount = spectrumBuckets.size();
-            auto sampleCount = ctx.audioDeviceSettings.sampleRate * 0.5f;
-            sampleCount /= float(spectrumBuckets.size());
+            const auto partition = audio_analysis_partition_settings(twoSided);
 
+            // History drawn against a different scale is meaningless, so start again
+            static SpectrumPartitionSettings lastPartition;
             auto fallRows = 50;
             if (wf.bins != int(bucketCount))
             {
                 Waterfall_Init(wf, int(bucketCount), fallRows);
             }
+            else if (!(lastPartition == partition))
+            {
+                Waterfall_Reset(wf);
+            }
+            lastPartition = partition;
 
 
-            Waterfall_AccumulateMag(wf, spectrumBuckets.data(), int(bucketCount));
+            Waterfall_AccumulateMag(wf, spectrumBuckets.data(), int(bucketCount), pAnalysis->uiDataCache->noiseFloorLevel);
 
-            Waterfall_DrawPlot(wf, "Waterfall", float(bucketCount * sampleCount), ImVec2(-1, float(fallRows * 10)));
+            Waterfall_DrawPlot(wf, "Waterfall", partition, ImVec2(-1, float(fallRows * 10)));
         }
     }
 }
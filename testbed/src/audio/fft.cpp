@@ -0,0 +1,672 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <tuple>
+
+#include <glm/gtc/constants.hpp>
+
+#include <zing/audio/fft.h>
+#include <zing/audio/rt_check.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define ZING_FFT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ZING_FFT_NEON 1
+#endif
+
+namespace Zing
+{
+
+namespace
+{
+
+using FftPlanKey = std::tuple<FftBackend, uint32_t, FftKind, FftDirection>;
+
+struct FftCache
+{
+    std::mutex mutex;
+    std::map<FftPlanKey, std::unique_ptr<FftPlan>> plans;
+};
+
+FftCache& fft_cache()
+{
+    static FftCache cache;
+    return cache;
+}
+
+std::atomic<FftBackend> activeBackend = FftBackend::SplitRadix;
+
+bool fft_is_pow2(uint32_t size)
+{
+    return size != 0 && (size & (size - 1)) == 0;
+}
+
+uint32_t fft_log2(uint32_t size)
+{
+    uint32_t bits = 0;
+    while ((1u << bits) < size)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+// Split radix ===========================================================================
+
+void split_radix_build(FftPlan& plan)
+{
+    const double sign = plan.direction == FftDirection::Forward ? -1.0 : 1.0;
+    const uint32_t levels = fft_log2(plan.size);
+
+    plan.levelOffsets.assign(levels + 1, 0);
+    plan.twiddles.clear();
+    for (uint32_t level = 3; level <= levels; level++)
+    {
+        const uint32_t n = 1u << level;
+        const uint32_t q = n / 4;
+        plan.levelOffsets[level] = uint32_t(plan.twiddles.size());
+
+        // [w1 re, re][w1 -im, im][w3 re, re][w3 -im, im]
+        std::vector<float> block(8 * q);
+        for (uint32_t k = 0; k < q; k++)
+        {
+            const double phase1 = sign * 2.0 * glm::pi<double>() * double(k) / double(n);
+            const double phase3 = 3.0 * phase1;
+            const float w1r = float(std::cos(phase1));
+            const float w1i = float(std::sin(phase1));
+            const float w3r = float(std::cos(phase3));
+            const float w3i = float(std::sin(phase3));
+            block[(2 * k)] = w1r;
+            block[(2 * k) + 1] = w1r;
+            block[(2 * q) + (2 * k)] = -w1i;
+            block[(2 * q) + (2 * k) + 1] = w1i;
+            block[(4 * q) + (2 * k)] = w3r;
+            block[(4 * q) + (2 * k) + 1] = w3r;
+            block[(6 * q) + (2 * k)] = -w3i;
+            block[(6 * q) + (2 * k) + 1] = w3i;
+        }
+        plan.twiddles.insert(plan.twiddles.end(), block.begin(), block.end());
+    }
+}
+
+// Combine one level in place:
+// out[0, n/2) = U (even samples), out[n/2, 3n/4) = Z (4m+1), out[3n/4, n) = Z' (4m+3)
+void split_radix_combine(FftComplex* out, uint32_t n, const float* tw, bool inverse)
+{
+    const uint32_t q = n / 4;
+    float* pU0 = &out[0].r;
+    float* pU1 = &out[q].r;
+    float* pZ1 = &out[2 * q].r;
+    float* pZ3 = &out[3 * q].r;
+    const float* w1r = tw;
+    const float* w1i = tw + (2 * q);
+    const float* w3r = tw + (4 * q);
+    const float* w3i = tw + (6 * q);
+
+#if defined(ZING_FFT_SSE2)
+    // -i * d for forward, +i * d for inverse, after swapping re/im
+    const __m128 rot = inverse ? _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f) : _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+    for (uint32_t k = 0; k < 2 * q; k += 4)
+    {
+        const __m128 z1 = _mm_loadu_ps(pZ1 + k);
+        const __m128 z3 = _mm_loadu_ps(pZ3 + k);
+        const __m128 a = _mm_add_ps(_mm_mul_ps(z1, _mm_loadu_ps(w1r + k)), _mm_mul_ps(_mm_shuffle_ps(z1, z1, _MM_SHUFFLE(2, 3, 0, 1)), _mm_loadu_ps(w1i + k)));
+        const __m128 b = _mm_add_ps(_mm_mul_ps(z3, _mm_loadu_ps(w3r + k)), _mm_mul_ps(_mm_shuffle_ps(z3, z3, _MM_SHUFFLE(2, 3, 0, 1)), _mm_loadu_ps(w3i + k)));
+        const __m128 s = _mm_add_ps(a, b);
+        const __m128 d = _mm_sub_ps(a, b);
+        const __m128 jd = _mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)), rot);
+        const __m128 u0 = _mm_loadu_ps(pU0 + k);
+        const __m128 u1 = _mm_loadu_ps(pU1 + k);
+        _mm_storeu_ps(pU0 + k, _mm_add_ps(u0, s));
+        _mm_storeu_ps(pZ1 + k, _mm_sub_ps(u0, s));
+        _mm_storeu_ps(pU1 + k, _mm_add_ps(u1, jd));
+        _mm_storeu_ps(pZ3 + k, _mm_sub_ps(u1, jd));
+    }
+#elif defined(ZING_FFT_NEON)
+    static const float rotForward[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+    static const float rotInverse[4] = { -1.0f, 1.0f, -1.0f, 1.0f };
+    const float32x4_t rot = vld1q_f32(inverse ? rotInverse : rotForward);
+    for (uint32_t k = 0; k < 2 * q; k += 4)
+    {
+        const float32x4_t z1 = vld1q_f32(pZ1 + k);
+        const float32x4_t z3 = vld1q_f32(pZ3 + k);
+        const float32x4_t a = vmlaq_f32(vmulq_f32(z1, vld1q_f32(w1r + k)), vrev64q_f32(z1), vld1q_f32(w1i + k));
+        const float32x4_t b = vmlaq_f32(vmulq_f32(z3, vld1q_f32(w3r + k)), vrev64q_f32(z3), vld1q_f32(w3i + k));
+        const float32x4_t s = vaddq_f32(a, b);
+        const float32x4_t d = vsubq_f32(a, b);
+        const float32x4_t jd = vmulq_f32(vrev64q_f32(d), rot);
+        const float32x4_t u0 = vld1q_f32(pU0 + k);
+        const float32x4_t u1 = vld1q_f32(pU1 + k);
+        vst1q_f32(pU0 + k, vaddq_f32(u0, s));
+        vst1q_f32(pZ1 + k, vsubq_f32(u0, s));
+        vst1q_f32(pU1 + k, vaddq_f32(u1, jd));
+        vst1q_f32(pZ3 + k, vsubq_f32(u1, jd));
+    }
+#else
+    const float rotSign = inverse ? -1.0f : 1.0f;
+    for (uint32_t k = 0; k < 2 * q; k += 2)
+    {
+        const float z1r = pZ1[k];
+        const float z1i = pZ1[k + 1];
+        const float z3r = pZ3[k];
+        const float z3i = pZ3[k + 1];
+        const float ar = (z1r * w1r[k]) + (z1i * w1i[k]);
+        const float ai = (z1i * w1r[k]) + (z1r * w1i[k + 1]);
+        const float br = (z3r * w3r[k]) + (z3i * w3i[k]);
+        const float bi = (z3i * w3r[k]) + (z3r * w3i[k + 1]);
+        const float sr = ar + br;
+        const float si = ai + bi;
+        const float jdr = rotSign * (ai - bi);
+        const float jdi = -rotSign * (ar - br);
+        const float u0r = pU0[k];
+        const float u0i = pU0[k + 1];
+        const float u1r = pU1[k];
+        const float u1i = pU1[k + 1];
+        pU0[k] = u0r + sr;
+        pU0[k + 1] = u0i + si;
+        pZ1[k] = u0r - sr;
+        pZ1[k + 1] = u0i - si;
+        pU1[k] = u1r + jdr;
+        pU1[k + 1] = u1i + jdi;
+        pZ3[k] = u1r - jdr;
+        pZ3[k + 1] = u1i - jdi;
+    }
+#endif
+}
+
+void split_radix_recurse(const FftPlan& plan, const FftComplex* in, FftComplex* out, uint32_t n, uint32_t level, uint32_t stride)
+{
+    const bool inverse = plan.direction == FftDirection::Inverse;
+    switch (n)
+    {
+        case 1:
+            out[0] = in[0];
+            return;
+        case 2:
+        {
+            const auto x0 = in[0];
+            const auto x1 = in[stride];
+            out[0] = FftComplex{ x0.r + x1.r, x0.i + x1.i };
+            out[1] = FftComplex{ x0.r - x1.r, x0.i - x1.i };
+            return;
+        }
+        case 4:
+        {
+            const auto x0 = in[0];
+            const auto x1 = in[stride];
+            const auto x2 = in[2 * stride];
+            const auto x3 = in[3 * stride];
+            const FftComplex t0{ x0.r + x2.r, x0.i + x2.i };
+            const FftComplex t1{ x0.r - x2.r, x0.i - x2.i };
+            const FftComplex t2{ x1.r + x3.r, x1.i + x3.i };
+            // -i * (x1 - x3) forward, +i inverse
+            const float rotSign = inverse ? -1.0f : 1.0f;
+            const FftComplex t3{ rotSign * (x1.i - x3.i), -rotSign * (x1.r - x3.r) };
+            out[0] = FftComplex{ t0.r + t2.r, t0.i + t2.i };
+            out[2] = FftComplex{ t0.r - t2.r, t0.i - t2.i };
+            out[1] = FftComplex{ t1.r + t3.r, t1.i + t3.i };
+            out[3] = FftComplex{ t1.r - t3.r, t1.i - t3.i };
+            return;
+        }
+        default:
+            break;
+    }
+
+    const uint32_t q = n / 4;
+    split_radix_recurse(plan, in, out, n / 2, level - 1, stride * 2);
+    split_radix_recurse(plan, in + stride, out + (2 * q), q, level - 2, stride * 4);
+    split_radix_recurse(plan, in + (3 * stride), out + (3 * q), q, level - 2, stride * 4);
+    split_radix_combine(out, n, plan.twiddles.data() + plan.levelOffsets[level], inverse);
+}
+
+// Six step ===============================================================================
+
+// Columns gathered together, so the strided side of the transpose reads a cache line at a time
+constexpr uint32_t SixStepBatch = 8;
+
+// Small transform of in[0], in[stride], in[2 * stride]...
+void fft_complex_strided(const FftPlan* plan, const FftComplex* in, uint32_t stride, FftComplex* out)
+{
+    if (plan->backend == FftBackend::SplitRadix)
+    {
+        split_radix_recurse(*plan, in, out, plan->size, fft_log2(plan->size), stride);
+    }
+    else
+    {
+        kiss_fft_stride(plan->kissCfg, in, out, int(stride));
+    }
+}
+
+void six_step_run(uint32_t count, const FftParallelFor& parallelFor, const FftParallelRange& fn)
+{
+    if (parallelFor)
+    {
+        parallelFor(count, fn);
+    }
+    else
+    {
+        fn(0, count);
+    }
+}
+
+// size = rows * cols, with input index r + rows * c and output index k + cols * k1.
+// Pass 1: for each row r, a cols point FFT over c, times w^(r * k).
+// Pass 2: for each column k, a rows point FFT over r.
+void six_step_execute(const FftPlan& plan, const FftComplex* in, FftComplex* out, const FftParallelFor& parallelFor)
+{
+    const uint32_t rows = plan.rows;
+    const uint32_t cols = plan.cols;
+
+    // Lives on the calling thread; helpers only write through the pointer
+    thread_local std::vector<FftComplex> work;
+    if (work.size() < plan.size)
+    {
+        work.resize(plan.size);
+    }
+    FftComplex* pWork = work.data();
+
+    // Consecutive rows read neighbouring samples, so the strided reads mostly hit the cache
+    six_step_run(rows, parallelFor, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t r = begin; r < end; r++)
+        {
+            FftComplex* pRow = pWork + (r * cols);
+            fft_complex_strided(plan.rowPlan, in + r, rows, pRow);
+
+            const FftComplex* pTwiddle = &plan.sixStepTwiddles[r * cols];
+            for (uint32_t k = 0; k < cols; k++)
+            {
+                const auto v = pRow[k];
+                const auto w = pTwiddle[k];
+                pRow[k] = FftComplex{ (v.r * w.r) - (v.i * w.i), (v.r * w.i) + (v.i * w.r) };
+            }
+        }
+    });
+
+    six_step_run(cols, parallelFor, [&](uint32_t begin, uint32_t end) {
+        thread_local std::vector<FftComplex> gather;
+        thread_local std::vector<FftComplex> result;
+        if (gather.size() < SixStepBatch * rows)
+        {
+            gather.resize(SixStepBatch * rows);
+            result.resize(SixStepBatch * rows);
+        }
+
+        for (uint32_t k0 = begin; k0 < end; k0 += SixStepBatch)
+        {
+            const uint32_t batch = std::min(SixStepBatch, end - k0);
+            for (uint32_t r = 0; r < rows; r++)
+            {
+                const FftComplex* pIn = pWork + (r * cols) + k0;
+                for (uint32_t b = 0; b < batch; b++)
+                {
+                    gather[(b * rows) + r] = pIn[b];
+                }
+            }
+
+            for (uint32_t b = 0; b < batch; b++)
+            {
+                fft_complex(plan.colPlan, &gather[b * rows], &result[b * rows]);
+            }
+
+            for (uint32_t k1 = 0; k1 < rows; k1++)
+            {
+                FftComplex* pOut = out + k0 + (cols * k1);
+                for (uint32_t b = 0; b < batch; b++)
+                {
+                    pOut[b] = result[(b * rows) + k1];
+                }
+            }
+        }
+    });
+}
+
+// Plans ==================================================================================
+
+FftPlan* fft_plan_locked(FftCache& cache, FftBackend backend, uint32_t size, FftKind kind, FftDirection direction)
+{
+    if (!fft_backend_supports(backend, size))
+    {
+        backend = FftBackend::Kiss;
+    }
+
+    const auto key = FftPlanKey(backend, size, kind, direction);
+    auto itr = cache.plans.find(key);
+    if (itr != cache.plans.end())
+    {
+        return itr->second.get();
+    }
+
+    auto spPlan = std::make_unique<FftPlan>();
+    spPlan->backend = backend;
+    spPlan->kind = kind;
+    spPlan->direction = direction;
+    spPlan->size = size;
+
+    if (kind == FftKind::Real)
+    {
+        // Real of size N == complex of N/2 over the even/odd samples, plus a twiddle pass
+        const uint32_t half = size / 2;
+        spPlan->half = fft_plan_locked(cache, backend, half, FftKind::Complex, direction);
+        spPlan->realTwiddles.resize((half / 2) + 1);
+        for (uint32_t k = 0; k < spPlan->realTwiddles.size(); k++)
+        {
+            const double phase = -2.0 * glm::pi<double>() * double(k) / double(size);
+            spPlan->realTwiddles[k] = FftComplex{ float(std::cos(phase)), float(std::sin(phase)) };
+        }
+    }
+    else
+    {
+        if (backend == FftBackend::SplitRadix)
+        {
+            split_radix_build(*spPlan);
+        }
+        else
+        {
+            spPlan->kissCfg = kiss_fft_alloc(int(size), direction == FftDirection::Inverse ? 1 : 0, nullptr, nullptr);
+        }
+
+        // Large plans can also run as a six step, when there are threads to share it with
+        if (fft_is_pow2(size) && size >= FftSixStepMinSize)
+        {
+            // Square as possible; the extra factor of 2 goes to the row length
+            spPlan->rows = 1u << (fft_log2(size) / 2);
+            spPlan->cols = size / spPlan->rows;
+            spPlan->rowPlan = fft_plan_locked(cache, backend, spPlan->cols, FftKind::Complex, direction);
+            spPlan->colPlan = fft_plan_locked(cache, backend, spPlan->rows, FftKind::Complex, direction);
+
+            const double sign = (direction == FftDirection::Inverse) ? 1.0 : -1.0;
+            spPlan->sixStepTwiddles.resize(size);
+            for (uint32_t r = 0; r < spPlan->rows; r++)
+            {
+                for (uint32_t k = 0; k < spPlan->cols; k++)
+                {
+                    const double phase = sign * 2.0 * glm::pi<double>() * double(uint64_t(r) * k) / double(size);
+                    spPlan->sixStepTwiddles[(r * spPlan->cols) + k] = FftComplex{ float(std::cos(phase)), float(std::sin(phase)) };
+                }
+            }
+        }
+    }
+
+    auto pPlan = spPlan.get();
+    cache.plans[key] = std::move(spPlan);
+    return pPlan;
+}
+
+} // namespace
+
+void fft_set_backend(FftBackend backend)
+{
+    if (backend >= FftBackend::Count)
+    {
+        backend = FftBackend::Kiss;
+    }
+    activeBackend.store(backend);
+}
+
+FftBackend fft_get_backend()
+{
+    return activeBackend.load();
+}
+
+const char* fft_backend_name(FftBackend backend)
+{
+    switch (backend)
+    {
+        case FftBackend::Kiss:
+            return "KissFFT";
+        case FftBackend::SplitRadix:
+#if defined(ZING_FFT_SSE2)
+            return "Split Radix (SSE2)";
+#elif defined(ZING_FFT_NEON)
+            return "Split Radix (NEON)";
+#else
+            return "Split Radix";
+#endif
+        default:
+            return "Unknown";
+    }
+}
+
+bool fft_backend_supports(FftBackend backend, uint32_t size)
+{
+    switch (backend)
+    {
+        case FftBackend::Kiss:
+            return size > 0;
+        case FftBackend::SplitRadix:
+            return fft_is_pow2(size);
+        default:
+            return false;
+    }
+}
+
+const FftPlan* fft_plan(uint32_t size, FftKind kind, FftDirection direction)
+{
+    return fft_plan(fft_get_backend(), size, kind, direction);
+}
+
+const FftPlan* fft_plan(FftBackend backend, uint32_t size, FftKind kind, FftDirection direction)
+{
+    if (size == 0 || (kind == FftKind::Real && (size % 2) != 0))
+    {
+        return nullptr;
+    }
+
+    // Plans are meant to be fetched up front; from the audio callback this can wait on a build
+    RT_CHECK_BLOCKING(FftPlanCache);
+
+    auto& cache = fft_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return fft_plan_locked(cache, backend, size, kind, direction);
+}
+
+void fft_plan_update(const FftPlan*& plan, uint32_t size, FftKind kind, FftDirection direction)
+{
+    const auto backend = fft_get_backend();
+    if (plan && plan->size == size && plan->kind == kind && plan->direction == direction)
+    {
+        // Plans which had to fall back stay put
+        if (plan->backend == backend || !fft_backend_supports(backend, size))
+        {
+            return;
+        }
+    }
+    plan = fft_plan(backend, size, kind, direction);
+}
+
+void fft_destroy_all()
+{
+    auto& cache = fft_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (auto& [key, spPlan] : cache.plans)
+    {
+        if (spPlan->kissCfg)
+        {
+            kiss_fft_free(spPlan->kissCfg);
+            spPlan->kissCfg = nullptr;
+        }
+    }
+    cache.plans.clear();
+}
+
+void fft_complex(const FftPlan* plan, const FftComplex* in, FftComplex* out)
+{
+    fft_complex(plan, in, out, FftParallelFor());
+}
+
+void fft_complex(const FftPlan* plan, const FftComplex* in, FftComplex* out, const FftParallelFor& parallelFor)
+{
+    assert(plan && plan->kind == FftKind::Complex);
+    assert(in != out);
+
+    if (plan->rowPlan && parallelFor)
+    {
+        six_step_execute(*plan, in, out, parallelFor);
+    }
+    else if (plan->backend == FftBackend::SplitRadix)
+    {
+        split_radix_recurse(*plan, in, out, plan->size, fft_log2(plan->size), 1);
+    }
+    else
+    {
+        kiss_fft(plan->kissCfg, in, out);
+    }
+}
+
+void fft_real_forward(const FftPlan* plan, const float* in, FftComplex* out)
+{
+    fft_real_forward(plan, in, out, FftParallelFor());
+}
+
+void fft_real_forward(const FftPlan* plan, const float* in, FftComplex* out, const FftParallelFor& parallelFor)
+{
+    assert(plan && plan->kind == FftKind::Real && plan->direction == FftDirection::Forward);
+
+    // Treat the input as N/2 complex samples: z[n] = x[2n] + i x[2n + 1]
+    const uint32_t half = plan->size / 2;
+    fft_complex(plan->half, (const FftComplex*)in, out, parallelFor);
+
+    // Split Z into the even/odd spectra and merge; pairs (k, N/2 - k) are done together so this works in place
+    const auto z0 = out[0];
+    out[0] = FftComplex{ z0.r + z0.i, 0.0f };
+    out[half] = FftComplex{ z0.r - z0.i, 0.0f };
+
+    for (uint32_t k = 1; k <= half / 2; k++)
+    {
+        const auto zk = out[k];
+        const auto zmk = out[half - k];
+        const auto w = plan->realTwiddles[k];
+
+        const float evenR = 0.5f * (zk.r + zmk.r);
+        const float evenI = 0.5f * (zk.i - zmk.i);
+        const float oddR = 0.5f * (zk.i + zmk.i);
+        const float oddI = -0.5f * (zk.r - zmk.r);
+
+        const float tr = (w.r * oddR) - (w.i * oddI);
+        const float ti = (w.r * oddI) + (w.i * oddR);
+
+        out[half - k] = FftComplex{ evenR - tr, -(evenI - ti) };
+        out[k] = FftComplex{ evenR + tr, evenI + ti };
+    }
+}
+
+void fft_real_inverse(const FftPlan* plan, const FftComplex* in, float* out)
+{
+    assert(plan);
+
+    // Thread local so shared plans stay immutable; only grows
+    thread_local std::vector<FftComplex> scratch;
+    if (scratch.size() < plan->size / 2)
+    {
+        scratch.resize(plan->size / 2);
+    }
+    fft_real_inverse(plan, in, out, scratch.data());
+}
+
+void fft_real_inverse(const FftPlan* plan, const FftComplex* in, float* out, FftComplex* pScratch)
+{
+    assert(plan && plan->kind == FftKind::Real && plan->direction == FftDirection::Inverse);
+
+    const uint32_t half = plan->size / 2;
+
+    pScratch[0] = FftComplex{ in[0].r + in[half].r, in[0].r - in[half].r };
+    for (uint32_t k = 1; k <= half / 2; k++)
+    {
+        const auto xk = in[k];
+        const auto xmk = in[half - k];
+        const auto w = plan->realTwiddles[k];
+
+        // even = X[k] + conj(X[N/2 - k]), odd = (X[k] - conj(X[N/2 - k])) * conj(w)
+        const float evenR = xk.r + xmk.r;
+        const float evenI = xk.i - xmk.i;
+        const float dr = xk.r - xmk.r;
+        const float di = xk.i + xmk.i;
+        const float oddR = (dr * w.r) + (di * w.i);
+        const float oddI = (di * w.r) - (dr * w.i);
+
+        pScratch[half - k] = FftComplex{ evenR + oddI, -evenI + oddR };
+        pScratch[k] = FftComplex{ evenR - oddI, evenI + oddR };
+    }
+
+    fft_complex(plan->half, pScratch, (FftComplex*)out);
+}
+
+std::vector<FftBenchmarkResult> fft_benchmark(uint32_t minSize, uint32_t maxSize, FftKind kind, double secondsPerSize)
+{
+    using namespace std::chrono;
+
+    std::vector<FftBenchmarkResult> results;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    for (uint32_t size = std::max(4u, minSize); size <= maxSize; size *= 2)
+    {
+        std::vector<float> realIn(size);
+        std::vector<FftComplex> complexIn(size);
+        std::vector<FftComplex> complexOut(size + 1);
+        for (uint32_t i = 0; i < size; i++)
+        {
+            realIn[i] = dist(rng);
+            complexIn[i] = FftComplex{ dist(rng), dist(rng) };
+        }
+
+        for (uint32_t backend = 0; backend < uint32_t(FftBackend::Count); backend++)
+        {
+            if (!fft_backend_supports(FftBackend(backend), size))
+            {
+                continue;
+            }
+
+            auto pPlan = fft_plan(FftBackend(backend), size, kind, FftDirection::Forward);
+            auto run = [&]() {
+                if (kind == FftKind::Real)
+                {
+                    fft_real_forward(pPlan, realIn.data(), complexOut.data());
+                }
+                else
+                {
+                    fft_complex(pPlan, complexIn.data(), complexOut.data());
+                }
+            };
+
+            // Warm the caches
+            run();
+
+            const uint32_t batch = std::max(1u, 65536u / size);
+            uint64_t count = 0;
+            const auto start = steady_clock::now();
+            auto elapsed = duration<double>(0.0);
+            do
+            {
+                for (uint32_t i = 0; i < batch; i++)
+                {
+                    run();
+                }
+                count += batch;
+                elapsed = steady_clock::now() - start;
+            } while (elapsed.count() < secondsPerSize);
+
+            FftBenchmarkResult result;
+            result.backend = FftBackend(backend);
+            result.kind = kind;
+            result.size = size;
+            result.nsPerTransform = (elapsed.count() * 1e9) / double(count);
+
+            // Conventional flop count; 5 N log2 N for complex, half that for real
+            const double flops = (kind == FftKind::Real ? 2.5 : 5.0) * double(size) * std::log2(double(size));
+            result.mflops = flops / (result.nsPerTransform * 1e-3);
+            results.push_back(result);
+        }
+    }
+    return results;
+}
+
+} // namespace Zing
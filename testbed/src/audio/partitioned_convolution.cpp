@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <zest/time/profiler.h>
+
+#include <zing/audio/partitioned_convolution.h>
+
+namespace Zing
+{
+
+void partitioned_convolution_init(PartitionedConvolution& conv, uint32_t blockSize, uint32_t maxIrLength)
+{
+    assert(blockSize > 0 && (blockSize & (blockSize - 1)) == 0);
+
+    const uint32_t fftSize = blockSize * 2;
+    conv.blockSize = blockSize;
+    conv.maxPartitions = std::max(1u, (maxIrLength + blockSize - 1) / blockSize);
+    conv.partitions = 0;
+    conv.planFwd = fft_plan(fftSize, FftKind::Complex, FftDirection::Forward);
+    conv.planInv = fft_plan(fftSize, FftKind::Complex, FftDirection::Inverse);
+    conv.irSpectra.assign(size_t(conv.maxPartitions) * fftSize, FftComplex{ 0.0f, 0.0f });
+    conv.inputSpectra.assign(size_t(conv.maxPartitions) * fftSize, FftComplex{ 0.0f, 0.0f });
+    conv.window.assign(fftSize, FftComplex{ 0.0f, 0.0f });
+    conv.accum.assign(fftSize, FftComplex{ 0.0f, 0.0f });
+    conv.timeOut.assign(fftSize, FftComplex{ 0.0f, 0.0f });
+    conv.head = 0;
+}
+
+void partitioned_convolution_set_ir(PartitionedConvolution& conv, const FftComplex* pIr, uint32_t length)
+{
+    PROFILE_SCOPE(Convolution_SetIr);
+
+    const uint32_t block = conv.blockSize;
+    const uint32_t fftSize = block * 2;
+    conv.partitions = std::min(conv.maxPartitions, std::max(1u, (length + block - 1) / block));
+    length = std::min(length, conv.partitions * block);
+
+    // Folds the inverse transform's scale into the response, so the block loop doesn't pay for it
+    const float scale = 1.0f / float(fftSize);
+    for (uint32_t p = 0; p < conv.partitions; p++)
+    {
+        std::fill(conv.accum.begin(), conv.accum.end(), FftComplex{ 0.0f, 0.0f });
+        const uint32_t begin = p * block;
+        const uint32_t count = begin < length ? std::min(block, length - begin) : 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            conv.accum[i] = FftComplex{ pIr[begin + i].r * scale, pIr[begin + i].i * scale };
+        }
+        fft_complex(conv.planFwd, conv.accum.data(), conv.irSpectra.data() + (size_t(p) * fftSize));
+    }
+}
+
+void partitioned_convolution_copy_ir(PartitionedConvolution& conv, const FftComplex* pIrSpectra, uint32_t partitions)
+{
+    conv.partitions = std::min(conv.maxPartitions, partitions);
+    std::copy_n(pIrSpectra, size_t(conv.partitions) * conv.blockSize * 2, conv.irSpectra.data());
+}
+
+void partitioned_convolution_reset(PartitionedConvolution& conv)
+{
+    std::fill(conv.inputSpectra.begin(), conv.inputSpectra.end(), FftComplex{ 0.0f, 0.0f });
+    std::fill(conv.window.begin(), conv.window.end(), FftComplex{ 0.0f, 0.0f });
+    conv.head = 0;
+}
+
+void partitioned_convolution_process(PartitionedConvolution& conv, const float* pIn, FftComplex* pOut)
+{
+    PROFILE_SCOPE(Convolution_Process);
+
+    const uint32_t block = conv.blockSize;
+    const uint32_t fftSize = block * 2;
+
+    // Slide the input along a block
+    std::copy_n(conv.window.data() + block, block, conv.window.data());
+    for (uint32_t i = 0; i < block; i++)
+    {
+        conv.window[block + i] = FftComplex{ pIn[i], 0.0f };
+    }
+
+    conv.head = (conv.head + 1) % conv.maxPartitions;
+    fft_complex(conv.planFwd, conv.window.data(), conv.inputSpectra.data() + (size_t(conv.head) * fftSize));
+
+    // Partition p meets the input from p blocks ago
+    std::fill(conv.accum.begin(), conv.accum.end(), FftComplex{ 0.0f, 0.0f });
+    for (uint32_t p = 0; p < conv.partitions; p++)
+    {
+        const uint32_t slot = (conv.head + conv.maxPartitions - p) % conv.maxPartitions;
+        const FftComplex* pX = conv.inputSpectra.data() + (size_t(slot) * fftSize);
+        const FftComplex* pH = conv.irSpectra.data() + (size_t(p) * fftSize);
+        for (uint32_t k = 0; k < fftSize; k++)
+        {
+            conv.accum[k].r += (pX[k].r * pH[k].r) - (pX[k].i * pH[k].i);
+            conv.accum[k].i += (pX[k].r * pH[k].i) + (pX[k].i * pH[k].r);
+        }
+    }
+
+    fft_complex(conv.planInv, conv.accum.data(), conv.timeOut.data());
+
+    // The first half wrapped around; the second is the linear convolution
+    std::copy_n(conv.timeOut.data() + block, block, pOut);
+}
+
+void minimum_phase_init(MinimumPhase& design, uint32_t size)
+{
+    assert(size > 0 && (size & (size - 1)) == 0);
+
+    design.size = size;
+    design.planFwd = fft_plan(size, FftKind::Complex, FftDirection::Forward);
+    design.planInv = fft_plan(size, FftKind::Complex, FftDirection::Inverse);
+    design.work.assign(size, FftComplex{ 0.0f, 0.0f });
+    design.ir.assign(size, FftComplex{ 0.0f, 0.0f });
+}
+
+void minimum_phase_design(MinimumPhase& design, const float* pMagnitude, float floorGain)
+{
+    PROFILE_SCOPE(MinimumPhase_Design);
+
+    const uint32_t size = design.size;
+    const float invSize = 1.0f / float(size);
+
+    // Real cepstrum of the log magnitude
+    for (uint32_t k = 0; k < size; k++)
+    {
+        design.work[k] = FftComplex{ std::log(std::max(pMagnitude[k], floorGain)), 0.0f };
+    }
+    fft_complex(design.planInv, design.work.data(), design.ir.data());
+
+    // Fold the anti-causal half onto the causal one; that keeps the log magnitude and makes the
+    // phase its Hilbert transform
+    const uint32_t half = size / 2;
+    design.ir[0].r *= invSize;
+    design.ir[0].i *= invSize;
+    design.ir[half].r *= invSize;
+    design.ir[half].i *= invSize;
+    for (uint32_t n = 1; n < half; n++)
+    {
+        design.ir[n].r *= 2.0f * invSize;
+        design.ir[n].i *= 2.0f * invSize;
+        design.ir[half + n] = FftComplex{ 0.0f, 0.0f };
+    }
+
+    // Back to the spectrum, out of the log, and into time
+    fft_complex(design.planFwd, design.ir.data(), design.work.data());
+    for (uint32_t k = 0; k < size; k++)
+    {
+        const float gain = std::exp(design.work[k].r);
+        design.work[k] = FftComplex{ gain * std::cos(design.work[k].i), gain * std::sin(design.work[k].i) };
+    }
+    fft_complex(design.planInv, design.work.data(), design.ir.data());
+    for (uint32_t n = 0; n < size; n++)
+    {
+        design.ir[n].r *= invSize;
+        design.ir[n].i *= invSize;
+    }
+}
+
+} // namespace Zing
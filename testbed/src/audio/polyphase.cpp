@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+
+#include <zing/audio/polyphase.h>
+
+namespace Zing
+{
+
+namespace
+{
+
+// Classic Blackman; ~74dB sidelobes, but a narrower main lobe for the same length
+double blackman(uint32_t i, uint32_t size)
+{
+    const double phase = 2.0 * glm::pi<double>() * double(i) / double(size - 1);
+    return 0.42 - (0.5 * std::cos(phase)) + (0.08 * std::cos(2.0 * phase));
+}
+
+} // namespace
+
+double blackman_harris(uint32_t i, uint32_t size)
+{
+    const double phase = 2.0 * glm::pi<double>() * double(i) / double(size - 1);
+    return 0.35875 - (0.48829 * std::cos(phase)) + (0.14128 * std::cos(2.0 * phase)) - (0.01168 * std::cos(3.0 * phase));
+}
+
+void normalize_phasor(double& re, double& im)
+{
+    const double invLength = 1.0 / std::sqrt((re * re) + (im * im));
+    re *= invLength;
+    im *= invLength;
+}
+
+void normalize_phasor(float& re, float& im)
+{
+    const float invLength = 1.0f / std::sqrt((re * re) + (im * im));
+    re *= invLength;
+    im *= invLength;
+}
+
+HalfBandCoeffs half_band_design()
+{
+    std::array<double, HalfBandK + 1> odd{};
+    double total = 0.0;
+    for (uint32_t j = 0; j <= HalfBandK; j++)
+    {
+        const uint32_t d = (2 * j) + 1;
+        const double sinc = std::sin(glm::half_pi<double>() * d) / (glm::pi<double>() * d);
+        odd[j] = sinc * blackman_harris(HalfBandCenter + d, HalfBandTaps);
+        total += odd[j];
+    }
+
+    // 0.5 (center) + 2 * sum(odd) == 1
+    HalfBandCoeffs taps{};
+    for (uint32_t j = 0; j < odd.size(); j++)
+    {
+        taps[j] = float(odd[j] * 0.25 / total);
+    }
+    return taps;
+}
+
+void half_band_decimator_reset(HalfBandDecimator& stage)
+{
+    stage.re.fill(0.0f);
+    stage.im.fill(0.0f);
+    stage.center.fill(FftComplex{ 0.0f, 0.0f });
+    stage.centerWrite = 0;
+    stage.skip = false;
+}
+
+uint32_t half_band_decimate(const HalfBandCoeffs& taps, HalfBandDecimator& stage, FftComplex* pData, uint32_t count)
+{
+    static_assert(std::has_single_bit(HalfBandK + 1));
+    constexpr uint32_t CenterMask = HalfBandK;
+
+    std::array<float, HalfBandBlock> outRe;
+    std::array<float, HalfBandBlock> outIm;
+    uint32_t outCount = 0;
+    for (uint32_t done = 0; done < count;)
+    {
+        // Deal the inputs out to the two phases. The center sample is the oldest in its delay,
+        // HalfBandCenter inputs back; it starts each output's sum, as the direct form did.
+        uint32_t block = 0;
+        while (done < count && block < HalfBandBlock)
+        {
+            const auto& sample = pData[done++];
+            stage.skip = !stage.skip;
+            if (stage.skip)
+            {
+                stage.center[stage.centerWrite] = sample;
+                stage.centerWrite = (stage.centerWrite + 1) & CenterMask;
+                continue;
+            }
+
+            const auto& center = stage.center[stage.centerWrite];
+            outRe[block] = 0.5f * center.r;
+            outIm[block] = 0.5f * center.i;
+            stage.re[HalfBandHistory + block] = sample.r;
+            stage.im[HalfBandHistory + block] = sample.i;
+            block++;
+        }
+
+        // Output i's window is [i, i + 2K + 1] of the odd phase, oldest to newest
+        for (uint32_t j = 0; j <= HalfBandK; j++)
+        {
+            const float tap = taps[j];
+            const float* pOldRe = &stage.re[HalfBandK - j];
+            const float* pNewRe = &stage.re[HalfBandK + 1 + j];
+            const float* pOldIm = &stage.im[HalfBandK - j];
+            const float* pNewIm = &stage.im[HalfBandK + 1 + j];
+            for (uint32_t i = 0; i < block; i++)
+            {
+                outRe[i] += tap * (pOldRe[i] + pNewRe[i]);
+                outIm[i] += tap * (pOldIm[i] + pNewIm[i]);
+            }
+        }
+
+        // Never ahead of the inputs already taken, so in place is safe
+        for (uint32_t i = 0; i < block; i++)
+        {
+            pData[outCount++] = FftComplex{ outRe[i], outIm[i] };
+        }
+        std::copy_n(stage.re.begin() + block, HalfBandHistory, stage.re.begin());
+        std::copy_n(stage.im.begin() + block, HalfBandHistory, stage.im.begin());
+    }
+    return outCount;
+}
+
+void half_band_interpolator_reset(HalfBandInterpolator& stage)
+{
+    stage.delay.fill(0.0f);
+}
+
+void half_band_interpolate(const HalfBandCoeffs& taps, HalfBandInterpolator& stage, const float* pIn, uint32_t count, float* pOut)
+{
+    std::array<float, HalfBandBlock> even;
+    for (uint32_t done = 0; done < count;)
+    {
+        const uint32_t block = std::min(count - done, HalfBandBlock);
+        std::copy_n(pIn + done, block, stage.delay.begin() + HalfBandHistory);
+
+        // Input i's window is [i, i + 2K + 1], oldest to newest. With the stuffed zeros, the even
+        // output only sees the odd taps, and the odd output only sees the center; the x2 restores
+        // the level the zeros took away.
+        std::fill_n(even.begin(), block, 0.0f);
+        for (uint32_t j = 0; j <= HalfBandK; j++)
+        {
+            const float tap = taps[j];
+            const float* pOld = &stage.delay[HalfBandK - j];
+            const float* pNew = &stage.delay[HalfBandK + 1 + j];
+            for (uint32_t i = 0; i < block; i++)
+            {
+                even[i] += tap * (pNew[i] + pOld[i]);
+            }
+        }
+
+        float* pDst = pOut + (size_t(done) * 2);
+        for (uint32_t i = 0; i < block; i++)
+        {
+            pDst[(2 * i)] = 2.0f * even[i];
+            pDst[(2 * i) + 1] = stage.delay[i + HalfBandK + 1];
+        }
+        std::copy_n(stage.delay.begin() + block, HalfBandHistory, stage.delay.begin());
+        done += block;
+    }
+}
+
+uint32_t fir_low_pass_taps(double transitionHz, double sampleRate, uint32_t maxTaps)
+{
+    // Blackman's transition is ~5.5 bins of the filter length
+    const double ideal = 5.5 * sampleRate / std::max(transitionHz, 1e-3);
+    auto taps = uint32_t(std::clamp(ideal, 15.0, double(std::max(maxTaps, 15u))));
+    return taps | 1;
+}
+
+void fir_design_low_pass(float* pTaps, uint32_t count, double cutoffHz, double sampleRate)
+{
+    assert(count & 1);
+    const double cutoff = std::clamp(cutoffHz / sampleRate, 0.0, 0.5);
+    const int center = int(count / 2);
+
+    // In place, so a redesign from the audio thread doesn't allocate
+    double total = 0.0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const int d = int(i) - center;
+        const double sinc = d == 0 ? 2.0 * cutoff : std::sin(2.0 * glm::pi<double>() * cutoff * d) / (glm::pi<double>() * d);
+        const double tap = sinc * blackman(i, count);
+        pTaps[i] = float(tap);
+        total += tap;
+    }
+
+    const auto scale = float(1.0 / total);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pTaps[i] *= scale;
+    }
+}
+
+void fir_complex_init(FirComplex& fir, uint32_t maxTaps)
+{
+    // Designs are always odd
+    maxTaps |= 1;
+    fir.taps.assign(maxTaps, 0.0f);
+    fir.re.assign(maxTaps - 1 + FirComplexBlock, 0.0f);
+    fir.im.assign(maxTaps - 1 + FirComplexBlock, 0.0f);
+    fir.tapCount = 0;
+}
+
+void fir_complex_reset(FirComplex& fir)
+{
+    std::fill(fir.re.begin(), fir.re.end(), 0.0f);
+    std::fill(fir.im.begin(), fir.im.end(), 0.0f);
+}
+
+void fir_complex_design_low_pass(FirComplex& fir, uint32_t count, double cutoffHz, double sampleRate)
+{
+    assert(count <= fir.taps.size());
+    count = std::min(count, uint32_t(fir.taps.size()));
+    fir_design_low_pass(fir.taps.data(), count, cutoffHz, sampleRate);
+
+    // The history is laid out for the old length
+    if (count != fir.tapCount)
+    {
+        fir_complex_reset(fir);
+        fir.tapCount = count;
+    }
+}
+
+void fir_complex_process(FirComplex& fir, FftComplex* pData, uint32_t count)
+{
+    const auto taps = fir.tapCount;
+    if (taps == 0)
+    {
+        return;
+    }
+
+    const uint32_t history = taps - 1;
+    const uint32_t center = taps / 2;
+    float* pRe = fir.re.data();
+    float* pIm = fir.im.data();
+    std::array<float, FirComplexBlock> outRe;
+    std::array<float, FirComplexBlock> outIm;
+    for (uint32_t done = 0; done < count;)
+    {
+        const uint32_t block = std::min(count - done, FirComplexBlock);
+        for (uint32_t i = 0; i < block; i++)
+        {
+            pRe[history + i] = pData[done + i].r;
+            pIm[history + i] = pData[done + i].i;
+        }
+
+        // Output i's window is [i, i + taps - 1], oldest to newest. Linear phase; the taps are
+        // symmetric, so fold the window around the center and do half the multiplies.
+        const float centerTap = fir.taps[center];
+        for (uint32_t i = 0; i < block; i++)
+        {
+            outRe[i] = centerTap * pRe[i + center];
+            outIm[i] = centerTap * pIm[i + center];
+        }
+        for (uint32_t k = 0; k < center; k++)
+        {
+            const float tap = fir.taps[k];
+            const float* pOldRe = pRe + k;
+            const float* pNewRe = pRe + (taps - 1 - k);
+            const float* pOldIm = pIm + k;
+            const float* pNewIm = pIm + (taps - 1 - k);
+            for (uint32_t i = 0; i < block; i++)
+            {
+                outRe[i] += tap * (pOldRe[i] + pNewRe[i]);
+                outIm[i] += tap * (pOldIm[i] + pNewIm[i]);
+            }
+        }
+
+        for (uint32_t i = 0; i < block; i++)
+        {
+            pData[done + i] = FftComplex{ outRe[i], outIm[i] };
+        }
+        std::copy_n(pRe + block, history, pRe);
+        std::copy_n(pIm + block, history, pIm);
+        done += block;
+    }
+}
+
+} // namespace Zing
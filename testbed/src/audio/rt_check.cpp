@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#include <zest/time/profiler.h>
+
+#include <zing/audio/rt_check.h>
+
+#if defined(_MSC_VER)
+#include <crtdbg.h>
+#include <intrin.h>
+#define RT_CHECK_CALLER() _ReturnAddress()
+#else
+#define RT_CHECK_CALLER() __builtin_return_address(0)
+#endif
+
+namespace Zing
+{
+
+namespace
+{
+
+struct RtCheckState
+{
+    RtViolation violations[RtCheckMaxViolations];
+    std::atomic<uint32_t> count = 0;
+    std::atomic<uint64_t> totalHits = 0;
+    std::atomic<bool> clearRequested = false;
+    std::atomic<bool> breakOnViolation = false;
+};
+
+// Constant initialized, so it is usable from the allocator before any constructors run
+RtCheckState rtCheck;
+
+// Non null inside a checked region
+thread_local const char* t_rtScope = nullptr;
+
+// Set while recording, or while the check itself calls the allocator, so it doesn't report itself
+thread_local bool t_rtBusy = false;
+
+void rt_check_record(RtViolationKind kind, const char* pWhat, const void* pCaller, uint64_t size)
+{
+    if (!t_rtScope || t_rtBusy)
+    {
+        return;
+    }
+    t_rtBusy = true;
+
+    {
+        PROFILE_SCOPE(RtViolation);
+
+        // Only the audio thread writes; the UI reads up to the published count
+        const auto count = rtCheck.count.load(std::memory_order_relaxed);
+        bool found = false;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto& violation = rtCheck.violations[i];
+            if (violation.kind == kind && violation.pScope == t_rtScope && violation.pWhat == pWhat && violation.pCaller == pCaller)
+            {
+                violation.hits.fetch_add(1, std::memory_order_relaxed);
+                found = true;
+                break;
+            }
+        }
+
+        // Past the limit, the site still shows in the total
+        if (!found && count < RtCheckMaxViolations)
+        {
+            auto& violation = rtCheck.violations[count];
+            violation.kind = kind;
+            violation.pScope = t_rtScope;
+            violation.pWhat = pWhat;
+            violation.pCaller = pCaller;
+            violation.size = size;
+            violation.hits.store(1, std::memory_order_relaxed);
+            rtCheck.count.store(count + 1, std::memory_order_release);
+        }
+        rtCheck.totalHits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    t_rtBusy = false;
+
+    assert(!rtCheck.breakOnViolation.load(std::memory_order_relaxed) && "Real time violation on the audio thread");
+}
+
+} // namespace
+
+void rt_check_init()
+{
+#if defined(ZING_RT_CHECK) && defined(_MSC_VER) && defined(_DEBUG)
+    // The debug CRT reports malloc/free (and everything built on them) through its hook
+    _CrtSetAllocHook([](int allocType, void*, size_t size, int blockType, long, const unsigned char*, int) {
+        // CRT internal blocks are allocated while the CRT holds its own locks; leave them be
+        if (blockType != _CRT_BLOCK)
+        {
+            rt_check_record(allocType == _HOOK_FREE ? RtViolationKind::Free : RtViolationKind::Alloc, nullptr, RT_CHECK_CALLER(), size);
+        }
+        return TRUE;
+    });
+#endif
+}
+
+const char* rt_check_enter(const char* pName)
+{
+    const auto pPrevious = t_rtScope;
+
+    // Entering the outermost region is a safe point for the audio thread to clear its own list
+    if (!pPrevious && rtCheck.clearRequested.exchange(false, std::memory_order_acquire))
+    {
+        rtCheck.count.store(0, std::memory_order_release);
+        rtCheck.totalHits.store(0, std::memory_order_relaxed);
+    }
+
+    t_rtScope = pName;
+    return pPrevious;
+}
+
+void rt_check_leave(const char* pPrevious)
+{
+    t_rtScope = pPrevious;
+}
+
+void rt_check_blocking(const char* pWhat)
+{
+    rt_check_record(RtViolationKind::Lock, pWhat, RT_CHECK_CALLER(), 0);
+}
+
+uint32_t rt_check_violation_count()
+{
+    return rtCheck.count.load(std::memory_order_acquire);
+}
+
+const RtViolation& rt_check_violation(uint32_t index)
+{
+    assert(index < RtCheckMaxViolations);
+    return rtCheck.violations[index];
+}
+
+uint64_t rt_check_total_hits()
+{
+    return rtCheck.totalHits.load(std::memory_order_relaxed);
+}
+
+void rt_check_request_clear()
+{
+    rtCheck.clearRequested.store(true, std::memory_order_release);
+}
+
+void rt_check_set_break(bool enable)
+{
+    rtCheck.breakOnViolation.store(enable, std::memory_order_relaxed);
+}
+
+bool rt_check_get_break()
+{
+    return rtCheck.breakOnViolation.load(std::memory_order_relaxed);
+}
+
+const char* rt_check_kind_name(RtViolationKind kind)
+{
+    switch (kind)
+    {
+        case RtViolationKind::Alloc:
+            return "Alloc";
+        case RtViolationKind::Free:
+            return "Free";
+        case RtViolationKind::Lock:
+            return "Lock";
+    }
+    return "?";
+}
+
+} // namespace Zing
+
+#ifdef ZING_RT_CHECK
+
+namespace
+{
+
+// The underlying allocator, without a second report from the malloc hooks below
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+extern "C" void __libc_free(void* p);
+
+void* rt_check_raw_alloc(size_t size)
+{
+    return __libc_malloc(size);
+}
+
+void rt_check_raw_free(void* p)
+{
+    __libc_free(p);
+}
+#else
+void* rt_check_raw_alloc(size_t size)
+{
+    Zing::t_rtBusy = true;
+    auto p = std::malloc(size);
+    Zing::t_rtBusy = false;
+    return p;
+}
+
+void rt_check_raw_free(void* p)
+{
+    Zing::t_rtBusy = true;
+    std::free(p);
+    Zing::t_rtBusy = false;
+}
+#endif
+
+void* rt_check_raw_aligned_alloc(size_t size, std::align_val_t align)
+{
+    Zing::t_rtBusy = true;
+#if defined(_MSC_VER)
+    auto p = _aligned_malloc(size, size_t(align));
+#else
+    // aligned_alloc wants a multiple of the alignment
+    const auto alignment = size_t(align);
+    auto p = std::aligned_alloc(alignment, ((std::max<size_t>(size, 1) + alignment - 1) / alignment) * alignment);
+#endif
+    Zing::t_rtBusy = false;
+    return p;
+}
+
+void rt_check_raw_aligned_free(void* p)
+{
+    Zing::t_rtBusy = true;
+#if defined(_MSC_VER)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+    Zing::t_rtBusy = false;
+}
+
+void* rt_check_new(size_t size, const void* pCaller)
+{
+    Zing::rt_check_record(Zing::RtViolationKind::Alloc, nullptr, pCaller, size);
+    return rt_check_raw_alloc(size == 0 ? 1 : size);
+}
+
+void* rt_check_new_aligned(size_t size, std::align_val_t align, const void* pCaller)
+{
+    Zing::rt_check_record(Zing::RtViolationKind::Alloc, nullptr, pCaller, size);
+    return rt_check_raw_aligned_alloc(size, align);
+}
+
+void rt_check_delete(void* p, const void* pCaller)
+{
+    if (p)
+    {
+        Zing::rt_check_record(Zing::RtViolationKind::Free, nullptr, pCaller, 0);
+        rt_check_raw_free(p);
+    }
+}
+
+void rt_check_delete_aligned(void* p, const void* pCaller)
+{
+    if (p)
+    {
+        Zing::rt_check_record(Zing::RtViolationKind::Free, nullptr, pCaller, 0);
+        rt_check_raw_aligned_free(p);
+    }
+}
+
+} // namespace
+
+// Replacement global operators; every C++ allocation in the process comes through here
+void* operator new(size_t size)
+{
+    if (auto p = rt_check_new(size, RT_CHECK_CALLER()))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (auto p = rt_check_new(size, RT_CHECK_CALLER()))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return rt_check_new(size, RT_CHECK_CALLER());
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return rt_check_new(size, RT_CHECK_CALLER());
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+    if (auto p = rt_check_new_aligned(size, align, RT_CHECK_CALLER()))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t align)
+{
+    if (auto p = rt_check_new_aligned(size, align, RT_CHECK_CALLER()))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    return rt_check_new_aligned(size, align, RT_CHECK_CALLER());
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    return rt_check_new_aligned(size, align, RT_CHECK_CALLER());
+}
+
+void operator delete(void* p) noexcept
+{
+    rt_check_delete(p, RT_CHECK_CALLER());
+}
+
+void operator delete[](void* p) noexcept
+{
+    rt_check_delete(p, RT_CHECK_CALLER());
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    rt_check_delete(p, RT_CHECK_CALLER());
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    rt_check_delete(p, RT_CHECK_CALLER());
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    rt_check_delete(p, RT_CHECK_CALLER());
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    rt_check_delete(p, RT_CHECK_CALLER());
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    rt_check_delete_aligned(p, RT_CHECK_CALLER());
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    rt_check_delete_aligned(p, RT_CHECK_CALLER());
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    rt_check_delete_aligned(p, RT_CHECK_CALLER());
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept
+{
+    rt_check_delete_aligned(p, RT_CHECK_CALLER());
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    rt_check_delete_aligned(p, RT_CHECK_CALLER());
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    rt_check_delete_aligned(p, RT_CHECK_CALLER());
+}
+
+#if defined(__GLIBC__)
+// glibc lets the executable interpose the C allocator, which catches malloc from C code and
+// libraries too. The debug CRT hook does the same job on Windows.
+extern "C" void* malloc(size_t size)
+{
+    Zing::rt_check_record(Zing::RtViolationKind::Alloc, nullptr, RT_CHECK_CALLER(), size);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    Zing::rt_check_record(Zing::RtViolationKind::Alloc, nullptr, RT_CHECK_CALLER(), count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size)
+{
+    Zing::rt_check_record(Zing::RtViolationKind::Alloc, nullptr, RT_CHECK_CALLER(), size);
+    return __libc_realloc(p, size);
+}
+
+extern "C" void free(void* p)
+{
+    if (p)
+    {
+        Zing::rt_check_record(Zing::RtViolationKind::Free, nullptr, RT_CHECK_CALLER(), 0);
+    }
+    __libc_free(p);
+}
+#endif
+
+#endif // ZING_RT_CHECK
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+#include <zing/audio/sample_ring.h>
+
+namespace Zing
+{
+
+void sample_ring_init(SampleRing& ring, uint32_t blockSize, uint32_t blockCount)
+{
+    ring.blockSize = std::max(1u, blockSize);
+    ring.blockCount = std::bit_ceil(std::max(2u, blockCount));
+    ring.samples.assign(size_t(ring.blockSize) * ring.blockCount, 0.0f);
+    ring.used.assign(ring.blockCount, 0);
+    ring.writeIndex.store(0, std::memory_order_relaxed);
+    ring.readIndex.store(0, std::memory_order_relaxed);
+    ring.writtenBlocks.store(0, std::memory_order_relaxed);
+    ring.droppedBlocks.store(0, std::memory_order_relaxed);
+}
+
+float* sample_ring_write_begin(SampleRing& ring)
+{
+    // Acquire; the consumer must be done with a block before we write over it
+    const auto write = ring.writeIndex.load(std::memory_order_relaxed);
+    if (ring.samples.empty() || (write - ring.readIndex.load(std::memory_order_acquire)) >= ring.blockCount)
+    {
+        ring.droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    return &ring.samples[size_t(write & (ring.blockCount - 1)) * ring.blockSize];
+}
+
+void sample_ring_write_end(SampleRing& ring, uint32_t count)
+{
+    assert(count <= ring.blockSize);
+
+    // Release; the samples and their count are visible before the block is
+    const auto write = ring.writeIndex.load(std::memory_order_relaxed);
+    ring.used[write & (ring.blockCount - 1)] = count;
+    ring.writeIndex.store(write + 1, std::memory_order_release);
+    ring.writtenBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+const float* sample_ring_read_begin(SampleRing& ring, uint32_t& count)
+{
+    const auto read = ring.readIndex.load(std::memory_order_relaxed);
+    if (read == ring.writeIndex.load(std::memory_order_acquire))
+    {
+        count = 0;
+        return nullptr;
+    }
+
+    const auto block = read & (ring.blockCount - 1);
+    count = ring.used[block];
+    return &ring.samples[size_t(block) * ring.blockSize];
+}
+
+void sample_ring_read_end(SampleRing& ring)
+{
+    ring.readIndex.store(ring.readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint32_t sample_ring_pending(const SampleRing& ring)
+{
+    return uint32_t(ring.writeIndex.load(std::memory_order_acquire) - ring.readIndex.load(std::memory_order_acquire));
+}
+
+} // namespace Zing
@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <zing/audio/spectral_kernels.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define ZING_SPECTRAL_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+// MSVC will emit AVX2 in any function; gcc/clang need it enabling per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ZING_TARGET_AVX2
+#else
+#define ZING_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ZING_SPECTRAL_NEON 1
+#endif
+
+namespace Zing
+{
+
+namespace
+{
+
+// log2(x) = e + log2(m), with m in [sqrt(0.5), sqrt(2)) and
+// log2(m) = 2/ln(2) * atanh(s), s = (m - 1) / (m + 1), |s| < 0.172.
+// The series is cut after s^7; the next term is below 5e-8 in log2.
+constexpr float Log2C1 = 2.8853900817779268f;
+constexpr float Log2C3 = 0.9617966939259756f;
+constexpr float Log2C5 = 0.5770780163555854f;
+constexpr float Log2C7 = 0.4121985831111324f;
+constexpr int32_t SqrtHalfBits = 0x3f3504f3;
+constexpr float DbPerLog2 = 3.0102999566398120f; // 10 * log10(2)
+constexpr float MinPower = 1e-10f;
+
+struct SpectralKernels
+{
+    SpectralIsa isa;
+    void (*window)(const float*, const float*, float*, uint32_t);
+    void (*power)(const FftComplex*, float*, uint32_t, float);
+    void (*powerToDb)(const float*, float*, uint32_t, float);
+    float (*dot)(const float*, const float*, uint32_t);
+};
+
+inline float fast_log2(float x)
+{
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    const int32_t t = bits - SqrtHalfBits;
+    const int32_t e = t >> 23;
+    const int32_t mBits = (t & 0x007fffff) + SqrtHalfBits;
+    float m;
+    memcpy(&m, &mBits, sizeof(m));
+    const float s = (m - 1.0f) / (m + 1.0f);
+    const float s2 = s * s;
+    return float(e) + s * (Log2C1 + s2 * (Log2C3 + s2 * (Log2C5 + s2 * Log2C7)));
+}
+
+// Scalar ================================================================================
+
+void window_scalar(const float* in, const float* window, float* out, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = in[i] * window[i];
+    }
+}
+
+void power_scalar(const FftComplex* in, float* out, uint32_t count, float scale)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = ((in[i].r * in[i].r) + (in[i].i * in[i].i)) * scale;
+    }
+}
+
+void power_to_db_scalar(const float* in, float* out, uint32_t count, float dbRange)
+{
+    const float scale = DbPerLog2 / dbRange;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float db = fast_log2(std::max(in[i], MinPower)) * scale + 1.0f;
+        out[i] = std::clamp(db, 0.0f, 1.0f);
+    }
+}
+
+float dot_scalar(const float* a, const float* b, uint32_t count)
+{
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+const SpectralKernels ScalarKernels = { SpectralIsa::Scalar, window_scalar, power_scalar, power_to_db_scalar, dot_scalar };
+
+#if defined(ZING_SPECTRAL_X86)
+// SSE2 ==================================================================================
+
+inline __m128 fast_log2_sse2(__m128 x)
+{
+    const __m128i t = _mm_sub_epi32(_mm_castps_si128(x), _mm_set1_epi32(SqrtHalfBits));
+    const __m128 e = _mm_cvtepi32_ps(_mm_srai_epi32(t, 23));
+    const __m128 m = _mm_castsi128_ps(_mm_add_epi32(_mm_and_si128(t, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(SqrtHalfBits)));
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 s = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    const __m128 s2 = _mm_mul_ps(s, s);
+    __m128 poly = _mm_add_ps(_mm_set1_ps(Log2C5), _mm_mul_ps(s2, _mm_set1_ps(Log2C7)));
+    poly = _mm_add_ps(_mm_set1_ps(Log2C3), _mm_mul_ps(s2, poly));
+    poly = _mm_add_ps(_mm_set1_ps(Log2C1), _mm_mul_ps(s2, poly));
+    return _mm_add_ps(e, _mm_mul_ps(s, poly));
+}
+
+void window_sse2(const float* in, const float* window, float* out, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(window + i)));
+    }
+    window_scalar(in + i, window + i, out + i, count - i);
+}
+
+void power_sse2(const FftComplex* in, float* out, uint32_t count, float scale)
+{
+    const float* pIn = &in[0].r;
+    const __m128 vScale = _mm_set1_ps(scale);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 a = _mm_loadu_ps(pIn + (2 * i));
+        const __m128 b = _mm_loadu_ps(pIn + (2 * i) + 4);
+        const __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)), vScale));
+    }
+    power_scalar(in + i, out + i, count - i, scale);
+}
+
+void power_to_db_sse2(const float* in, float* out, uint32_t count, float dbRange)
+{
+    const __m128 scale = _mm_set1_ps(DbPerLog2 / dbRange);
+    const __m128 minPower = _mm_set1_ps(MinPower);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_max_ps(_mm_loadu_ps(in + i), minPower);
+        const __m128 db = _mm_add_ps(_mm_mul_ps(fast_log2_sse2(x), scale), one);
+        _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(db, zero), one));
+    }
+    power_to_db_scalar(in + i, out + i, count - i, dbRange);
+}
+
+float dot_sse2(const float* a, const float* b, uint32_t count)
+{
+    __m128 sum = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(sum) + dot_scalar(a + i, b + i, count - i);
+}
+
+const SpectralKernels Sse2Kernels = { SpectralIsa::SSE2, window_sse2, power_sse2, power_to_db_sse2, dot_sse2 };
+
+// AVX2 ==================================================================================
+
+ZING_TARGET_AVX2 inline __m256 fast_log2_avx2(__m256 x)
+{
+    const __m256i t = _mm256_sub_epi32(_mm256_castps_si256(x), _mm256_set1_epi32(SqrtHalfBits));
+    const __m256 e = _mm256_cvtepi32_ps(_mm256_srai_epi32(t, 23));
+    const __m256 m = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_and_si256(t, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(SqrtHalfBits)));
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 s = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+    const __m256 s2 = _mm256_mul_ps(s, s);
+    __m256 poly = _mm256_fmadd_ps(s2, _mm256_set1_ps(Log2C7), _mm256_set1_ps(Log2C5));
+    poly = _mm256_fmadd_ps(s2, poly, _mm256_set1_ps(Log2C3));
+    poly = _mm256_fmadd_ps(s2, poly, _mm256_set1_ps(Log2C1));
+    return _mm256_fmadd_ps(s, poly, e);
+}
+
+ZING_TARGET_AVX2 void window_avx2(const float* in, const float* window, float* out, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), _mm256_loadu_ps(window + i)));
+    }
+    window_sse2(in + i, window + i, out + i, count - i);
+}
+
+ZING_TARGET_AVX2 void power_avx2(const FftComplex* in, float* out, uint32_t count, float scale)
+{
+    const float* pIn = &in[0].r;
+    const __m256 vScale = _mm256_set1_ps(scale);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 a = _mm256_loadu_ps(pIn + (2 * i));
+        const __m256 b = _mm256_loadu_ps(pIn + (2 * i) + 8);
+        // Shuffles are per 128 bit lane: [a0 a2 b0 b2 | a4 a6 b4 b6], fixed up after the math
+        const __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m256 power = _mm256_mul_ps(_mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im)), vScale);
+        _mm256_storeu_ps(out + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(power), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+    power_sse2(in + i, out + i, count - i, scale);
+}
+
+ZING_TARGET_AVX2 void power_to_db_avx2(const float* in, float* out, uint32_t count, float dbRange)
+{
+    const __m256 scale = _mm256_set1_ps(DbPerLog2 / dbRange);
+    const __m256 minPower = _mm256_set1_ps(MinPower);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 x = _mm256_max_ps(_mm256_loadu_ps(in + i), minPower);
+        const __m256 db = _mm256_fmadd_ps(fast_log2_avx2(x), scale, one);
+        _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(db, zero), one));
+    }
+    power_to_db_sse2(in + i, out + i, count - i, dbRange);
+}
+
+ZING_TARGET_AVX2 float dot_avx2(const float* a, const float* b, uint32_t count)
+{
+    __m256 sum = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum);
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(half) + dot_sse2(a + i, b + i, count - i);
+}
+
+const SpectralKernels Avx2Kernels = { SpectralIsa::AVX2, window_avx2, power_avx2, power_to_db_avx2, dot_avx2 };
+
+bool cpu_has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!fma || !osxsave || !avx)
+    {
+        return false;
+    }
+    // OS must be saving the YMM registers
+    if ((_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#elif defined(ZING_SPECTRAL_NEON)
+// NEON (AArch64) ========================================================================
+
+inline float32x4_t fast_log2_neon(float32x4_t x)
+{
+    const int32x4_t t = vsubq_s32(vreinterpretq_s32_f32(x), vdupq_n_s32(SqrtHalfBits));
+    const float32x4_t e = vcvtq_f32_s32(vshrq_n_s32(t, 23));
+    const float32x4_t m = vreinterpretq_f32_s32(vaddq_s32(vandq_s32(t, vdupq_n_s32(0x007fffff)), vdupq_n_s32(SqrtHalfBits)));
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t s = vdivq_f32(vsubq_f32(m, one), vaddq_f32(m, one));
+    const float32x4_t s2 = vmulq_f32(s, s);
+    float32x4_t poly = vfmaq_f32(vdupq_n_f32(Log2C5), s2, vdupq_n_f32(Log2C7));
+    poly = vfmaq_f32(vdupq_n_f32(Log2C3), s2, poly);
+    poly = vfmaq_f32(vdupq_n_f32(Log2C1), s2, poly);
+    return vfmaq_f32(e, s, poly);
+}
+
+void window_neon(const float* in, const float* window, float* out, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), vld1q_f32(window + i)));
+    }
+    window_scalar(in + i, window + i, out + i, count - i);
+}
+
+void power_neon(const FftComplex* in, float* out, uint32_t count, float scale)
+{
+    const float* pIn = &in[0].r;
+    const float32x4_t vScale = vdupq_n_f32(scale);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const float32x4x2_t reIm = vld2q_f32(pIn + (2 * i));
+        const float32x4_t power = vfmaq_f32(vmulq_f32(reIm.val[1], reIm.val[1]), reIm.val[0], reIm.val[0]);
+        vst1q_f32(out + i, vmulq_f32(power, vScale));
+    }
+    power_scalar(in + i, out + i, count - i, scale);
+}
+
+void power_to_db_neon(const float* in, float* out, uint32_t count, float dbRange)
+{
+    const float32x4_t scale = vdupq_n_f32(DbPerLog2 / dbRange);
+    const float32x4_t minPower = vdupq_n_f32(MinPower);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const float32x4_t x = vmaxq_f32(vld1q_f32(in + i), minPower);
+        const float32x4_t db = vfmaq_f32(one, fast_log2_neon(x), scale);
+        vst1q_f32(out + i, vminq_f32(vmaxq_f32(db, zero), one));
+    }
+    power_to_db_scalar(in + i, out + i, count - i, dbRange);
+}
+
+float dot_neon(const float* a, const float* b, uint32_t count)
+{
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        sum = vfmaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    return vaddvq_f32(sum) + dot_scalar(a + i, b + i, count - i);
+}
+
+const SpectralKernels NeonKernels = { SpectralIsa::NEON, window_neon, power_neon, power_to_db_neon, dot_neon };
+#endif
+
+const SpectralKernels* spectral_kernels_for(SpectralIsa isa)
+{
+    switch (isa)
+    {
+#if defined(ZING_SPECTRAL_X86)
+        case SpectralIsa::AVX2:
+            return &Avx2Kernels;
+        case SpectralIsa::SSE2:
+            return &Sse2Kernels;
+#elif defined(ZING_SPECTRAL_NEON)
+        case SpectralIsa::NEON:
+            return &NeonKernels;
+#endif
+        default:
+            return &ScalarKernels;
+    }
+}
+
+std::atomic<const SpectralKernels*>& spectral_active()
+{
+    static std::atomic<const SpectralKernels*> active = spectral_kernels_for(spectral_detect_isa());
+    return active;
+}
+
+} // namespace
+
+SpectralIsa spectral_detect_isa()
+{
+#if defined(ZING_SPECTRAL_X86)
+    static const SpectralIsa isa = cpu_has_avx2() ? SpectralIsa::AVX2 : SpectralIsa::SSE2;
+    return isa;
+#elif defined(ZING_SPECTRAL_NEON)
+    return SpectralIsa::NEON;
+#else
+    return SpectralIsa::Scalar;
+#endif
+}
+
+SpectralIsa spectral_get_isa()
+{
+    return spectral_active().load()->isa;
+}
+
+void spectral_set_isa(SpectralIsa isa)
+{
+    // Anything up to the detected level is safe to run
+    const auto detected = spectral_detect_isa();
+    if (uint32_t(isa) > uint32_t(detected))
+    {
+        isa = detected;
+    }
+    spectral_active().store(spectral_kernels_for(isa));
+}
+
+const char* spectral_isa_name(SpectralIsa isa)
+{
+    switch (isa)
+    {
+        case SpectralIsa::Scalar:
+            return "Scalar";
+        case SpectralIsa::SSE2:
+            return "SSE2";
+        case SpectralIsa::AVX2:
+            return "AVX2";
+        case SpectralIsa::NEON:
+            return "NEON";
+        default:
+            return "Unknown";
+    }
+}
+
+void spectral_window(const float* in, const float* window, float* out, uint32_t count)
+{
+    spectral_active().load(std::memory_order_relaxed)->window(in, window, out, count);
+}
+
+void spectral_power(const FftComplex* in, float* out, uint32_t count, float scale)
+{
+    spectral_active().load(std::memory_order_relaxed)->power(in, out, count, scale);
+}
+
+void spectral_power_to_db(const float* in, float* out, uint32_t count, float dbRange)
+{
+    spectral_active().load(std::memory_order_relaxed)->powerToDb(in, out, count, dbRange);
+}
+
+float spectral_dot(const float* a, const float* b, uint32_t count)
+{
+    return spectral_active().load(std::memory_order_relaxed)->dot(a, b, count);
+}
+
+float spectral_fast_db(float power)
+{
+    return fast_log2(std::max(power, MinPower)) * DbPerLog2;
+}
+
+SpectralDbError spectral_measure_db_error(float dbRange)
+{
+    // Log spaced sweep, with a few sizes so the vector tails are covered too
+    constexpr uint32_t Count = 4099;
+    std::vector<float> power(Count);
+    std::vector<float> normalized(Count);
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        power[i] = float(std::pow(10.0, -12.0 + (16.0 * double(i) / double(Count - 1))));
+    }
+
+    SpectralDbError error;
+    spectral_power_to_db(power.data(), normalized.data(), Count, dbRange);
+    for (uint32_t i = 0; i < Count; i++)
+    {
+        const double refDb = 10.0 * std::log10(double(std::max(power[i], MinPower)));
+        const double refNormalized = std::clamp(refDb / dbRange + 1.0, 0.0, 1.0);
+        const double approxDb = spectral_fast_db(power[i]);
+        error.maxDbError = std::max(error.maxDbError, float(std::abs(approxDb - refDb)));
+        error.maxNormalizedError = std::max(error.maxNormalizedError, float(std::abs(normalized[i] - refNormalized)));
+    }
+    return error;
+}
+
+} // namespace Zing
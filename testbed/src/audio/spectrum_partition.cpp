@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+
+#include <zing/audio/spectral_kernels.h>
+#include <zing/audio/spectrum_partition.h>
+
+namespace Zing
+{
+
+namespace
+{
+
+constexpr double LogMinHz = 20.0;
+
+double spectrum_nyquist(const SpectrumPartitionSettings& settings)
+{
+    return std::max(1.0, double(settings.sampleRate) * 0.5);
+}
+
+double spectrum_bin_hz(const SpectrumPartitionSettings& settings)
+{
+    if (settings.twoSided)
+    {
+        return (spectrum_nyquist(settings) * 2.0) / double(std::max(1u, settings.limit));
+    }
+    return spectrum_nyquist(settings) / double(std::max(1u, settings.limit - 1));
+}
+
+// The bin at 0Hz
+double spectrum_dc_bin(const SpectrumPartitionSettings& settings)
+{
+    return settings.twoSided ? double(settings.limit / 2) : 0.0;
+}
+
+SpectrumScale spectrum_scale(const SpectrumPartitionSettings& settings)
+{
+    if (settings.twoSided && (settings.scale == SpectrumScale::Log || settings.scale == SpectrumScale::Mel))
+    {
+        return SpectrumScale::Linear;
+    }
+    return settings.scale;
+}
+
+double hz_to_mel(double hz)
+{
+    return 2595.0 * std::log10(1.0 + (hz / 700.0));
+}
+
+double mel_to_hz(double mel)
+{
+    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+}
+
+// The frequency range the display covers, per scale
+void spectrum_range(const SpectrumPartitionSettings& settings, double& minHz, double& maxHz)
+{
+    const double nyquist = spectrum_nyquist(settings);
+    const double lowestHz = settings.twoSided ? -nyquist : 0.0;
+    switch (spectrum_scale(settings))
+    {
+        case SpectrumScale::Log:
+            minHz = std::min(std::max(LogMinHz, spectrum_bin_hz(settings)), nyquist * 0.5);
+            maxHz = nyquist;
+            break;
+        case SpectrumScale::Zoomed:
+            minHz = std::clamp(double(settings.zoomMinHz), lowestHz, nyquist - 1.0);
+            maxHz = std::clamp(double(settings.zoomMaxHz), minHz + 1.0, nyquist);
+            break;
+        default:
+            minHz = lowestHz;
+            maxHz = nyquist;
+            break;
+    }
+}
+
+} // namespace
+
+double spectrum_partition_hz_at(const SpectrumPartitionSettings& settings, double x)
+{
+    double minHz, maxHz;
+    spectrum_range(settings, minHz, maxHz);
+    x = std::clamp(x, 0.0, 1.0);
+
+    switch (spectrum_scale(settings))
+    {
+        case SpectrumScale::Log:
+            return minHz * std::pow(maxHz / minHz, x);
+        case SpectrumScale::Mel:
+        {
+            const double melMin = hz_to_mel(minHz);
+            return mel_to_hz(melMin + (x * (hz_to_mel(maxHz) - melMin)));
+        }
+        default:
+            return minHz + (x * (maxHz - minHz));
+    }
+}
+
+double spectrum_partition_x_at(const SpectrumPartitionSettings& settings, double hz)
+{
+    double minHz, maxHz;
+    spectrum_range(settings, minHz, maxHz);
+    hz = std::clamp(hz, minHz, maxHz);
+
+    switch (spectrum_scale(settings))
+    {
+        case SpectrumScale::Log:
+            return std::log(hz / minHz) / std::log(maxHz / minHz);
+        case SpectrumScale::Mel:
+        {
+            const double melMin = hz_to_mel(minHz);
+            return (hz_to_mel(hz) - melMin) / (hz_to_mel(maxHz) - melMin);
+        }
+        default:
+            return (hz - minHz) / (maxHz - minHz);
+    }
+}
+
+const char* spectrum_scale_name(SpectrumScale scale)
+{
+    switch (scale)
+    {
+        case SpectrumScale::Linear:
+            return "Linear";
+        case SpectrumScale::Log:
+            return "Log";
+        case SpectrumScale::Mel:
+            return "Mel";
+        case SpectrumScale::Zoomed:
+            return "Zoomed";
+        default:
+            return "Unknown";
+    }
+}
+
+bool spectrum_partition_build(SpectrumPartition& partition, const SpectrumPartitionSettings& settings)
+{
+    if (partition.settings == settings && partition.firstBin.size() == settings.n)
+    {
+        return false;
+    }
+
+    // Remember what we did last
+    partition.settings = settings;
+    partition.firstBin.resize(settings.n);
+    partition.weightOffset.resize(settings.n + 1);
+    partition.weights.clear();
+
+    // Bin k covers [(k - 0.5), (k + 0.5)] * binHz, from the DC bin. DC is left out of a one sided
+    // spectrum, as before; two sided, it is in the middle of the display.
+    const double binHz = spectrum_bin_hz(settings);
+    const double dcBin = spectrum_dc_bin(settings);
+    const int32_t firstValidBin = settings.twoSided ? 0 : 1;
+    const int32_t lastValidBin = int32_t(settings.limit) - 1;
+
+    for (uint32_t bucket = 0; bucket < settings.n; bucket++)
+    {
+        const double lo = (spectrum_partition_hz_at(settings, double(bucket) / double(settings.n)) / binHz) + dcBin;
+        const double hi = (spectrum_partition_hz_at(settings, double(bucket + 1) / double(settings.n)) / binHz) + dcBin;
+
+        const int32_t loBin = std::clamp(int32_t(std::floor(lo + 0.5)), firstValidBin, lastValidBin);
+        const int32_t hiBin = std::clamp(int32_t(std::floor(hi + 0.5)), loBin, lastValidBin);
+
+        partition.firstBin[bucket] = uint32_t(loBin);
+        partition.weightOffset[bucket] = uint32_t(partition.weights.size());
+
+        double total = 0.0;
+        for (int32_t bin = loBin; bin <= hiBin; bin++)
+        {
+            const double overlap = std::min(hi, bin + 0.5) - std::max(lo, bin - 0.5);
+            const float weight = float(std::max(0.0, overlap));
+            partition.weights.push_back(weight);
+            total += weight;
+        }
+
+        // Narrower than a bin and outside the valid range; just take the nearest
+        const auto begin = partition.weights.begin() + partition.weightOffset[bucket];
+        if (total <= 0.0)
+        {
+            std::fill(begin, partition.weights.end(), 0.0f);
+            *begin = 1.0f;
+            total = 1.0;
+        }
+
+        const float invTotal = float(1.0 / total);
+        std::for_each(begin, partition.weights.end(), [invTotal](float& weight) {
+            weight *= invTotal;
+        });
+    }
+    partition.weightOffset[settings.n] = uint32_t(partition.weights.size());
+
+    return true;
+}
+
+void spectrum_partition_apply(const SpectrumPartition& partition, const float* spectrum, float* buckets)
+{
+    for (uint32_t bucket = 0; bucket < partition.firstBin.size(); bucket++)
+    {
+        const auto offset = partition.weightOffset[bucket];
+        const auto count = partition.weightOffset[bucket + 1] - offset;
+        buckets[bucket] = spectral_dot(&partition.weights[offset], spectrum + partition.firstBin[bucket], count);
+    }
+}
+
+} // namespace Zing
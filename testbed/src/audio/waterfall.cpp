@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
 
 #include <imgui.h>
@@ -20,20 +21,6 @@ inline float Clamp(float v, float lo, float hi) {
     return std::max(lo, std::min(hi, v));
 }
 
-// Estimate noise floor from a dB line: mean of bottom 20% bins.
-// IMPORTANT: must not scramble the stored line.
-float EstimateNoiseDb_BottomMean(const float* lineDb, int bins) {
-    static thread_local std::vector<float> work;
-    work.assign(lineDb, lineDb + bins);
-
-    const int k = std::max(1, bins / 5);
-    std::nth_element(work.begin(), work.begin() + k, work.end());
-
-    float sum = 0.0f;
-    for (int i = 0; i < k; ++i) sum += work[i];
-    return sum / float(k);
-}
-
 float ReduceNoiseWindowSpan(const float* data, int count, bool useMedian) {
     if (!data || count <= 0) return -120.0f;
     if (!useMedian) {
@@ -55,11 +42,19 @@ float ReduceNoiseWindowSpan(const float* data, int count, bool useMedian) {
     return 0.5f * (lo + hi);
 }
 
+int FormatHzTick(double value, char* buff, int size, void* userData) {
+    const auto& partition = *(const Zing::SpectrumPartitionSettings*)userData;
+    const double hz = Zing::spectrum_partition_hz_at(partition, value);
+    if (hz >= 1000.0)
+        return snprintf(buff, size, "%.1fk", hz / 1000.0);
+    return snprintf(buff, size, "%.0f", hz);
+}
+
 // Push a fully-formed dB line into the ring buffer, and update emaNoiseDb if not locked/manual.
-void PushLineDb(Waterfall& wf, const float* lineDb) {
+// noiseNow is the analysis noise floor over the same spectra as the line.
+void PushLineDb(Waterfall& wf, const float* lineDb, float noiseNow) {
     // Update auto noise estimate unless user says "nope"
     if (!wf.manualFloor && !wf.lockNoiseFloor) {
-        const float noiseNow = EstimateNoiseDb_BottomMean(lineDb, wf.bins);
         if (wf.noiseWindowN < 1) wf.noiseWindowN = 1;
         if ((int)wf.noiseWinDb.size() != wf.noiseWindowN) {
             wf.noiseWinDb.assign(size_t(wf.noiseWindowN), noiseNow);
@@ -109,6 +104,7 @@ void Waterfall_Init(Waterfall& wf, int bins, int rows) {
     wf.accumulateN = std::max(1, wf.accumulateN);
     wf.accCount = 0;
     wf.accPowerSum.assign(size_t(wf.bins), 0.0f);
+    wf.accNoisePowerSum = 0.0f;
 
     wf.noiseWindowN = std::max(1, wf.noiseWindowN);
     wf.noiseWinHead = 0;
@@ -127,6 +123,7 @@ void Waterfall_Reset(Waterfall& wf) {
 
     wf.accCount = 0;
     std::fill(wf.accPowerSum.begin(), wf.accPowerSum.end(), 0.0f);
+    wf.accNoisePowerSum = 0.0f;
 
     wf.noiseWindowN = std::max(1, wf.noiseWindowN);
     wf.noiseWinHead = 0;
@@ -134,7 +131,7 @@ void Waterfall_Reset(Waterfall& wf) {
     wf.noiseWinDb.assign(size_t(wf.noiseWindowN), wf.emaNoiseDb);
 }
 
-void Waterfall_AccumulateMag(Waterfall& wf, const float* spectrumMag, int spectrumCount) {
+void Waterfall_AccumulateMag(Waterfall& wf, const float* spectrumMag, int spectrumCount, float noiseMag) {
     if (!wf.enabled) return;
     if (wf.bins <= 0 || wf.rows <= 0) return;
     if (!spectrumMag) return;
@@ -149,6 +146,7 @@ void Waterfall_AccumulateMag(Waterfall& wf, const float* spectrumMag, int spectr
         const float m = spectrumMag[i];
         wf.accPowerSum[i] += m * m;
     }
+    wf.accNoisePowerSum += noiseMag * noiseMag;
 
     wf.accCount++;
     if (wf.accCount < wf.accumulateN)
@@ -163,13 +161,15 @@ void Waterfall_AccumulateMag(Waterfall& wf, const float* spectrumMag, int spectr
         const float pAvg = wf.accPowerSum[i] * invN;
         lineDb[i] = ToDb_FromPower(pAvg);
     }
+    const float noiseDb = ToDb_FromPower(wf.accNoisePowerSum * invN);
 
     // reset accumulator
     std::fill(wf.accPowerSum.begin(), wf.accPowerSum.end(), 0.0f);
+    wf.accNoisePowerSum = 0.0f;
     wf.accCount = 0;
 
     // commit
-    PushLineDb(wf, lineDb.data());
+    PushLineDb(wf, lineDb.data(), noiseDb);
 }
 
 void Waterfall_BuildUpload(Waterfall& wf) {
@@ -248,7 +248,7 @@ void Waterfall_DrawControls(Waterfall& wf) {
                 wf.emaNoiseDb, Waterfall_FloorDb(wf), Waterfall_CeilDb(wf));
 }
 
-void Waterfall_DrawPlot(Waterfall& wf, const char* plotTitle, float maxHz, ImVec2 plotSize) {
+void Waterfall_DrawPlot(Waterfall& wf, const char* plotTitle, const Zing::SpectrumPartitionSettings& partition, ImVec2 plotSize) {
     if (!wf.enabled) return;
     if (wf.bins <= 0 || wf.rows <= 0) return;
 
@@ -257,8 +257,9 @@ void Waterfall_DrawPlot(Waterfall& wf, const char* plotTitle, float maxHz, ImVec
     const float plotWidth = plotSize.x > 0.0f ? plotSize.x : ImGui::GetContentRegionAvail().x;
     const float plotHeight = plotSize.y > 0.0f ? plotSize.y : ImGui::GetContentRegionAvail().y;
 
+    // X is the display position; tick labels are mapped back to Hz
     const double x0 = 0.0;
-    const double x1 = (double)maxHz;
+    const double x1 = 1.0;
     const double y0 = (double)wf.rows;
     const double y1 = 0.0;
 
@@ -274,15 +275,18 @@ void Waterfall_DrawPlot(Waterfall& wf, const char* plotTitle, float maxHz, ImVec
         ImPlotFlags_NoLegend | ImPlotFlags_NoFrame | ImPlotFlags_NoMenus | ImPlotFlags_NoMouseText | ImPlotFlags_NoInputs | ImPlotFlags_NoTitle)) {
         ImPlot::SetupAxes("", "", ImPlotAxisFlags_NoLabel, ImPlotAxisFlags_Lock | ImPlotAxisFlags_NoLabel | ImPlotAxisFlags_NoTickLabels);
         ImPlot::SetupAxisLimits(ImAxis_X1, x0, x1, ImPlotCond_Always);
+        ImPlot::SetupAxisFormat(ImAxis_X1, FormatHzTick, (void*)&partition);
         ImPlot::SetupAxisLimits(ImAxis_Y1, y0, y1, ImPlotCond_Always);
 
         plotPos = ImPlot::GetPlotPos();
         plotSizeActual = ImPlot::GetPlotSize();
 
         const ImPlotRect limits = ImPlot::GetPlotLimits();
-        const double markerValue = x0 + (x1 - x0) * std::clamp<double>(wf.markerX, 0.0, 1.0);
+        const double markerHz = Zing::spectrum_partition_hz_at(partition, std::clamp<double>(wf.markerX, 0.0, 1.0));
         const double markerWidthHz = std::max(1.0, double(wf.markerWidthHz));
         const double markerHalfHz = markerWidthHz * 0.5;
+        const double markerLow = Zing::spectrum_partition_x_at(partition, markerHz - markerHalfHz);
+        const double markerHigh = Zing::spectrum_partition_x_at(partition, markerHz + markerHalfHz);
 
         // Classic radio-ish (widely available in older ImPlot)
         ImPlot::PushColormap(ImPlotColormap_Jet);
@@ -299,16 +303,16 @@ void Waterfall_DrawPlot(Waterfall& wf, const char* plotTitle, float maxHz, ImVec
             ImPlotPoint(x1, limits.Y.Max)
         );
 
-        const ImPlotPoint rectMin(markerValue - markerHalfHz, limits.Y.Min);
-        const ImPlotPoint rectMax(markerValue + markerHalfHz, limits.Y.Max);
+        const ImPlotPoint rectMin(markerLow, limits.Y.Min);
+        const ImPlotPoint rectMax(markerHigh, limits.Y.Max);
         ImPlot::GetPlotDrawList()->AddRectFilled(
             ImPlot::PlotToPixels(rectMin),
             ImPlot::PlotToPixels(rectMax),
             IM_COL32(255, 255, 255, 40));
-        const ImVec2 lineMin = ImPlot::PlotToPixels(ImPlotPoint(markerValue - markerHalfHz, limits.Y.Min));
-        const ImVec2 lineMax = ImPlot::PlotToPixels(ImPlotPoint(markerValue - markerHalfHz, limits.Y.Max));
-        const ImVec2 lineMin2 = ImPlot::PlotToPixels(ImPlotPoint(markerValue + markerHalfHz, limits.Y.Min));
-        const ImVec2 lineMax2 = ImPlot::PlotToPixels(ImPlotPoint(markerValue + markerHalfHz, limits.Y.Max));
+        const ImVec2 lineMin = ImPlot::PlotToPixels(ImPlotPoint(markerLow, limits.Y.Min));
+        const ImVec2 lineMax = ImPlot::PlotToPixels(ImPlotPoint(markerLow, limits.Y.Max));
+        const ImVec2 lineMin2 = ImPlot::PlotToPixels(ImPlotPoint(markerHigh, limits.Y.Min));
+        const ImVec2 lineMax2 = ImPlot::PlotToPixels(ImPlotPoint(markerHigh, limits.Y.Max));
         ImPlot::GetPlotDrawList()->AddLine(lineMin, lineMax, IM_COL32(255, 255, 0, 255), 1.0f);
         ImPlot::GetPlotDrawList()->AddLine(lineMin2, lineMax2, IM_COL32(255, 255, 0, 255), 1.0f);
         ImPlot::PopPlotClipRect();
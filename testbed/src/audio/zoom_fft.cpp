@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+
+#include <zest/time/profiler.h>
+
+#include <zing/audio/polyphase.h>
+#include <zing/audio/spectral_kernels.h>
+#include <zing/audio/zoom_fft.h>
+
+namespace Zing
+{
+
+namespace
+{
+
+// Decimate the mixed scratch samples into the history
+void zoom_fft_decimate(ZoomFft& zoom, uint32_t count)
+{
+    for (auto& stage : zoom.stages)
+    {
+        count = half_band_decimate(zoom.taps, stage, zoom.scratch.data(), count);
+    }
+
+    // Into the ring
+    const auto size = uint32_t(zoom.history.size());
+    for (uint32_t i = 0; i < count; i++)
+    {
+        zoom.history[zoom.historyWrite] = zoom.scratch[i];
+        zoom.historyWrite = (zoom.historyWrite + 1) % size;
+    }
+}
+
+} // namespace
+
+double zoom_fft_span_hz(const ZoomFftSettings& settings)
+{
+    return double(settings.sampleRate) / double(std::max(1u, settings.decimation));
+}
+
+double zoom_fft_bin_hz(const ZoomFftSettings& settings)
+{
+    return zoom_fft_span_hz(settings) / double(std::max(1u, settings.frames));
+}
+
+bool zoom_fft_configure(ZoomFft& zoom, const ZoomFftSettings& settings)
+{
+    if (zoom.settings == settings && zoom.fftPlan)
+    {
+        return false;
+    }
+
+    zoom.settings = settings;
+    zoom.taps = half_band_design();
+
+    const auto stageCount = uint32_t(std::countr_zero(std::bit_floor(std::max(1u, settings.decimation))));
+    zoom.stages.resize(stageCount);
+    for (auto& stage : zoom.stages)
+    {
+        half_band_decimator_reset(stage);
+    }
+
+    zoom.history.assign(settings.frames, FftComplex{ 0.0f, 0.0f });
+    zoom.historyWrite = 0;
+
+    zoom.window.resize(settings.frames);
+    zoom.totalWin = 0.0f;
+    for (uint32_t i = 0; i < settings.frames; i++)
+    {
+        zoom.window[i] = float(blackman_harris(i, settings.frames));
+        zoom.totalWin += zoom.window[i];
+    }
+
+    zoom.fftIn.resize(settings.frames);
+    zoom.fftOut.resize(settings.frames);
+    zoom.fftMag.resize(settings.frames);
+    fft_plan_update(zoom.fftPlan, settings.frames, FftKind::Complex, FftDirection::Forward);
+
+    // Step depends on the rate
+    const double centerHz = zoom.centerHz;
+    zoom.centerHz = -1.0;
+    zoom_fft_set_center(zoom, centerHz);
+    return true;
+}
+
+void zoom_fft_set_center(ZoomFft& zoom, double centerHz)
+{
+    const double nyquist = double(zoom.settings.sampleRate) * 0.5;
+    centerHz = std::clamp(centerHz, zoom.settings.complexInput ? -nyquist : 0.0, nyquist);
+    if (centerHz == zoom.centerHz)
+    {
+        return;
+    }
+
+    // Less than a bin is just a slight shift; anything more would leave a ghost of the old center
+    if (std::abs(centerHz - zoom.centerHz) >= zoom_fft_bin_hz(zoom.settings))
+    {
+        std::fill(zoom.history.begin(), zoom.history.end(), FftComplex{ 0.0f, 0.0f });
+    }
+
+    zoom.centerHz = centerHz;
+
+    // Mix down; e^(-jwn)
+    const double omega = 2.0 * glm::pi<double>() * centerHz / std::max(1.0, double(zoom.settings.sampleRate));
+    zoom.stepRe = std::cos(omega);
+    zoom.stepIm = -std::sin(omega);
+}
+
+void zoom_fft_process(ZoomFft& zoom, const float* pSamples, uint32_t count)
+{
+    PROFILE_SCOPE(Zoom_Mix);
+
+    if (zoom.history.empty())
+    {
+        return;
+    }
+
+    if (zoom.scratch.size() < count)
+    {
+        zoom.scratch.resize(count);
+    }
+
+    // NCO
+    double re = zoom.phasorRe;
+    double im = zoom.phasorIm;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        zoom.scratch[i] = FftComplex{ float(pSamples[i] * re), float(pSamples[i] * im) };
+        const double nextRe = (re * zoom.stepRe) - (im * zoom.stepIm);
+        im = (re * zoom.stepIm) + (im * zoom.stepRe);
+        re = nextRe;
+    }
+
+    normalize_phasor(re, im);
+    zoom.phasorRe = re;
+    zoom.phasorIm = im;
+    zoom_fft_decimate(zoom, count);
+}
+
+void zoom_fft_process_complex(ZoomFft& zoom, const FftComplex* pSamples, uint32_t count)
+{
+    PROFILE_SCOPE(Zoom_Mix);
+
+    if (zoom.history.empty())
+    {
+        return;
+    }
+
+    if (zoom.scratch.size() < count)
+    {
+        zoom.scratch.resize(count);
+    }
+
+    // NCO; a full complex multiply, as the input has no mirror image to lose
+    double re = zoom.phasorRe;
+    double im = zoom.phasorIm;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const auto& sample = pSamples[i];
+        zoom.scratch[i] = FftComplex{ float((sample.r * re) - (sample.i * im)), float((sample.r * im) + (sample.i * re)) };
+        const double nextRe = (re * zoom.stepRe) - (im * zoom.stepIm);
+        im = (re * zoom.stepIm) + (im * zoom.stepRe);
+        re = nextRe;
+    }
+
+    normalize_phasor(re, im);
+    zoom.phasorRe = re;
+    zoom.phasorIm = im;
+    zoom_fft_decimate(zoom, count);
+}
+
+void zoom_fft_power(ZoomFft& zoom, float* pPower)
+{
+    PROFILE_SCOPE(Zoom_FFT);
+
+    const auto frames = zoom.settings.frames;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        const auto& sample = zoom.history[(zoom.historyWrite + i) % frames];
+        zoom.fftIn[i] = FftComplex{ sample.r * zoom.window[i], sample.i * zoom.window[i] };
+    }
+
+    fft_complex(zoom.fftPlan, zoom.fftIn.data(), zoom.fftOut.data());
+
+    // The mixer kept one of the two images of a real sine, so * 2 to match the one sided spectrum.
+    // I/Q input has just the one image, as does its two sided spectrum.
+    const float winScale = std::max(zoom.totalWin, 1e-6f);
+    const float imageScale = zoom.settings.complexInput ? 1.0f : 2.0f;
+    spectral_power(zoom.fftOut.data(), zoom.fftMag.data(), frames, imageScale / (winScale * winScale));
+
+    // Negative frequencies (the top half) first
+    const auto half = frames / 2;
+    std::copy(zoom.fftMag.begin() + half, zoom.fftMag.end(), pPower);
+    std::copy(zoom.fftMag.begin(), zoom.fftMag.begin() + half, pPower + (frames - half));
+}
+
+} // namespace Zing